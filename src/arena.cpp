@@ -0,0 +1,68 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+wars::Arena::Arena(std::size_t blockSize) : _blockSize(blockSize), _blocks(), _block(0), _offset(0)
+{
+
+}
+
+void* wars::Arena::allocate(std::size_t size, std::size_t alignment)
+{
+  while(true)
+  {
+    if(_block < _blocks.size())
+    {
+      Block& block = _blocks[_block];
+      std::uintptr_t const base = reinterpret_cast<std::uintptr_t>(block.data.get());
+      std::size_t const offset = ((base + _offset + alignment - 1) & ~(alignment - 1)) - base;
+      if(offset + size <= block.size)
+      {
+        _offset = offset + size;
+        return block.data.get() + offset;
+      }
+
+      // Continue in the next block
+      ++_block;
+      _offset = 0;
+      continue;
+    }
+
+    std::size_t const blockSize = std::max(_blockSize, size + alignment);
+    _blocks.push_back({std::unique_ptr<char[]>(new char[blockSize]), blockSize});
+  }
+}
+
+wars::Arena::Mark wars::Arena::mark() const
+{
+  return {_block, _offset};
+}
+
+void wars::Arena::rewind(const wars::Arena::Mark& mark)
+{
+  _block = mark.block;
+  _offset = mark.offset;
+}
+
+void wars::Arena::reset()
+{
+  _block = 0;
+  _offset = 0;
+}
+
+std::size_t wars::Arena::capacity() const
+{
+  std::size_t result = 0;
+  for(Block const& block : _blocks)
+  {
+    result += block.size;
+  }
+  return result;
+}
+
+wars::Arena& wars::Arena::scratch()
+{
+  static thread_local Arena arena;
+  return arena;
+}
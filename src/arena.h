@@ -0,0 +1,115 @@
+#ifndef WARS_ARENA_H
+#define WARS_ARENA_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace wars
+{
+  // Monotonic allocator for query temporaries. Allocations are bumped out of
+  // large blocks and released all at once by rewinding to an earlier mark.
+  // Blocks are kept for reuse, so repeated queries stop allocating once the
+  // arena has grown to fit them.
+  class Arena
+  {
+  public:
+    static const std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    struct Mark
+    {
+      std::size_t block;
+      std::size_t offset;
+    };
+
+    Arena(std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment);
+    Mark mark() const;
+    void rewind(Mark const& mark);
+    void reset();
+    std::size_t capacity() const;
+
+    // Scratch arena of the calling thread
+    static Arena& scratch();
+
+  private:
+    struct Block
+    {
+      std::unique_ptr<char[]> data;
+      std::size_t size;
+    };
+
+    std::size_t _blockSize;
+    std::vector<Block> _blocks;
+    std::size_t _block;
+    std::size_t _offset;
+  };
+
+  // Rewinds an arena to where it was when the scope was entered
+  class ArenaScope
+  {
+  public:
+    explicit ArenaScope(Arena& arena = Arena::scratch()) : _arena(arena), _mark(arena.mark())
+    {}
+    ~ArenaScope()
+    {
+      _arena.rewind(_mark);
+    }
+    ArenaScope(ArenaScope const&) = delete;
+    ArenaScope& operator=(ArenaScope const&) = delete;
+
+  private:
+    Arena& _arena;
+    Arena::Mark _mark;
+  };
+
+  // Standard allocator on an arena, the calling thread's scratch arena by default
+  template<typename T>
+  class ArenaAllocator
+  {
+  public:
+    typedef T value_type;
+
+    ArenaAllocator() : _arena(&Arena::scratch())
+    {}
+    explicit ArenaAllocator(Arena& arena) : _arena(&arena)
+    {}
+    template<typename U>
+    ArenaAllocator(ArenaAllocator<U> const& other) : _arena(other.arena())
+    {}
+
+    T* allocate(std::size_t n)
+    {
+      return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, std::size_t)
+    {}
+
+    Arena* arena() const
+    {
+      return _arena;
+    }
+
+  private:
+    Arena* _arena;
+  };
+
+  template<typename T, typename U>
+  bool operator==(ArenaAllocator<T> const& a, ArenaAllocator<U> const& b)
+  {
+    return a.arena() == b.arena();
+  }
+
+  template<typename T, typename U>
+  bool operator!=(ArenaAllocator<T> const& a, ArenaAllocator<U> const& b)
+  {
+    return a.arena() != b.arena();
+  }
+
+  template<typename T>
+  using ScratchVector = std::vector<T, ArenaAllocator<T>>;
+}
+#endif // WARS_ARENA_H
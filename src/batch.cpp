@@ -0,0 +1,100 @@
+#include "batch.h"
+#include "hex.h"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  int damage(int attackerHealth, int power, int defense, int health)
+  {
+    if(power < 0)
+      return -1;
+
+    int damage = attackerHealth * power * (100 - (defense * health / 100)) / 100 / 100;
+    return std::max(damage, 1);
+  }
+
+#if defined(__SSE2__) && !defined(__AVX2__)
+  // SSE2 lacks 32-bit abs and max
+  __m128i abs(__m128i x)
+  {
+    __m128i const sign = _mm_srai_epi32(x, 31);
+    return _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+  }
+
+  __m128i max(__m128i a, __m128i b)
+  {
+    __m128i const greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+  }
+#endif
+}
+
+void wars::batch::distances(int x, int y, int const* xs, int const* ys, int count, int* out)
+{
+  int i = 0;
+#if defined(__AVX2__)
+  __m256i const sx = _mm256_set1_epi32(x);
+  __m256i const sy = _mm256_set1_epi32(y);
+  for(; i + 8 <= count; i += 8)
+  {
+    __m256i const dx = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(xs + i)), sx);
+    __m256i const dy = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(ys + i)), sy);
+    __m256i const dz = _mm256_add_epi32(dx, dy);
+    __m256i const d = _mm256_max_epi32(_mm256_max_epi32(_mm256_abs_epi32(dx), _mm256_abs_epi32(dy)), _mm256_abs_epi32(dz));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), d);
+  }
+#elif defined(__SSE2__)
+  __m128i const sx = _mm_set1_epi32(x);
+  __m128i const sy = _mm_set1_epi32(y);
+  for(; i + 4 <= count; i += 4)
+  {
+    __m128i const dx = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(xs + i)), sx);
+    __m128i const dy = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(ys + i)), sy);
+    __m128i const dz = _mm_add_epi32(dx, dy);
+    __m128i const d = max(max(abs(dx), abs(dy)), abs(dz));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), d);
+  }
+#endif
+  for(; i < count; ++i)
+  {
+    out[i] = hex::distance(xs[i] - x, ys[i] - y);
+  }
+}
+
+void wars::batch::damages(int attackerHealth, int const* powers, int const* defenses, int const* healths, int count, int* out)
+{
+  // Vector lanes work in doubles, which hold the integer products exactly
+  // and truncate the same way as the scalar integer divisions. Two SSE2
+  // lanes of double division are no faster than the scalar loop.
+  int i = 0;
+#if defined(__AVX2__)
+  __m256d const attacker = _mm256_set1_pd(attackerHealth);
+  __m256d const hundred = _mm256_set1_pd(100.0);
+  __m256d const tenThousand = _mm256_set1_pd(10000.0);
+  __m128i const one = _mm_set1_epi32(1);
+  __m128i const zero = _mm_setzero_si128();
+  for(; i + 4 <= count; i += 4)
+  {
+    __m128i const power = _mm_loadu_si128(reinterpret_cast<__m128i const*>(powers + i));
+    __m256d const defense = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<__m128i const*>(defenses + i)));
+    __m256d const health = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<__m128i const*>(healths + i)));
+    __m256d const reduction = _mm256_cvtepi32_pd(_mm256_cvttpd_epi32(_mm256_div_pd(_mm256_mul_pd(defense, health), hundred)));
+    __m256d const product = _mm256_mul_pd(_mm256_mul_pd(attacker, _mm256_cvtepi32_pd(power)), _mm256_sub_pd(hundred, reduction));
+    __m128i const d = _mm_max_epi32(_mm256_cvttpd_epi32(_mm256_div_pd(product, tenThousand)), one);
+    // Lanes with negative power become -1
+    __m128i const invalid = _mm_cmplt_epi32(power, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(d, invalid));
+  }
+#endif
+  for(; i < count; ++i)
+  {
+    out[i] = damage(attackerHealth, powers[i], defenses[i], healths[i]);
+  }
+}
@@ -0,0 +1,19 @@
+#ifndef WARS_BATCH_H
+#define WARS_BATCH_H
+
+// Kernels evaluating one source against many targets at once. Targets are
+// given as parallel arrays; results are written to out[0..count-1] and
+// match the scalar Game calculations exactly.
+namespace wars
+{
+  namespace batch
+  {
+    // Hex distances from (x, y) to each (xs[i], ys[i])
+    void distances(int x, int y, int const* xs, int const* ys, int count, int* out);
+
+    // Attack damages for a given attacker health against targets with the
+    // best weapon power (-1 if none), terrain defense and health of each
+    void damages(int attackerHealth, int const* powers, int const* defenses, int const* healths, int count, int* out);
+  }
+}
+#endif // WARS_BATCH_H
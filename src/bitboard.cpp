@@ -0,0 +1,40 @@
+#include "bitboard.h"
+
+wars::Bitboard::Bitboard() : _minX(0), _minY(0), _width(0), _height(0), _words()
+{
+
+}
+
+wars::Bitboard::Bitboard(int minX, int minY, int width, int height) :
+  _minX(minX), _minY(minY), _width(width), _height(height), _words((width * height + 63) / 64, 0)
+{
+
+}
+
+bool wars::Bitboard::contains(int x, int y) const
+{
+  x -= _minX;
+  y -= _minY;
+  return x >= 0 && y >= 0 && x < _width && y < _height;
+}
+
+bool wars::Bitboard::test(int x, int y) const
+{
+  if(!contains(x, y))
+    return false;
+
+  int const bit = (y - _minY) * _width + x - _minX;
+  return (_words[bit / 64] >> (bit % 64)) & 1;
+}
+
+void wars::Bitboard::set(int x, int y, bool value)
+{
+  if(!contains(x, y))
+    return;
+
+  int const bit = (y - _minY) * _width + x - _minX;
+  if(value)
+    _words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+  else
+    _words[bit / 64] &= ~(std::uint64_t(1) << (bit % 64));
+}
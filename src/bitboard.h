@@ -0,0 +1,29 @@
+#ifndef WARS_BITBOARD_H
+#define WARS_BITBOARD_H
+
+#include <vector>
+#include <cstdint>
+
+namespace wars
+{
+  // Set of hexes on a rectangular area of axial coordinates, one bit per hex
+  class Bitboard
+  {
+  public:
+    Bitboard();
+    Bitboard(int minX, int minY, int width, int height);
+
+    bool contains(int x, int y) const;
+    bool test(int x, int y) const;
+    void set(int x, int y, bool value = true);
+
+  private:
+    int _minX;
+    int _minY;
+    int _width;
+    int _height;
+    std::vector<std::uint64_t> _words;
+  };
+}
+
+#endif // WARS_BITBOARD_H
@@ -0,0 +1,82 @@
+#ifndef DELEGATE_H
+#define DELEGATE_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature>
+class Delegate;
+
+// Callable stored inline without allocating. Lambdas capturing up to three
+// pointers fit, which covers the usual [this] handlers; larger callables
+// are rejected at compile time.
+template<typename... Args>
+class Delegate<void(Args...)>
+{
+public:
+  static const std::size_t CAPACITY = 3 * sizeof(void*);
+
+  Delegate() : _storage(), _invoke(nullptr), _destroy(nullptr)
+  {}
+
+  template<typename F>
+  Delegate(F f) : Delegate()
+  {
+    set(std::move(f));
+  }
+
+  ~Delegate()
+  {
+    reset();
+  }
+
+  Delegate(Delegate const&) = delete;
+  Delegate& operator=(Delegate const&) = delete;
+
+  template<typename F>
+  void set(F f)
+  {
+    static_assert(sizeof(F) <= CAPACITY, "Callable too large for a delegate");
+    static_assert(alignof(F) <= alignof(Storage), "Callable alignment too large for a delegate");
+
+    reset();
+    new (&_storage) F(std::move(f));
+    _invoke = [](void* f, Args... args) {
+      (*static_cast<F*>(f))(std::forward<Args>(args)...);
+    };
+    _destroy = [](void* f) {
+      static_cast<F*>(f)->~F();
+    };
+  }
+
+  void reset()
+  {
+    if(_destroy != nullptr)
+    {
+      _destroy(&_storage);
+      _invoke = nullptr;
+      _destroy = nullptr;
+    }
+  }
+
+  explicit operator bool() const
+  {
+    return _invoke != nullptr;
+  }
+
+  void operator()(Args... args)
+  {
+    _invoke(&_storage, std::forward<Args>(args)...);
+  }
+
+private:
+  typedef typename std::aligned_storage<CAPACITY, alignof(void*)>::type Storage;
+
+  Storage _storage;
+  void (*_invoke)(void*, Args...);
+  void (*_destroy)(void*);
+};
+
+#endif // DELEGATE_H
@@ -0,0 +1,198 @@
+#include "eventloop.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+wars::EventLoop::EventLoop() :
+  _wakeupFds{-1, -1}, _running(false), _nextId(1), _watches(), _timers(), _pollFds(), _pollOwners(), _posted()
+{
+#ifdef __linux__
+  _wakeupFds[0] = _wakeupFds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(_wakeupFds[0] < 0)
+#else
+  if(pipe(_wakeupFds) != 0
+     || fcntl(_wakeupFds[0], F_SETFL, O_NONBLOCK) != 0
+     || fcntl(_wakeupFds[1], F_SETFL, O_NONBLOCK) != 0)
+#endif
+  {
+    throw std::runtime_error("Failed to create event loop wakeup descriptor");
+  }
+}
+
+wars::EventLoop::~EventLoop()
+{
+  close(_wakeupFds[0]);
+  if(_wakeupFds[1] != _wakeupFds[0])
+  {
+    close(_wakeupFds[1]);
+  }
+}
+
+int wars::EventLoop::watch(wars::EventLoop::CollectFunc collect, wars::EventLoop::ReadyFunc ready)
+{
+  int const id = _nextId++;
+  _watches.push_back({id, collect, ready});
+  return id;
+}
+
+void wars::EventLoop::unwatch(int id)
+{
+  _watches.erase(std::remove_if(_watches.begin(), _watches.end(), [id](Watch const& w) {
+    return w.id == id;
+  }), _watches.end());
+}
+
+int wars::EventLoop::addTimer(wars::EventLoop::Clock::duration interval, wars::EventLoop::Callback callback)
+{
+  int const id = _nextId++;
+  _timers.push_back({id, interval, Clock::now() + interval, callback});
+  return id;
+}
+
+void wars::EventLoop::removeTimer(int id)
+{
+  _timers.erase(std::remove_if(_timers.begin(), _timers.end(), [id](Timer const& t) {
+    return t.id == id;
+  }), _timers.end());
+}
+
+void wars::EventLoop::post(wars::EventLoop::Callback callback)
+{
+  _posted.push(std::move(callback));
+  wakeup();
+}
+
+void wars::EventLoop::wakeup()
+{
+  std::uint64_t const one = 1;
+  ssize_t written = write(_wakeupFds[1], &one, sizeof(one));
+  (void) written; // Already pending if the counter or pipe is full
+}
+
+void wars::EventLoop::stop()
+{
+  _running = false;
+  wakeup();
+}
+
+void wars::EventLoop::run()
+{
+  _running = true;
+  while(_running)
+  {
+    runOnce();
+  }
+}
+
+void wars::EventLoop::runOnce()
+{
+  _pollFds.clear();
+  _pollOwners.clear();
+  _pollFds.push_back({_wakeupFds[0], POLLIN, 0});
+  _pollOwners.push_back(-1);
+
+  for(Watch const& watch : _watches)
+  {
+    watch.collect(_pollFds);
+    _pollOwners.resize(_pollFds.size(), watch.id);
+  }
+
+  int const result = poll(_pollFds.data(), _pollFds.size(), timeout());
+  if(result < 0 && errno != EINTR)
+  {
+    throw std::runtime_error("Event loop poll failed");
+  }
+
+  if(result > 0)
+  {
+    // Drain wakeups
+    if(_pollFds[0].revents & POLLIN)
+    {
+      std::uint64_t value;
+      while(read(_wakeupFds[0], &value, sizeof(value)) > 0);
+    }
+
+    // Watches are looked up by id as callbacks may remove them
+    for(unsigned int i = 1; i < _pollFds.size(); ++i)
+    {
+      if(_pollFds[i].revents == 0)
+        continue;
+
+      int const owner = _pollOwners[i];
+      auto iter = std::find_if(_watches.begin(), _watches.end(), [owner](Watch const& w) {
+        return w.id == owner;
+      });
+
+      if(iter != _watches.end())
+      {
+        ReadyFunc ready = iter->ready;
+        ready(_pollFds[i]);
+      }
+    }
+  }
+
+  Callback callback;
+  while(_posted.pop(callback))
+  {
+    callback();
+  }
+
+  runTimers();
+}
+
+int wars::EventLoop::timeout() const
+{
+  if(_timers.empty())
+    return -1;
+
+  Clock::time_point deadline = _timers.front().deadline;
+  for(Timer const& timer : _timers)
+  {
+    deadline = std::min(deadline, timer.deadline);
+  }
+
+  Clock::time_point const now = Clock::now();
+  if(deadline <= now)
+    return 0;
+
+  // Round up so the timer is due when poll returns
+  auto const wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now + std::chrono::microseconds(999));
+  return wait.count();
+}
+
+void wars::EventLoop::runTimers()
+{
+  Clock::time_point const now = Clock::now();
+
+  // Collect due timers first as callbacks may add or remove timers
+  std::vector<int> due;
+  for(Timer& timer : _timers)
+  {
+    if(timer.deadline <= now)
+    {
+      due.push_back(timer.id);
+      timer.deadline = std::max(timer.deadline + timer.interval, now);
+    }
+  }
+
+  for(int id : due)
+  {
+    auto iter = std::find_if(_timers.begin(), _timers.end(), [id](Timer const& t) {
+      return t.id == id;
+    });
+
+    if(iter != _timers.end())
+    {
+      Callback callback = iter->callback;
+      callback();
+    }
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef WARS_EVENTLOOP_H
+#define WARS_EVENTLOOP_H
+
+#include <poll.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <atomic>
+
+#include "mpscqueue.h"
+
+namespace wars
+{
+  // Blocks in poll() until a watched file descriptor is ready, a timer is
+  // due or another thread posts a callback or calls wakeup(). Watched
+  // descriptors are collected again on every iteration, so sources may
+  // change them freely.
+  class EventLoop
+  {
+  public:
+    typedef std::function<void()> Callback;
+    typedef std::function<void(std::vector<pollfd>&)> CollectFunc;
+    typedef std::function<void(pollfd&)> ReadyFunc;
+    typedef std::chrono::steady_clock Clock;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(EventLoop const&) = delete;
+    EventLoop& operator=(EventLoop const&) = delete;
+
+    // Collect appends descriptors to poll, ready is called for those with events
+    int watch(CollectFunc collect, ReadyFunc ready);
+    void unwatch(int id);
+
+    // Repeating timer, first due one interval from now
+    int addTimer(Clock::duration interval, Callback callback);
+    void removeTimer(int id);
+
+    // Thread safe, posted callbacks run on the loop thread in order
+    void post(Callback callback);
+    void wakeup();
+    void stop();
+
+    void run();
+    void runOnce();
+
+  private:
+    struct Watch
+    {
+      int id;
+      CollectFunc collect;
+      ReadyFunc ready;
+    };
+
+    struct Timer
+    {
+      int id;
+      Clock::duration interval;
+      Clock::time_point deadline;
+      Callback callback;
+    };
+
+    int timeout() const;
+    void runTimers();
+
+    int _wakeupFds[2]; // read and write end, the same eventfd on Linux
+    std::atomic<bool> _running;
+    int _nextId;
+    std::vector<Watch> _watches;
+    std::vector<Timer> _timers;
+    std::vector<pollfd> _pollFds;
+    std::vector<int> _pollOwners; // watch id of each polled descriptor
+    MpscQueue<Callback> _posted;
+  };
+}
+#endif // WARS_EVENTLOOP_H
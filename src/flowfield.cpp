@@ -0,0 +1,140 @@
+#include "flowfield.h"
+#include "hex.h"
+
+#include <queue>
+#include <limits>
+#include <functional>
+
+namespace
+{
+  typedef std::pair<int, int> QueueItem; // cost, cell
+}
+
+wars::FlowField::FlowField(const Game& game, const Game::Coordinates& target, int movementTypeId) :
+  _target(target), _movementTypeId(movementTypeId), _minX(0), _minY(0), _width(0), _height(0),
+  _cellCosts(), _costs(), _directions()
+{
+  // Cells match the game's tile grid
+  Game::TileColumns const& tileColumns = game.getTileColumns();
+  _minX = tileColumns.minX;
+  _minY = tileColumns.minY;
+  _width = tileColumns.width;
+  _height = tileColumns.height;
+
+  // Cost of entering each cell, -1 if missing or impassable
+  MovementType const& movementType = game.getRules().movementTypes.at(movementTypeId);
+  _cellCosts.assign(tileColumns.grid.size(), -1);
+  for(unsigned int cell = 0; cell < tileColumns.grid.size(); ++cell)
+  {
+    int const tile = tileColumns.grid[cell];
+    if(tile < 0)
+      continue;
+
+    auto effectIter = movementType.effectMap.find(tileColumns.type[tile]);
+    _cellCosts[cell] = effectIter != movementType.effectMap.end() ? effectIter->second : 1;
+  }
+
+  _costs.assign(tileColumns.grid.size(), -1);
+  _directions.assign(tileColumns.grid.size(), -1);
+
+  int const goal = cellIndex(target.x, target.y);
+  if(goal < 0 || _cellCosts[goal] < 0)
+    return;
+
+  // Search backwards from the target, stepping from a cell to the one
+  // being expanded costs entering the expanded cell
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+  _costs[goal] = 0;
+  queue.push(std::make_pair(0, goal));
+
+  while(!queue.empty())
+  {
+    int const cost = queue.top().first;
+    int const cell = queue.top().second;
+    queue.pop();
+
+    // Skip stale queue entries
+    if(cost != _costs[cell])
+      continue;
+
+    Game::Coordinates const pos = cellCoordinates(cell);
+    int const stepCost = cost + _cellCosts[cell];
+
+    for(int direction = 0; direction < 6; ++direction)
+    {
+      int const neighbor = cellIndex(pos.x + hex::NEIGHBORS[direction].x, pos.y + hex::NEIGHBORS[direction].y);
+
+      // Reject if does not exist or cannot be stood on
+      if(neighbor < 0 || _cellCosts[neighbor] < 0)
+        continue;
+
+      if(_costs[neighbor] < 0 || stepCost < _costs[neighbor])
+      {
+        _costs[neighbor] = stepCost;
+        _directions[neighbor] = direction ^ 1;
+        queue.push(std::make_pair(stepCost, neighbor));
+      }
+    }
+  }
+}
+
+const wars::Game::Coordinates& wars::FlowField::getTarget() const
+{
+  return _target;
+}
+
+int wars::FlowField::getMovementTypeId() const
+{
+  return _movementTypeId;
+}
+
+int wars::FlowField::getCost(const Game::Coordinates& from) const
+{
+  int const cell = cellIndex(from.x, from.y);
+  return cell < 0 ? -1 : _costs[cell];
+}
+
+wars::Game::Path wars::FlowField::route(const Game::Coordinates& from) const
+{
+  return route(from, std::numeric_limits<int>::max());
+}
+
+wars::Game::Path wars::FlowField::route(const Game::Coordinates& from, int movement) const
+{
+  int cell = cellIndex(from.x, from.y);
+  if(cell < 0 || _costs[cell] < 0)
+    return {};
+
+  // Follow directions until the target or out of movement points
+  Game::Path path = {from};
+  int spent = 0;
+  while(_directions[cell] >= 0)
+  {
+    hex::Hex const& offset = hex::NEIGHBORS[_directions[cell]];
+    Game::Coordinates const pos = cellCoordinates(cell);
+    int const next = cellIndex(pos.x + offset.x, pos.y + offset.y);
+
+    spent += _cellCosts[next];
+    if(spent > movement)
+      break;
+
+    cell = next;
+    path.push_back(cellCoordinates(cell));
+  }
+
+  return path;
+}
+
+int wars::FlowField::cellIndex(int x, int y) const
+{
+  x -= _minX;
+  y -= _minY;
+  if(x < 0 || y < 0 || x >= _width || y >= _height)
+    return -1;
+  return y * _width + x;
+}
+
+wars::Game::Coordinates wars::FlowField::cellCoordinates(int cell) const
+{
+  return {cell % _width + _minX, cell / _width + _minY};
+}
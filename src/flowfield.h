@@ -0,0 +1,40 @@
+#ifndef WARS_FLOWFIELD_H
+#define WARS_FLOWFIELD_H
+
+#include "game.h"
+
+#include <vector>
+
+namespace wars
+{
+  // Routes from every tile of the map to a single target for one movement
+  // type, built with one reverse search from the target. Only terrain is
+  // taken into account, so fields stay valid until the map changes.
+  class FlowField
+  {
+  public:
+    FlowField(Game const& game, Game::Coordinates const& target, int movementTypeId);
+
+    Game::Coordinates const& getTarget() const;
+    int getMovementTypeId() const;
+
+    int getCost(Game::Coordinates const& from) const; // -1 if target unreachable
+    Game::Path route(Game::Coordinates const& from) const;
+    Game::Path route(Game::Coordinates const& from, int movement) const;
+
+  private:
+    int cellIndex(int x, int y) const;
+    Game::Coordinates cellCoordinates(int cell) const;
+
+    Game::Coordinates _target;
+    int _movementTypeId;
+    int _minX;
+    int _minY;
+    int _width;
+    int _height;
+    std::vector<int> _cellCosts;
+    std::vector<int> _costs;
+    std::vector<signed char> _directions;
+  };
+}
+#endif // WARS_FLOWFIELD_H
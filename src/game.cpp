@@ -1,13 +1,23 @@
 #include "game.h"
+#include "hex.h"
+#include "batch.h"
+#include "arena.h"
+#include "pathabstraction.h"
+#include "flowfield.h"
 #include <iostream>
-#include <sstream>
 #include <algorithm>
 #include <queue>
 #include <cmath>
 #include <map>
+#include <array>
+#include <limits>
+#include <type_traits>
+#include <cstdlib>
 
 #include "jsonpp.h"
 
+static_assert(std::is_trivially_copyable<wars::Game::Event>::value, "Game events must be trivially copyable");
+
 std::unordered_map<std::string, wars::Game::State> const wars::Game::STATE_NAMES = {
   {"pregame", State::PREGAME},
   {"inProgress", State::IN_PROGRESS},
@@ -43,15 +53,52 @@ namespace
 
   std::unordered_map<int, int> parseIntIntMap(json::Value const& v);
   std::unordered_map<int, int> parseIntIntMapWithNulls(json::Value const& v, int nullValue);
-  std::unordered_set<int> parseIntSet(json::Value const& v);
-  int parseIntOrNull(json::Value const& v, int nullValue);
-  std::string parseStringOrNull(json::Value const& v, std::string const& nullValue);
-  wars::Game::Path parsePath(json::Value const& v);
+  template<typename Json> std::unordered_set<int> parseIntSet(Json const& v);
+  template<typename Json> int parseIntOrNull(Json const& v, int nullValue);
+  template<typename Json> std::string parseStringOrNull(Json const& v, std::string const& nullValue);
+  int parseIntKey(std::string const& key);
+  std::size_t actionHash(std::string const& name);
+
+  template<typename T>
+  T read(wars::JsonReader& r);
+  template<typename T>
+  std::unordered_map<int, T> readAll(wars::JsonReader& r);
+  template<>
+  wars::Weapon read(wars::JsonReader& r);
+  template<>
+  wars::Armor read(wars::JsonReader& r);
+  template<>
+  wars::UnitClass read(wars::JsonReader& r);
+  template<>
+  wars::TerrainFlag read(wars::JsonReader& r);
+  template<>
+  wars::TerrainType read(wars::JsonReader& r);
+  template<>
+  wars::MovementType read(wars::JsonReader& r);
+  template<>
+  wars::UnitFlag read(wars::JsonReader& r);
+  template<>
+  wars::UnitType read(wars::JsonReader& r);
+  template<>
+  wars::Rules read(wars::JsonReader& r);
+  std::unordered_map<int, int> readIntIntMap(wars::JsonReader& r, int nullValue);
+  std::unordered_set<int> readIntSet(wars::JsonReader& r);
+  int readInt(wars::JsonReader& r, int nullValue);
+  std::string readString(wars::JsonReader& r);
+  bool readBoolean(wars::JsonReader& r);
+
+  int movementCost(wars::MovementType const& movementType, int terrainId);
+  bool hasTerrainFlag(wars::Rules const& rules, int terrainId, std::string const& flagName);
+  void removeHandle(std::vector<int>& handles, int handle);
+  unsigned int hilbertIndex(unsigned int order, unsigned int x, unsigned int y);
+  template<typename Iterator> void insertionSort(Iterator begin, Iterator end);
 }
 wars::Game::Game(): gameId(), authorId(),  name(), mapId(),
   state(State::PREGAME), turnStart(0), turnNumber(0), roundNumber(0), inTurnNumber(0),
   publicGame(false), turnLength(0), bannedUnits(0),
-  rules(), tiles(), units(),  players(), eventStream()
+  rules(), tiles(), units(),  players(), tileColumns(), unitColumns(),
+  playerAssets(), alliances(), numAlliancePlayers(0), bitboards(),
+  pathAbstraction(std::make_shared<PathAbstraction>()), eventPaths(std::make_shared<Arena>(4096)), eventStream()
 {
 
 }
@@ -61,6 +108,15 @@ wars::Game::~Game()
 
 }
 
+wars::Game wars::Game::snapshot() const
+{
+  Game result(*this);
+  result.eventStream = Stream<Event>();
+  result.pathAbstraction = std::make_shared<PathAbstraction>();
+  result.pathAbstraction->reset(result.tileColumns);
+  return result;
+}
+
 Stream<wars::Game::Event> wars::Game::events()
 {
   return eventStream;
@@ -71,9 +127,118 @@ void wars::Game::setRulesFromJSON(const json::Value& value)
   rules = parse<Rules>(value);
 }
 
+void wars::Game::setRulesFromJSON(wars::JsonReader& reader)
+{
+  rules = read<Rules>(reader);
+}
+
 void wars::Game::setGameDataFromJSON(const json::Value& value)
 {
-  json::Value game = value.get("game");
+  setGameData(value);
+}
+
+void wars::Game::setGameDataFromJSON(const wars::JsonView::Value& value)
+{
+  setGameData(value);
+}
+
+void wars::Game::setGameDataFromJSON(wars::JsonReader& reader)
+{
+  gameId.clear();
+  authorId.clear();
+  name.clear();
+  mapId.clear();
+  turnStart = 0;
+  turnNumber = 0;
+  roundNumber = 0;
+  inTurnNumber = 0;
+  publicGame = false;
+  turnLength = -1;
+  bannedUnits.clear();
+  std::string stateName;
+
+  reader.beginObject();
+  while(reader.nextMember())
+  {
+    if(reader.key() != "game")
+    {
+      reader.skip();
+      continue;
+    }
+
+    reader.beginObject();
+    while(reader.nextMember())
+    {
+      std::string const& key = reader.key();
+      if(key == "gameId")
+        gameId = readString(reader);
+      else if(key == "authorId")
+        authorId = readString(reader);
+      else if(key == "name")
+        name = readString(reader);
+      else if(key == "mapId")
+        mapId = readString(reader);
+      else if(key == "state")
+        stateName = readString(reader);
+      else if(key == "turnStart")
+        turnStart = reader.readNull() ? 0 : reader.readDouble(); // milliseconds, past int range
+      else if(key == "turnNumber")
+        turnNumber = readInt(reader, 0);
+      else if(key == "roundNumber")
+        roundNumber = readInt(reader, 0);
+      else if(key == "inTurnNumber")
+        inTurnNumber = readInt(reader, 0);
+      else if(key == "settings" && reader.peek() == JsonReader::Type::OBJECT)
+      {
+        reader.beginObject();
+        while(reader.nextMember())
+        {
+          if(reader.key() == "public")
+            publicGame = readBoolean(reader);
+          else if(reader.key() == "turnLength")
+            turnLength = readInt(reader, -1);
+          else if(reader.key() == "bannedUnits")
+            bannedUnits = readIntSet(reader);
+          else
+            reader.skip();
+        }
+      }
+      else if(key == "tiles" && reader.peek() == JsonReader::Type::ARRAY)
+      {
+        reader.beginArray();
+        while(reader.nextElement())
+        {
+          updateTileFromJSON(reader);
+        }
+      }
+      else if(key == "players" && reader.peek() == JsonReader::Type::ARRAY)
+      {
+        reader.beginArray();
+        while(reader.nextElement())
+        {
+          updatePlayerFromJSON(reader);
+        }
+      }
+      else
+        reader.skip();
+    }
+  }
+  state = STATE_NAMES.at(stateName);
+
+  rebuildAlliances();
+  rebuildColumns();
+  resetBitboards();
+  resetEventPaths();
+
+  Event event;
+  event.type = EventType::GAMEDATA;
+  eventStream.push(event);
+}
+
+template<typename Json>
+void wars::Game::setGameData(const Json& value)
+{
+  Json game = value.get("game");
   gameId = game.get("gameId").stringValue();
   authorId = game.get("authorId").stringValue();
   name = game.get("name").stringValue();
@@ -84,27 +249,32 @@ void wars::Game::setGameDataFromJSON(const json::Value& value)
   roundNumber = game.get("roundNumber").longValue();
   inTurnNumber = game.get("inTurnNumber").longValue();
 
-  json::Value settings = game.get("settings");
+  Json settings = game.get("settings");
   publicGame = settings.get("public").booleanValue();
   turnLength = parseIntOrNull(settings.get("turnLength"), -1);
   bannedUnits = parseIntSet(settings.get("bannedUnits"));
 
-  json::Value tileArray = game.get("tiles");
+  Json tileArray = game.get("tiles");
   unsigned int numTiles = tileArray.size();
   for(unsigned int i = 0; i < numTiles; ++i)
   {
-    json::Value tile = tileArray.at(i);
+    Json tile = tileArray.at(i);
     updateTileFromJSON(tile);
   }
 
-  json::Value playerArray = game.get("players");
+  Json playerArray = game.get("players");
   unsigned int numPlayers = playerArray.size();
   for(unsigned int i = 0; i < numPlayers; ++i)
   {
-    json::Value player = playerArray.at(i);
+    Json player = playerArray.at(i);
     updatePlayerFromJSON(player);
   }
 
+  rebuildAlliances();
+  rebuildColumns();
+  resetBitboards();
+  resetEventPaths();
+
   Event event;
   event.type = EventType::GAMEDATA;
   eventStream.push(event);
@@ -112,207 +282,382 @@ void wars::Game::setGameDataFromJSON(const json::Value& value)
 
 void wars::Game::processEventFromJSON(const json::Value& value)
 {
-  json::Value content = value.get("content");
-  std::string action = content.get("action").stringValue();
+  std::string text = value.toString();
+  JsonReader reader(text);
+  processEventFromJSON(reader);
+}
 
-  if(action == "move")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    Path path = parsePath(content.get("path"));
-    moveUnit(unitId, tileId, path);
-  }
-  else if(action == "wait")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    waitUnit(unitId);
-  }
-  else if(action == "attack")
+void wars::Game::processEventFromJSON(const wars::JsonView::Value& value)
+{
+  JsonReader reader(value.data(), value.length());
+  processEventFromJSON(reader);
+}
+
+void wars::Game::processEventFromJSON(wars::JsonReader& reader)
+{
+  EventContent content;
+  processEvent(reader, content);
+}
+
+void wars::Game::processEventsFromJSON(const json::Value& value)
+{
+  std::string text = value.toString();
+  JsonReader reader(text);
+  processEventsFromJSON(reader);
+}
+
+void wars::Game::processEventsFromJSON(const wars::JsonView::Value& value)
+{
+  JsonReader reader(value.data(), value.length());
+  processEventsFromJSON(reader);
+}
+
+void wars::Game::processEventsFromJSON(wars::JsonReader& reader)
+{
+  // Reused so that catching up on many events doesn't allocate per event
+  EventContent content;
+  reader.beginArray();
+  while(reader.nextElement())
   {
-    std::string attackerId = content.get("attacker").get("unitId").stringValue();
-    std::string targetId = content.get("target").get("unitId").stringValue();
-    int damage = content.get("damage").longValue();
-    attackUnit(attackerId, targetId, damage);
+    processEvent(reader, content);
   }
-  else if(action == "counterattack")
-  {
-    std::string attackerId = content.get("attacker").get("unitId").stringValue();
-    std::string targetId = content.get("target").get("unitId").stringValue();
-    int damage = -1;
-    if(content.get("damage").type() == json::Value::Type::NUMBER)
+}
+
+wars::Game::EventActionEntry const wars::Game::EVENT_ACTIONS[] = {
+  {"move", [](Game& game, EventContent const& c) {
+    game.moveUnit(c.unitId, c.tileId, c.path);
+  }},
+  {"wait", [](Game& game, EventContent const& c) {
+    game.waitUnit(c.unitId);
+  }},
+  {"attack", [](Game& game, EventContent const& c) {
+    game.attackUnit(c.attackerId, c.targetId, c.hasDamage ? c.damage : 0);
+  }},
+  {"counterattack", [](Game& game, EventContent const& c) {
+    game.counterattackUnit(c.attackerId, c.targetId, c.hasDamage ? c.damage : -1);
+  }},
+  {"capture", [](Game& game, EventContent const& c) {
+    game.captureTile(c.unitId, c.tileId, c.left);
+  }},
+  {"captured", [](Game& game, EventContent const& c) {
+    game.capturedTile(c.unitId, c.tileId);
+  }},
+  {"deploy", [](Game& game, EventContent const& c) {
+    game.deployUnit(c.unitId);
+  }},
+  {"undeploy", [](Game& game, EventContent const& c) {
+    game.undeployUnit(c.unitId);
+  }},
+  {"load", [](Game& game, EventContent const& c) {
+    game.loadUnit(c.unitId, c.carrierId);
+  }},
+  {"unload", [](Game& game, EventContent const& c) {
+    game.unloadUnit(c.unitId, c.carrierId, c.tileId);
+  }},
+  {"destroyed", [](Game& game, EventContent const& c) {
+    game.destroyUnit(c.unitId);
+  }},
+  {"repair", [](Game& game, EventContent const& c) {
+    game.repairUnit(c.unitId, c.newHealth);
+  }},
+  {"build", [](Game& game, EventContent const& c) {
+    std::string unitId;
+    if(c.unit != nullptr)
     {
-      damage = content.get("damage").longValue();
+      JsonReader unit(c.unit, c.unitLength);
+      unitId = game.updateUnitFromJSON(unit);
     }
-    counterattackUnit(attackerId, targetId, damage);
-  }
-  else if(action == "capture")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    int left = content.get("left").longValue();
-    captureTile(unitId, tileId, left);
-  }
-  else if(action == "captured")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    capturedTile(unitId, tileId);
-  }
-  else if(action == "deploy")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    deployUnit(unitId);
-  }
-  else if(action == "undeploy")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    undeployUnit(unitId);
-  }
-  else if(action == "load")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    std::string carrierId = content.get("carrier").get("unitId").stringValue();
-    loadUnit(unitId, carrierId);
-  }
-  else if(action == "unload")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    std::string carrierId = content.get("carrier").get("unitId").stringValue();
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    unloadUnit(unitId, carrierId, tileId);
-  }
-  else if(action == "destroyed")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    destroyUnit(unitId);
-  }
-  else if(action == "repair")
-  {
-    std::string unitId = content.get("unit").get("unitId").stringValue();
-    int newHealth = content.get("newHealth").longValue();
-    repairUnit(unitId, newHealth);
-  }
-  else if(action == "build")
-  {
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    std::string unitId = updateUnitFromJSON(content.get("unit"));
-    units[unitId].tileId = tileId;
-    buildUnit(tileId, unitId);
-  }
-  else if(action == "regenerateCapturePoints")
-  {
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    int newCapturePoints = content.get("newCapturePoints").longValue();
-    regenerateCapturePointsTile(tileId, newCapturePoints);
-  }
-  else if(action == "produceFunds")
-  {
-    std::string tileId = content.get("tile").get("tileId").stringValue();
-    produceFundsTile(tileId);
-  }
-  else if(action == "beginTurn")
-  {
-    int playerNumber = content.get("player").longValue();
-    beginTurn(playerNumber);
-  }
-  else if(action == "endTurn")
-  {
-    int playerNumber = content.get("player").longValue();
-    endTurn(playerNumber);
-  }
-  else if(action == "turnTimeout")
+    game.units[unitId].tileId = c.tileId;
+    game.buildUnit(c.tileId, unitId);
+  }},
+  {"regenerateCapturePoints", [](Game& game, EventContent const& c) {
+    game.regenerateCapturePointsTile(c.tileId, c.newCapturePoints);
+  }},
+  {"produceFunds", [](Game& game, EventContent const& c) {
+    game.produceFundsTile(c.tileId);
+  }},
+  {"beginTurn", [](Game& game, EventContent const& c) {
+    game.beginTurn(c.player);
+  }},
+  {"endTurn", [](Game& game, EventContent const& c) {
+    game.endTurn(c.player);
+  }},
+  {"turnTimeout", [](Game& game, EventContent const& c) {
+    game.turnTimeout(c.player);
+  }},
+  {"finished", [](Game& game, EventContent const& c) {
+    game.finished(c.winner);
+  }},
+  {"surrender", [](Game& game, EventContent const& c) {
+    game.surrender(c.player);
+  }},
+  {nullptr, nullptr}
+};
+
+wars::Game::EventAction wars::Game::findEventAction(const std::string& name)
+{
+  // Slots are picked by a hash that is perfect over the known names, which
+  // is checked when the table is built
+  static std::array<EventActionEntry const*, 32> const table = []() {
+    std::array<EventActionEntry const*, 32> result;
+    result.fill(nullptr);
+    for(EventActionEntry const* entry = EVENT_ACTIONS; entry->name != nullptr; ++entry)
+    {
+      std::size_t const slot = actionHash(entry->name);
+      if(result[slot] != nullptr)
+        throw std::runtime_error(std::string("Event action hash collision: ") + entry->name);
+      result[slot] = entry;
+    }
+    return result;
+  }();
+
+  EventActionEntry const* entry = table[actionHash(name)];
+  return entry != nullptr && name == entry->name ? entry->action : nullptr;
+}
+
+void wars::Game::processEvent(wars::JsonReader& reader, wars::Game::EventContent& content)
+{
+  bool hasContent = false;
+  reader.beginObject();
+  while(reader.nextMember())
   {
-    int playerNumber = content.get("player").longValue();
-    turnTimeout(playerNumber);
+    if(reader.key() == "content" && reader.peek() == JsonReader::Type::OBJECT)
+    {
+      readEventContent(reader, content);
+      hasContent = true;
+    }
+    else
+    {
+      reader.skip();
+    }
   }
-  else if(action == "finished")
+
+  if(!hasContent)
   {
-    int winnerPlayerNumber = content.get("winner").longValue();
-    finished(winnerPlayerNumber);
+    std::cerr << "Event without content" << std::endl;
+    return;
   }
-  else if(action == "surrender")
+
+  EventAction action = findEventAction(content.action);
+  if(action == nullptr)
   {
-    int playerNumber = content.get("player").longValue();
-    surrender(playerNumber);
+    std::cerr << "Unknown event action: " << content.action << std::endl;
+    return;
   }
-  else
-  {
-    std::cerr << "Unknown event action: " << action << std::endl;
+  action(*this, content);
+}
+
+void wars::Game::readEventContent(wars::JsonReader& reader, wars::Game::EventContent& content)
+{
+  content.action.clear();
+  content.unitId.clear();
+  content.tileId.clear();
+  content.attackerId.clear();
+  content.targetId.clear();
+  content.carrierId.clear();
+  content.path.clear();
+  content.hasDamage = false;
+  content.damage = 0;
+  content.left = 0;
+  content.newHealth = 0;
+  content.newCapturePoints = 0;
+  content.player = 0;
+  content.winner = 0;
+  content.unit = nullptr;
+  content.unitLength = 0;
+
+  reader.beginObject();
+  while(reader.nextMember())
+  {
+    std::string const& key = reader.key();
+    if(key == "action")
+    {
+      content.action = readString(reader);
+    }
+    else if(key == "unit" && reader.peek() == JsonReader::Type::OBJECT)
+    {
+      content.unit = reader.position();
+      content.unitId = readEventUnitId(reader);
+      content.unitLength = reader.position() - content.unit;
+    }
+    else if(key == "tile" && reader.peek() == JsonReader::Type::OBJECT)
+    {
+      reader.beginObject();
+      while(reader.nextMember())
+      {
+        if(reader.key() == "tileId")
+          content.tileId = readString(reader);
+        else
+          reader.skip();
+      }
+    }
+    else if(key == "attacker")
+    {
+      content.attackerId = readEventUnitId(reader);
+    }
+    else if(key == "target")
+    {
+      content.targetId = readEventUnitId(reader);
+    }
+    else if(key == "carrier")
+    {
+      content.carrierId = readEventUnitId(reader);
+    }
+    else if(key == "path" && reader.peek() == JsonReader::Type::ARRAY)
+    {
+      reader.beginArray();
+      while(reader.nextElement())
+      {
+        Coordinates coordinates = {0, 0};
+        reader.beginObject();
+        while(reader.nextMember())
+        {
+          if(reader.key() == "x")
+            coordinates.x = readInt(reader, 0);
+          else if(reader.key() == "y")
+            coordinates.y = readInt(reader, 0);
+          else
+            reader.skip();
+        }
+        content.path.push_back(coordinates);
+      }
+    }
+    else if(key == "damage" && reader.peek() == JsonReader::Type::NUMBER)
+    {
+      content.damage = reader.readLong();
+      content.hasDamage = true;
+    }
+    else if(key == "left")
+    {
+      content.left = readInt(reader, 0);
+    }
+    else if(key == "newHealth")
+    {
+      content.newHealth = readInt(reader, 0);
+    }
+    else if(key == "newCapturePoints")
+    {
+      content.newCapturePoints = readInt(reader, 0);
+    }
+    else if(key == "player")
+    {
+      content.player = readInt(reader, 0);
+    }
+    else if(key == "winner")
+    {
+      content.winner = readInt(reader, 0);
+    }
+    else
+    {
+      reader.skip();
+    }
   }
 }
 
-void wars::Game::processEventsFromJSON(const json::Value& value)
+std::string wars::Game::readEventUnitId(wars::JsonReader& reader)
 {
-  unsigned int numEvents = value.size();
-  for(int i = 0; i < numEvents; ++i)
+  std::string unitId;
+  if(reader.peek() != JsonReader::Type::OBJECT)
+  {
+    reader.skip();
+    return unitId;
+  }
+
+  reader.beginObject();
+  while(reader.nextMember())
   {
-    json::Value event = value.at(i);
-    processEventFromJSON(event);
+    if(reader.key() == "unitId")
+      unitId = readString(reader);
+    else
+      reader.skip();
   }
+  return unitId;
 }
 
 void wars::Game::moveUnit(std::string const& unitId, std::string const& tileId, Path const& path)
 {
   Event event;
   event.type = EventType::MOVE;
-  event.move.unitId = &unitId;
-  event.move.tileId = &tileId;
-  event.move.path = &path;
+  event.move.unit = unitHandle(unitId);
+  event.move.from = unitTileHandle(unitId);
+  event.move.tile = tileHandle(tileId);
+  event.move.path = storeEventPath(path);
   eventStream.push(event);
 
   Unit& unit = units.at(unitId);
   Tile& tile = tiles.at(tileId);
-  tiles.at(unit.tileId).unitId.clear();
+  Tile& previousTile = tiles.at(unit.tileId);
+  previousTile.unitId.clear();
   if(tile.unitId.empty())
     tile.unitId = unitId;
   unit.tileId = tileId;
+
+  updateUnitColumns(unit);
+  updateTileColumns(previousTile);
+  updateTileColumns(tile);
 }
 
 void wars::Game::waitUnit(std::string const& unitId)
 {
   Event event;
   event.type = EventType::WAIT;
-  event.wait.unitId = &unitId;
+  event.wait.unit = unitHandle(unitId);
+  event.wait.tile = unitTileHandle(unitId);
   eventStream.push(event);
 
-  units.at(unitId).moved = true;
+  Unit& unit = units.at(unitId);
+  unit.moved = true;
+  updateUnitColumns(unit);
 }
 
 void wars::Game::attackUnit(std::string const& attackerId, std::string const& targetId, int damage)
 {
   Event event;
   event.type = EventType::ATTACK;
-  event.attack.attackerId = &attackerId;
-  event.attack.targetId = &targetId;
+  event.attack.attacker = unitHandle(attackerId);
+  event.attack.target = unitHandle(targetId);
   event.attack.damage = damage;
+  event.attack.attackerTile = unitTileHandle(attackerId);
+  event.attack.targetTile = unitTileHandle(targetId);
   eventStream.push(event);
 
-units.at(attackerId).moved = true;
-units.at(targetId).health -= damage;
+  Unit& attacker = units.at(attackerId);
+  attacker.moved = true;
+  updateUnitColumns(attacker);
+
+  Unit& target = units.at(targetId);
+  target.health -= damage;
+  updateUnitColumns(target);
 }
 
 void wars::Game::counterattackUnit(std::string const& attackerId, std::string const& targetId, int damage)
 {
   Event event;
   event.type = EventType::COUNTERATTACK;
-  event.counterattack.attackerId = &attackerId;
-  event.counterattack.targetId = &targetId;
+  event.counterattack.attacker = unitHandle(attackerId);
+  event.counterattack.target = unitHandle(targetId);
   event.counterattack.damage = damage;
+  event.counterattack.attackerTile = unitTileHandle(attackerId);
+  event.counterattack.targetTile = unitTileHandle(targetId);
   eventStream.push(event);
 
-  units.at(targetId).health -= damage;
+  Unit& target = units.at(targetId);
+  target.health -= damage;
+  updateUnitColumns(target);
 }
 
 void wars::Game::captureTile(std::string const& unitId, std::string const& tileId, int left)
 {
   Event event;
   event.type = EventType::CAPTURE;
-  event.capture.unitId = &unitId;
-  event.capture.tileId = &tileId;
+  event.capture.unit = unitHandle(unitId);
+  event.capture.tile = tileHandle(tileId);
   event.capture.left = left;
   eventStream.push(event);
 
-  units.at(unitId).moved = true;
+  Unit& unit = units.at(unitId);
+  unit.moved = true;
+  updateUnitColumns(unit);
   Tile& tile = tiles.at(tileId);
   tile.capturePoints = left;
   tile.beingCaptured = true;
@@ -322,53 +667,63 @@ void wars::Game::capturedTile(std::string const& unitId, std::string const& tile
 {
   Event event;
   event.type = EventType::CAPTURED;
-  event.captured.unitId = &unitId;
-  event.captured.tileId = &tileId;
+  event.captured.unit = unitHandle(unitId);
+  event.captured.tile = tileHandle(tileId);
+  event.captured.owner = units.at(unitId).owner;
   eventStream.push(event);
 
-  units.at(unitId).moved = true;
+  Unit& unit = units.at(unitId);
+  unit.moved = true;
+  updateUnitColumns(unit);
   Tile& tile = tiles.at(tileId);
   tile.capturePoints = 1;
   tile.beingCaptured = false;
-  tile.owner = units.at(unitId).owner;
+  tile.owner = unit.owner;
+  updateTileColumns(tile);
 }
 
 void wars::Game::deployUnit(std::string const& unitId)
 {
   Event event;
   event.type = EventType::DEPLOY;
-  event.deploy.unitId = &unitId;
+  event.deploy.unit = unitHandle(unitId);
+  event.deploy.tile = unitTileHandle(unitId);
   eventStream.push(event);
 
   Unit& unit = units.at(unitId);
   unit.moved = true;
   unit.deployed = true;
+  updateUnitColumns(unit);
 }
 
 void wars::Game::undeployUnit(std::string const& unitId)
 {
   Event event;
   event.type = EventType::UNDEPLOY;
-  event.undeploy.unitId = &unitId;
+  event.undeploy.unit = unitHandle(unitId);
+  event.undeploy.tile = unitTileHandle(unitId);
   eventStream.push(event);
 
   Unit& unit = units.at(unitId);
   unit.moved = true;
   unit.deployed = false;
+  updateUnitColumns(unit);
 }
 
 void wars::Game::loadUnit(std::string const& unitId, std::string const& carrierId)
 {
   Event event;
   event.type = EventType::LOAD;
-  event.load.unitId = &unitId;
-  event.load.carrierId = &carrierId;
+  event.load.unit = unitHandle(unitId);
+  event.load.carrier = unitHandle(carrierId);
+  event.load.tile = unitTileHandle(unitId);
   eventStream.push(event);
 
   Unit& unit = units.at(unitId);
   unit.tileId.clear();
   unit.carriedBy = carrierId;
   unit.moved = true;
+  updateUnitColumns(unit);
   Unit& carrier = units.at(carrierId);
   carrier.carriedUnits.push_back(unitId);
 }
@@ -377,36 +732,58 @@ void wars::Game::unloadUnit(std::string const& unitId, std::string const& carrie
 {
   Event event;
   event.type = EventType::UNLOAD;
-  event.unload.unitId = &unitId;
-  event.unload.carrierId = &carrierId;
-  event.unload.tileId = &tileId;
+  event.unload.unit = unitHandle(unitId);
+  event.unload.carrier = unitHandle(carrierId);
+  event.unload.from = unitTileHandle(carrierId);
+  event.unload.tile = tileHandle(tileId);
   eventStream.push(event);
 
   Unit& unit = units.at(unitId);
   unit.tileId = tileId;
   unit.moved = true;
+  updateUnitColumns(unit);
   tiles.at(tileId).unitId = unitId;
+  updateTileColumns(tiles.at(tileId));
   Unit& carrier = units[carrierId];
   carrier.moved = true;
-  std::remove(carrier.carriedUnits.begin(), carrier.carriedUnits.end(), unitId);
+  updateUnitColumns(carrier);
+  carrier.carriedUnits.erase(std::remove(carrier.carriedUnits.begin(), carrier.carriedUnits.end(), unitId), carrier.carriedUnits.end());
 }
 
 void wars::Game::destroyUnit(std::string const& unitId)
 {
+  int handle = unitHandle(unitId);
+  Unit unit = units.at(unitId);
+
   Event event;
   event.type = EventType::DESTROY;
-  event.destroy.unitId = &unitId;
+  event.destroy.unit = handle;
+  event.destroy.tile = unitTileHandle(unitId);
   eventStream.push(event);
 
-  Unit unit = units.at(unitId);
   if(!unit.tileId.empty())
+  {
     tiles.at(unit.tileId).unitId.erase();
+    updateTileColumns(tiles.at(unit.tileId));
+  }
 
   for(std::string const& carriedUnitId : unit.carriedUnits)
   {
     destroyUnit(carriedUnitId);
   }
 
+  if(unit.handle >= 0)
+  {
+    PlayerAssets& assets = playerAssets[unit.owner];
+    removeHandle(assets.units, unit.handle);
+    assets.armyValue -= rules.unitTypes.at(unitColumns.type[unit.handle]).price * unitColumns.health[unit.handle] / 100;
+
+    // The handle is retired with its id until the next game data, so events
+    // referring to the unit keep resolving to it
+    unitColumns.tile[unit.handle] = -1;
+    unitColumns.flags[unit.handle] = 0;
+  }
+
   units.erase(unitId);
 }
 
@@ -414,30 +791,48 @@ void wars::Game::repairUnit(std::string const& unitId, int newHealth)
 {
   Event event;
   event.type = EventType::REPAIR;
-  event.repair.unitId = &unitId;
+  event.repair.unit = unitHandle(unitId);
+  event.repair.tile = unitTileHandle(unitId);
   event.repair.newHealth = newHealth;
   eventStream.push(event);
 
-  units.at(unitId).health = newHealth;
+  Unit& unit = units.at(unitId);
+
+  // Repairs cost the restored share of the unit's price
+  auto playerIter = players.find(unit.owner);
+  if(playerIter != players.end() && newHealth > unit.health)
+    playerIter->second.funds -= rules.unitTypes.at(unit.type).price * (newHealth - unit.health) / 100;
+
+  unit.health = newHealth;
+  updateUnitColumns(unit);
 }
 
 void wars::Game::buildUnit(std::string const& tileId, std::string const& unitId)
 {
   Event event;
   event.type = EventType::BUILD;
-  event.build.tileId = &tileId;
-  event.build.unitId = &unitId;
+  event.build.tile = tileHandle(tileId);
+  event.build.unit = unitHandle(unitId);
   eventStream.push(event);
 
-  tiles.at(tileId).unitId = unitId;
-  units.at(unitId).moved = true;
+  Unit& unit = units.at(unitId);
+  unit.moved = true;
+  updateUnitColumns(unit);
+
+  auto playerIter = players.find(unit.owner);
+  if(playerIter != players.end())
+    playerIter->second.funds -= rules.unitTypes.at(unit.type).price;
+
+  Tile& tile = tiles.at(tileId);
+  tile.unitId = unitId;
+  updateTileColumns(tile);
 }
 
 void wars::Game::regenerateCapturePointsTile(std::string const& tileId, int newCapturePoints)
 {
   Event event;
   event.type = EventType::REGENERATE_CAPTURE_POINTS;
-  event.regenerateCapturePoints.tileId = &tileId;
+  event.regenerateCapturePoints.tile = tileHandle(tileId);
   event.regenerateCapturePoints.newCapturePoints = newCapturePoints;
   eventStream.push(event);
 
@@ -451,8 +846,12 @@ void wars::Game::produceFundsTile(std::string const& tileId)
 {
   Event event;
   event.type = EventType::PRODUCE_FUNDS;
-  event.produceFunds.tileId = &tileId;
+  event.produceFunds.tile = tileHandle(tileId);
   eventStream.push(event);
+
+  auto playerIter = players.find(tiles.at(tileId).owner);
+  if(playerIter != players.end())
+    playerIter->second.funds += FUNDS_PER_TILE;
 }
 
 void wars::Game::beginTurn(int playerNumber)
@@ -472,10 +871,13 @@ void wars::Game::endTurn(int playerNumber)
   event.endTurn.playerNumber = playerNumber;
   eventStream.push(event);
 
-  for(auto& item : units)
+  for(unsigned int i = 0; i < unitColumns.flags.size(); ++i)
   {
-    Unit& unit = item.second;
-    unit.moved = false;
+    if(unitColumns.flags[i] & UnitColumns::MOVED)
+    {
+      unitColumns.flags[i] &= ~UnitColumns::MOVED;
+      units.at(unitColumns.ids[i]).moved = false;
+    }
   }
 }
 
@@ -504,14 +906,14 @@ void wars::Game::surrender(int playerNumber)
   event.surrender.playerNumber = playerNumber;
   eventStream.push(event);
 
+  PlayerAssets const& assets = getPlayerAssets(playerNumber);
+
+  // Carried units are destroyed with their carriers, which have the same owner
   std::vector<std::string> unitsToDestroy;
-  for(auto& item : units)
+  for(int handle : assets.units)
   {
-    Unit& unit = item.second;
-    if(unit.owner == playerNumber)
-    {
-      unitsToDestroy.push_back(unit.id);
-    }
+    if(unitColumns.tile[handle] >= 0)
+      unitsToDestroy.push_back(unitColumns.ids[handle]);
   }
 
   for(std::string const& unitId : unitsToDestroy)
@@ -519,16 +921,20 @@ void wars::Game::surrender(int playerNumber)
     destroyUnit(unitId);
   }
 
-  for(auto& item : tiles)
+  std::vector<int> const tilesToRelease = assets.tiles;
+  for(int handle : tilesToRelease)
   {
-    Tile& tile = item.second;
-    if(tile.owner == playerNumber)
-    {
-      tile.owner = NEUTRAL_PLAYER_NUMBER;
-    }
+    Tile& tile = tiles.at(tileColumns.ids[handle]);
+    tile.owner = NEUTRAL_PLAYER_NUMBER;
+    updateTileColumns(tile);
   }
 }
 
+void wars::Game::setFunds(int playerNumber, int funds)
+{
+  players.at(playerNumber).funds = funds;
+}
+
 wars::Game::Tile const & wars::Game::getTile(const std::string& tileId) const
 {
   return tiles.at(tileId);
@@ -539,6 +945,21 @@ wars::Game::Unit const& wars::Game::getUnit(const std::string& unitId) const
   return units.at(unitId);
 }
 
+wars::Game::Tile const& wars::Game::getTile(int handle) const
+{
+  return tiles.at(tileColumns.ids.at(handle));
+}
+
+wars::Game::Unit const& wars::Game::getUnit(int handle) const
+{
+  return units.at(unitColumns.ids.at(handle));
+}
+
+std::string const& wars::Game::getUnitId(int handle) const
+{
+  return unitColumns.ids.at(handle);
+}
+
 wars::Game::Player const& wars::Game::getPlayer(int playerNumber) const
 {
   return players.at(playerNumber);
@@ -559,6 +980,23 @@ const std::unordered_map<int, wars::Game::Player>& wars::Game::getPlayers() cons
   return players;
 }
 
+const wars::Game::TileColumns& wars::Game::getTileColumns() const
+{
+  return tileColumns;
+}
+
+const wars::Game::UnitColumns& wars::Game::getUnitColumns() const
+{
+  return unitColumns;
+}
+
+const wars::Game::PlayerAssets& wars::Game::getPlayerAssets(int playerNumber) const
+{
+  static PlayerAssets const none;
+  auto iter = playerAssets.find(playerNumber);
+  return iter != playerAssets.end() ? iter->second : none;
+}
+
 const wars::Rules& wars::Game::getRules() const
 {
   return rules;
@@ -569,17 +1007,37 @@ wars::Game::Player const& wars::Game::getInTurn()
   return players.at(inTurnNumber) ;
 }
 
+int wars::Game::getInTurnNumber() const
+{
+  return inTurnNumber;
+}
+
 const wars::Game::Tile* wars::Game::getTileAt(int x, int y) const
 {
-  for(auto const& item : tiles)
-  {
-    if(item.second.x == x && item.second.y == y)
-    {
-      return &item.second;
-    }
-  }
+  x -= tileColumns.minX;
+  y -= tileColumns.minY;
+  if(x < 0 || y < 0 || x >= tileColumns.width || y >= tileColumns.height)
+    return nullptr;
+
+  int const handle = tileColumns.grid[y * tileColumns.width + x];
+  return handle >= 0 ? &tiles.at(tileColumns.ids[handle]) : nullptr;
+}
+
+int wars::Game::gridCell(int x, int y) const
+{
+  x -= tileColumns.minX;
+  y -= tileColumns.minY;
+  if(x < 0 || y < 0 || x >= tileColumns.width || y >= tileColumns.height)
+    return -1;
+
+  return y * tileColumns.width + x;
+}
 
-  return nullptr;
+int wars::Game::neighborTile(int tile, int direction) const
+{
+  hex::Hex const& offset = hex::NEIGHBORS[direction];
+  int const cell = gridCell(tileColumns.x[tile] + offset.x, tileColumns.y[tile] + offset.y);
+  return cell >= 0 ? tileColumns.grid[cell] : -1;
 }
 
 const std::string& wars::Game::getGameId() const
@@ -589,31 +1047,17 @@ const std::string& wars::Game::getGameId() const
 
 int wars::Game::calculateDistance(const wars::Game::Coordinates& a, const wars::Game::Coordinates& b) const
 {
-  int distance = 0;
-  Coordinates aa = a;
-  Coordinates bb = b;
-
-  if(a.x < b.x && a.y > b.y)
-  {
-    int diagonal = std::min(b.x - a.x, a.y - b.y);
-    aa.x += diagonal;
-    aa.y -= diagonal;
-    distance += diagonal;
-  }
-  else if(a.x > b.x && a.y < b.y)
-  {
-    int diagonal = std::min(a.x - b.x, b.y - a.y);
-    bb.x += diagonal;
-    bb.y -= diagonal;
-    distance += diagonal;
-  }
-  distance += std::abs(bb.x - aa.x);
-  distance += std::abs(bb.y - aa.y);
-  return distance;
+  return hex::distance(b.x - a.x, b.y - a.y);
 }
 
 bool wars::Game::areAllies(int playerNumber1, int playerNumber2) const
 {
+  if(playerNumber1 >= 0 && playerNumber2 >= 0
+     && playerNumber1 < numAlliancePlayers && playerNumber2 < numAlliancePlayers)
+  {
+    return alliances[playerNumber1 * numAlliancePlayers + playerNumber2];
+  }
+
   if(playerNumber1 == 0)
   {
     return playerNumber2 == 0;
@@ -632,22 +1076,36 @@ bool wars::Game::areAllies(int playerNumber1, int playerNumber2) const
 
 wars::Game::Path wars::Game::findShortestPath(const wars::Game::Coordinates& a, const wars::Game::Coordinates& b) const
 {
-  std::map<Coordinates, Tile const*> grid;
-  for(auto const& item : tiles)
+  Path path;
+  findShortestPath(a, b, path);
+  return path;
+}
+
+void wars::Game::findShortestPath(const wars::Game::Coordinates& a, const wars::Game::Coordinates& b, wars::Game::Path& path) const
+{
+  path.clear();
+
+  int const startCell = gridCell(a.x, a.y);
+  int const endCell = gridCell(b.x, b.y);
+  if(startCell < 0 || endCell < 0 || tileColumns.grid[startCell] < 0 || tileColumns.grid[endCell] < 0)
   {
-    Coordinates pos = {item.second.x, item.second.y};
-    grid[pos] = &item.second;
+    return;
   }
 
-  if(grid.find(a) == grid.end() || grid.find(b) == grid.end())
+  // Long range queries are answered on the cluster graph
+  if(calculateDistance(a, b) > 2 * pathAbstraction->getClusterSize()
+     && pathAbstraction->findPath(*this, a, b, PathAbstraction::UNIFORM_COST, NEUTRAL_PLAYER_NUMBER, path))
   {
-    return {};
+    return;
   }
+
+  ArenaScope scope;
   typedef std::tuple<int, Coordinates, Coordinates, int> Node; // distance, tile, from, cost
-  std::vector<Node> nodes = {std::make_tuple(calculateDistance(a, b), a, a, 0)};
+  ScratchVector<Node> nodes;
+  nodes.push_back(std::make_tuple(calculateDistance(a, b), a, a, 0));
 
-  std::map<Coordinates, Node> visited;
-  Path path;
+  ScratchVector<Node> visitedNodes(tileColumns.grid.size());
+  ScratchVector<char> visited(tileColumns.grid.size(), 0);
 
   bool newNodes = false;
   while(!nodes.empty())
@@ -658,7 +1116,9 @@ wars::Game::Path wars::Game::findShortestPath(const wars::Game::Coordinates& a,
 
     // Add node to visited
     Coordinates pos = {std::get<1>(node).x, std::get<1>(node).y};
-    visited[pos] = node;
+    int const cell = gridCell(pos.x, pos.y);
+    visited[cell] = 1;
+    visitedNodes[cell] = node;
 
     // Check end condition
     if(pos == b)
@@ -667,22 +1127,23 @@ wars::Game::Path wars::Game::findShortestPath(const wars::Game::Coordinates& a,
       while(n != nullptr)
       {
         path.push_back(std::get<1>(*n));
-        n = std::get<1>(*n) == std::get<2>(*n) ? nullptr : &visited.at(std::get<2>(*n));
+        n = std::get<1>(*n) == std::get<2>(*n) ? nullptr : &visitedNodes[gridCell(std::get<2>(*n).x, std::get<2>(*n).y)];
       }
       std::reverse(path.begin(), path.end());
       break;
     }
     // Process neighbors
-    for(Coordinates neighborPos : neighborCoordinates(pos))
+    for(hex::Hex const& offset : hex::NEIGHBORS)
     {
-      auto iter = grid.find(neighborPos);
+      Coordinates const neighborPos = {pos.x + offset.x, pos.y + offset.y};
+      int const neighborCell = gridCell(neighborPos.x, neighborPos.y);
 
       // Reject if does not exist
-      if(iter == grid.end())
+      if(neighborCell < 0 || tileColumns.grid[neighborCell] < 0)
         continue;
 
       // Reject if visited
-      if(visited.find(neighborPos) != visited.end())
+      if(visited[neighborCell])
         continue;
 
       // Check if already in queue
@@ -709,37 +1170,59 @@ wars::Game::Path wars::Game::findShortestPath(const wars::Game::Coordinates& a,
 
     if(newNodes)
     {
-      std::stable_sort(nodes.begin(), nodes.end());
+      insertionSort(nodes.begin(), nodes.end());
     }
   }
-
-  return path;
 }
 
 wars::Game::Path wars::Game::findUnitPath(const std::string& unitId, const wars::Game::Coordinates& destination) const
 {
-  Unit const& unit = getUnit(unitId);
-  Tile const& startTile = getTile(unit.tileId);
+  Path path;
+  findUnitPath(unitId, destination, path);
+  return path;
+}
+
+void wars::Game::findUnitPath(const std::string& unitId, const wars::Game::Coordinates& destination, wars::Game::Path& path) const
+{
+  path.clear();
+
+  Unit const& unit = getUnit(unitId);
+  Tile const& startTile = getTile(unit.tileId);
   Coordinates const start = {startTile.x, startTile.y};
   UnitType const& unitType = rules.unitTypes.at(unit.type);
   MovementType const& movementType = rules.movementTypes.at(unitType.movementType);
 
-  std::map<Coordinates, Tile const*> grid;
-  for(auto const& item : tiles)
+  int const endCell = gridCell(destination.x, destination.y);
+  if(endCell < 0 || tileColumns.grid[endCell] < 0)
   {
-    Coordinates pos = {item.second.x, item.second.y};
-    grid[pos] = &item.second;
+    return;
   }
 
-  if(grid.find(destination) == grid.end())
+  // Long range queries are answered on the cluster graph if the path found
+  // fits the movement points, which it may not as it isn't always the cheapest
+  int const distance = calculateDistance(start, destination);
+  if(distance > 2 * pathAbstraction->getClusterSize() && distance <= unitType.movement
+     && pathAbstraction->findPath(*this, start, destination, unitType.movementType, unit.owner, path))
   {
-    return {};
+    int cost = 0;
+    for(unsigned int i = 1; i < path.size(); ++i)
+    {
+      cost += movementCost(movementType, tileColumns.type[tileColumns.grid[gridCell(path[i].x, path[i].y)]]);
+    }
+
+    if(cost <= unitType.movement)
+      return;
+
+    path.clear();
   }
+
+  ArenaScope scope;
   typedef std::tuple<int, Coordinates, Coordinates, int> Node; // distance, tile, from, cost
-  std::vector<Node> nodes = {std::make_tuple(calculateDistance(start, destination), start, start, 0)};
+  ScratchVector<Node> nodes;
+  nodes.push_back(std::make_tuple(calculateDistance(start, destination), start, start, 0));
 
-  std::map<Coordinates, Node> visited;
-  Path path;
+  ScratchVector<Node> visitedNodes(tileColumns.grid.size());
+  ScratchVector<char> visited(tileColumns.grid.size(), 0);
 
   bool newNodes = false;
   while(!nodes.empty())
@@ -750,7 +1233,9 @@ wars::Game::Path wars::Game::findUnitPath(const std::string& unitId, const wars:
 
     // Add node to visited
     Coordinates pos = {std::get<1>(node).x, std::get<1>(node).y};
-    visited[pos] = node;
+    int const cell = gridCell(pos.x, pos.y);
+    visited[cell] = 1;
+    visitedNodes[cell] = node;
 
     // Check end condition
     if(pos == destination)
@@ -759,32 +1244,28 @@ wars::Game::Path wars::Game::findUnitPath(const std::string& unitId, const wars:
       while(n != nullptr)
       {
         path.push_back(std::get<1>(*n));
-        n = std::get<1>(*n) == std::get<2>(*n) ? nullptr : &visited.at(std::get<2>(*n));
+        n = std::get<1>(*n) == std::get<2>(*n) ? nullptr : &visitedNodes[gridCell(std::get<2>(*n).x, std::get<2>(*n).y)];
       }
       std::reverse(path.begin(), path.end());
       break;
     }
     // Process neighbors
-    for(Coordinates neighborPos : neighborCoordinates(pos))
+    for(hex::Hex const& offset : hex::NEIGHBORS)
     {
-      auto iter = grid.find(neighborPos);
+      Coordinates const neighborPos = {pos.x + offset.x, pos.y + offset.y};
+      int const neighborCell = gridCell(neighborPos.x, neighborPos.y);
+      int const tile = neighborCell >= 0 ? tileColumns.grid[neighborCell] : -1;
 
       // Reject if does not exist
-      if(iter == grid.end())
+      if(tile < 0)
         continue;
 
       // Reject if visited
-      if(visited.find(neighborPos) != visited.end())
+      if(visited[neighborCell])
         continue;
 
       // Determine cost
-      Tile const* tile = iter->second;
-      int tileCost = 1;
-      auto effectIter = movementType.effectMap.find(tile->type);
-      if(effectIter != movementType.effectMap.end())
-      {
-        tileCost = effectIter->second;
-      }
+      int tileCost = movementCost(movementType, tileColumns.type[tile]);
 
       // Reject if cannot traverse
       if(tileCost < 0)
@@ -797,7 +1278,8 @@ wars::Game::Path wars::Game::findUnitPath(const std::string& unitId, const wars:
         continue;
 
       // Reject if contains enemy unit
-      if(!tile->unitId.empty() && !areAllies(unit.owner, getUnit(tile->unitId).owner))
+      int const tileUnit = tileColumns.unit[tile];
+      if(tileUnit >= 0 && !areAllies(unit.owner, unitColumns.owner[tileUnit]))
         continue;
 
       // Check if already in queue
@@ -821,44 +1303,45 @@ wars::Game::Path wars::Game::findUnitPath(const std::string& unitId, const wars:
 
     if(newNodes)
     {
-      std::stable_sort(nodes.begin(), nodes.end());
+      insertionSort(nodes.begin(), nodes.end());
     }
   }
-
-  return path;
 }
 
 std::vector<wars::Game::Coordinates> wars::Game::neighborCoordinates(const wars::Game::Coordinates& pos) const
 {
-  return {
-    {pos.x + 1, pos.y},
-    {pos.x - 1, pos.y},
-    {pos.x, pos.y + 1},
-    {pos.x, pos.y - 1},
-    {pos.x + 1, pos.y - 1},
-    {pos.x - 1, pos.y + 1},
-  };
+  std::vector<Coordinates> result;
+  for(hex::Hex const& offset : hex::NEIGHBORS)
+  {
+    result.push_back({pos.x + offset.x, pos.y + offset.y});
+  }
+  return result;
 }
 
 std::vector<wars::Game::Coordinates> wars::Game::findMovementOptions(const std::string& unitId) const
 {
+  std::vector<Coordinates> result;
+  findMovementOptions(unitId, result);
+  return result;
+}
+
+void wars::Game::findMovementOptions(const std::string& unitId, std::vector<wars::Game::Coordinates>& result) const
+{
+  result.clear();
+
   Unit const& unit = getUnit(unitId);
   Tile const& startTile = getTile(unit.tileId);
   Coordinates const start = {startTile.x, startTile.y};
   UnitType const& unitType = rules.unitTypes.at(unit.type);
   MovementType const& movementType = rules.movementTypes.at(unitType.movementType);
 
-  std::map<Coordinates, Tile const*> grid;
-  for(auto const& item : tiles)
-  {
-    Coordinates pos = {item.second.x, item.second.y};
-    grid[pos] = &item.second;
-  }
-
+  ArenaScope scope;
   typedef std::tuple<int, Coordinates, Coordinates> Node; // cost, tile, from
-  std::vector<Node> nodes = {std::make_tuple(0, start, start)};
+  ScratchVector<Node> nodes;
+  nodes.push_back(std::make_tuple(0, start, start));
 
-  std::map<Coordinates, Node> visited;
+  ScratchVector<Node> visitedNodes(tileColumns.grid.size());
+  ScratchVector<char> visited(tileColumns.grid.size(), 0);
 
   while(!nodes.empty())
   {
@@ -868,25 +1351,23 @@ std::vector<wars::Game::Coordinates> wars::Game::findMovementOptions(const std::
 
     // Add node to visited
     Coordinates pos = {std::get<1>(node).x, std::get<1>(node).y};
-    visited[pos] = node;
+    int const cell = gridCell(pos.x, pos.y);
+    visited[cell] = 1;
+    visitedNodes[cell] = node;
 
     // Process neighbors
-    for(Coordinates neighborPos : neighborCoordinates(pos))
+    for(hex::Hex const& offset : hex::NEIGHBORS)
     {
-      auto iter = grid.find(neighborPos);
+      Coordinates const neighborPos = {pos.x + offset.x, pos.y + offset.y};
+      int const neighborCell = gridCell(neighborPos.x, neighborPos.y);
+      int const tile = neighborCell >= 0 ? tileColumns.grid[neighborCell] : -1;
 
       // Reject if does not exist
-      if(iter == grid.end())
+      if(tile < 0)
         continue;
 
       // Determine cost
-      Tile const* tile = iter->second;
-      int tileCost = 1;
-      auto effectIter = movementType.effectMap.find(tile->type);
-      if(effectIter != movementType.effectMap.end())
-      {
-        tileCost = effectIter->second;
-      }
+      int tileCost = movementCost(movementType, tileColumns.type[tile]);
 
       // Reject if cannot traverse
       if(tileCost < 0)
@@ -899,12 +1380,12 @@ std::vector<wars::Game::Coordinates> wars::Game::findMovementOptions(const std::
         continue;
 
       // Reject if contains enemy unit
-      if(!tile->unitId.empty() && !areAllies(unit.owner, getUnit(tile->unitId).owner))
+      int const tileUnit = tileColumns.unit[tile];
+      if(tileUnit >= 0 && !areAllies(unit.owner, unitColumns.owner[tileUnit]))
         continue;
 
       // Check if shorter route to already visited
-      auto visitedIter = visited.find(neighborPos);
-      if(visitedIter != visited.end() && std::get<0>(visitedIter->second) < cost)
+      if(visited[neighborCell] && std::get<0>(visitedNodes[neighborCell]) < cost)
         continue;
 
       // Check if already in queue
@@ -925,16 +1406,17 @@ std::vector<wars::Game::Coordinates> wars::Game::findMovementOptions(const std::
     }
   }
 
-  std::vector<Coordinates> result;
-  for(auto const& item : visited)
+  // Visited cells are in row order, the same order as sorted coordinates
+  for(unsigned int cell = 0; cell < visited.size(); ++cell)
   {
-    Coordinates const& pos = item.first;
+    if(!visited[cell])
+      continue;
 
     // Skip if tile has a unit that cannot carry this one and isn't self
-    Tile const* tile = grid.at(pos);
-    if(!tile->unitId.empty() && tile->unitId != unitId)
+    int const occupant = tileColumns.unit[tileColumns.grid[cell]];
+    if(occupant >= 0 && occupant != unit.handle)
     {
-      Unit const& tileUnit = getUnit(tile->unitId);
+      Unit const& tileUnit = getUnit(unitColumns.ids[occupant]);
       UnitType const& tileUnitType = rules.unitTypes.at(tileUnit.type);
       if(tileUnit.owner != unit.owner
          || tileUnit.carriedUnits.size() >= tileUnitType.carryNum
@@ -944,10 +1426,8 @@ std::vector<wars::Game::Coordinates> wars::Game::findMovementOptions(const std::
       }
     }
 
-    result.push_back(pos);
+    result.push_back(std::get<1>(visitedNodes[cell]));
   }
-
-  return result;
 }
 
 int wars::Game::calculateWeaponPower(Weapon const& weapon, int armorId, int distance) const
@@ -963,11 +1443,9 @@ int wars::Game::calculateWeaponPower(Weapon const& weapon, int armorId, int dist
   return powerIter->second * efficiencyIter->second / 100;
 }
 
-int wars::Game::calculateAttackDamage(UnitType const& attackerType, int attackerHealth, bool attackerDeployed,
-                                      UnitType const& targetType, int targetHealth, int distance, int targetTerrainId) const
+int wars::Game::calculateAttackPower(UnitType const& attackerType, bool attackerDeployed, int armorId, int distance) const
 {
-
-  // Calculate best attack power
+  // Best power of the usable weapons, -1 if none can attack
   int power = -1;
   int weaponIds[] = {attackerType.primaryWeapon, attackerType.secondaryWeapon};
   for(int weaponId : weaponIds)
@@ -980,18 +1458,32 @@ int wars::Game::calculateAttackDamage(UnitType const& attackerType, int attacker
     if(weapon.requireDeployed && !attackerDeployed)
       continue;
 
-    int weaponPower = calculateWeaponPower(weapon, targetType.armor, distance);
+    int weaponPower = calculateWeaponPower(weapon, armorId, distance);
     power = std::max(power, weaponPower);
   }
 
+  return power;
+}
+
+int wars::Game::calculateDefense(UnitType const& targetType, int terrainId) const
+{
+  auto defenseIter = targetType.defenseMap.find(terrainId);
+  return defenseIter != targetType.defenseMap.end() ? defenseIter->second : rules.terrainTypes.at(terrainId).defense;
+}
+
+int wars::Game::calculateAttackDamage(UnitType const& attackerType, int attackerHealth, bool attackerDeployed,
+                                      UnitType const& targetType, int targetHealth, int distance, int targetTerrainId) const
+{
+
+  // Calculate best attack power
+  int power = calculateAttackPower(attackerType, attackerDeployed, targetType.armor, distance);
+
   // Reject if cannot attack
   if(power < 0)
     return -1;
 
   // Determine enemy defense
-  TerrainType const& targetTerrain = rules.terrainTypes.at(targetTerrainId);
-  auto defenseIter = targetType.defenseMap.find(targetTerrainId);
-  int defense = defenseIter != targetType.defenseMap.end() ? defenseIter->second : targetTerrain.defense;
+  int defense = calculateDefense(targetType, targetTerrainId);
 
   // Calculate damage
   int damage = attackerHealth * power * (100 - (defense * targetHealth / 100)) / 100 / 100;
@@ -1001,12 +1493,32 @@ int wars::Game::calculateAttackDamage(UnitType const& attackerType, int attacker
 }
 
 std::unordered_map<std::string, int> wars::Game::findAttackOptions(const std::string& unitId, const wars::Game::Coordinates& position) const
+{
+  ArenaScope scope;
+  ScratchVector<AttackTarget> targets;
+  findAttackTargets(getUnit(unitId), position, targets);
+
+  std::unordered_map<std::string, int> result;
+  for(AttackTarget const& target : targets)
+  {
+    result[unitColumns.ids[target.unit]] = target.damage;
+  }
+  return result;
+}
+
+void wars::Game::findAttackOptions(const std::string& unitId, const wars::Game::Coordinates& position, std::vector<wars::Game::AttackTarget>& result) const
+{
+  ArenaScope scope;
+  ScratchVector<AttackTarget> targets;
+  findAttackTargets(getUnit(unitId), position, targets);
+  result.assign(targets.begin(), targets.end());
+}
+
+void wars::Game::findAttackTargets(const wars::Game::Unit& unit, const wars::Game::Coordinates& position, wars::ScratchVector<wars::Game::AttackTarget>& result) const
 {
   int minRange = -1;
   int maxRange = -1;
 
-  Unit const& unit = getUnit(unitId);
-
   UnitType const& unitType = rules.unitTypes.at(unit.type);
   int weaponIds[] = {unitType.primaryWeapon, unitType.secondaryWeapon};
 
@@ -1030,38 +1542,98 @@ std::unordered_map<std::string, int> wars::Game::findAttackOptions(const std::st
 
   // Return empty set if no usable weapons
   if(minRange < 0 || maxRange < 0)
-    return std::unordered_map<std::string, int>();
+    return;
 
-  // Find attackable units and damages
-  std::unordered_map<std::string, int> result;
-  for(auto const& item : tiles)
+  // Gather enemy units as candidate targets, from the enemy unit lists when
+  // they are shorter than the number of hexes within range
+  unsigned int enemyCount = 0;
+  for(auto const& item : playerAssets)
   {
-    // Reject if no unit
-    Tile const& enemyTile = item.second;
-    if(enemyTile.unitId.empty())
-      continue;
+    if(!areAllies(unit.owner, item.first))
+      enemyCount += item.second.units.size();
+  }
 
-    // Reject if out of range
-    int distance = calculateDistance(position, {enemyTile.x, enemyTile.y});
-    if(distance < minRange && distance > maxRange)
-      continue;
+  unsigned int const area = 3 * maxRange * (maxRange + 1) + 1;
+  ScratchVector<int> targets;
+  ScratchVector<int> xs;
+  ScratchVector<int> ys;
+  targets.reserve(std::min(enemyCount, area));
+  xs.reserve(targets.capacity());
+  ys.reserve(targets.capacity());
 
-    // Reject if unit is ally
-    Unit const& enemy = getUnit(enemyTile.unitId);
-    if(areAllies(unit.owner, enemy.owner))
-      continue;
+  if(enemyCount < area)
+  {
+    for(auto const& item : playerAssets)
+    {
+      if(areAllies(unit.owner, item.first))
+        continue;
+
+      for(int enemy : item.second.units)
+      {
+        int const i = unitColumns.tile[enemy];
+        if(i < 0)
+          continue;
 
-    UnitType enemyType = rules.unitTypes.at(enemy.type);
+        targets.push_back(enemy);
+        xs.push_back(tileColumns.x[i]);
+        ys.push_back(tileColumns.y[i]);
+      }
+    }
+  }
+  else
+  {
+    hex::Spiral const spiral({position.x, position.y}, minRange, maxRange);
+    for(auto iter = spiral.begin(); iter != spiral.end(); ++iter)
+    {
+      int const x = (*iter).x - tileColumns.minX;
+      int const y = (*iter).y - tileColumns.minY;
+      if(x < 0 || y < 0 || x >= tileColumns.width || y >= tileColumns.height)
+        continue;
+
+      // Reject if no tile, no unit or unit is ally
+      int const i = tileColumns.grid[y * tileColumns.width + x];
+      int const enemy = i >= 0 ? tileColumns.unit[i] : -1;
+      if(enemy < 0 || areAllies(unit.owner, unitColumns.owner[enemy]))
+        continue;
+
+      targets.push_back(enemy);
+      xs.push_back((*iter).x);
+      ys.push_back((*iter).y);
+    }
+  }
 
-    // Calculate damage
-    int damage = calculateAttackDamage(unitType, unit.health, unit.deployed, enemyType, enemy.health, distance, enemyTile.type);
+  ScratchVector<int> distances(targets.size());
+  batch::distances(position.x, position.y, xs.data(), ys.data(), targets.size(), distances.data());
 
-    // Add result if attack is possible
-    if(damage >= 0)
-      result[enemy.id] = damage;
+  // Look up powers and defenses for targets within range
+  unsigned int count = 0;
+  ScratchVector<int> powers(targets.size());
+  ScratchVector<int> defenses(targets.size());
+  ScratchVector<int> healths(targets.size());
+  for(unsigned int k = 0; k < targets.size(); ++k)
+  {
+    if(distances[k] < minRange || distances[k] > maxRange)
+      continue;
+
+    int const enemy = targets[k];
+    UnitType const& enemyType = rules.unitTypes.at(unitColumns.type[enemy]);
+    targets[count] = enemy;
+    powers[count] = calculateAttackPower(unitType, unit.deployed, enemyType.armor, distances[k]);
+    defenses[count] = calculateDefense(enemyType, tileColumns.type[unitColumns.tile[enemy]]);
+    healths[count] = unitColumns.health[enemy];
+    ++count;
   }
 
-  return result;
+  // Calculate damages
+  ScratchVector<int> damages(count);
+  batch::damages(unit.health, powers.data(), defenses.data(), healths.data(), count, damages.data());
+
+  // Add results where attack is possible
+  for(unsigned int k = 0; k < count; ++k)
+  {
+    if(damages[k] >= 0)
+      result.push_back({targets[k], damages[k]});
+  }
 }
 
 bool wars::Game::unitCanLoadInto(const std::string& unitId, const std::string& carrierId) const
@@ -1086,7 +1658,10 @@ bool wars::Game::unitCanAttackFromTile(const std::string& unitId, const std::str
   if(!tile.unitId.empty() && tile.unitId != unitId)
     return false;
 
-  return !findAttackOptions(unitId, {tile.x, tile.y}).empty();
+  ArenaScope scope;
+  ScratchVector<AttackTarget> targets;
+  findAttackTargets(getUnit(unitId), {tile.x, tile.y}, targets);
+  return !targets.empty();
 }
 
 bool wars::Game::unitCanCaptureTile(const std::string& unitId, const std::string& tileId) const
@@ -1117,23 +1692,7 @@ bool wars::Game::unitCanCaptureTile(const std::string& unitId, const std::string
   if(!canCapture)
     return false;
 
-  TerrainType const& tileType = rules.terrainTypes.at(tile.type);
-
-  bool capturable = false;
-  for(int terrainFlagId : tileType.flags)
-  {
-    TerrainFlag const& flag = rules.terrainFlags.at(terrainFlagId);
-    if(flag.name == "Capturable")
-    {
-      capturable = true;
-      break;
-    }
-  }
-
-  if(!capturable)
-    return false;
-
-  return true;
+  return bitboards.capturable.test(tile.x, tile.y);
 }
 
 bool wars::Game::unitCanDeployAtTile(const std::string& unitId, const std::string& tileId) const
@@ -1171,26 +1730,27 @@ bool wars::Game::unitCanUnloadAtTile(const std::string& unitId, const std::strin
     return false;
 
   Tile const& tile = getTile(tileId);
-  std::vector<Coordinates> unloadCoordinates = neighborCoordinates({tile.x, tile.y});
-  std::vector<Tile const*> unloadTiles;
+  Tile const* unloadTiles[6];
+  int numUnloadTiles = 0;
 
-  for(Coordinates const& c : unloadCoordinates)
+  for(hex::Hex const& offset : hex::NEIGHBORS)
   {
-    Tile const* t = getTileAt(c.x, c.y);
+    Tile const* t = getTileAt(tile.x + offset.x, tile.y + offset.y);
     if(t != nullptr)
     {
-      unloadTiles.push_back(t);
+      unloadTiles[numUnloadTiles++] = t;
     }
   }
 
-  for(std::string carriedId : unit.carriedUnits)
+  for(std::string const& carriedId : unit.carriedUnits)
   {
     Unit const& carried = getUnit(carriedId);
     UnitType const& carriedType = rules.unitTypes.at(carried.type);
     MovementType const& carriedMovementType = rules.movementTypes.at(carriedType.movementType);
 
-    for(Tile const* t : unloadTiles)
+    for(int i = 0; i < numUnloadTiles; ++i)
     {
+      Tile const* t = unloadTiles[i];
       auto effectIter = carriedMovementType.effectMap.find(t->type);
       if(effectIter == carriedMovementType.effectMap.end() || effectIter->second >= 0)
       {
@@ -1236,181 +1796,1182 @@ bool wars::Game::unitCanUnloadUnitFromTileToCoordinates(const std::string& unitI
 
 std::vector<wars::Game::Coordinates> wars::Game::unitUnloadUnitFromTileOptions(std::string const& unitId, std::string const& carriedId, std::string const& tileId) const
 {
+  std::vector<Coordinates> result;
+  unitUnloadUnitFromTileOptions(unitId, carriedId, tileId, result);
+  return result;
+}
+
+void wars::Game::unitUnloadUnitFromTileOptions(std::string const& unitId, std::string const& carriedId, std::string const& tileId, std::vector<wars::Game::Coordinates>& result) const
+{
+  result.clear();
+
   Unit const& unit = getUnit(unitId);
 
   // Reject if carried is not being carried by unit
   if(std::find(unit.carriedUnits.begin(), unit.carriedUnits.end(), carriedId) == unit.carriedUnits.end())
-    return {};
+    return;
 
   Tile const& tile = getTile(tileId);
-  std::vector<Coordinates> unloadCoordinates = neighborCoordinates({tile.x, tile.y});
-  std::vector<Tile const*> unloadTiles;
-
-  // Determine adjacent tiles
-  for(Coordinates const& c : unloadCoordinates)
-  {
-    Tile const* t = getTileAt(c.x, c.y);
-    if(t != nullptr)
-    {
-      unloadTiles.push_back(t);
-    }
-  }
-
-
   Unit const& carried = getUnit(carriedId);
   UnitType const& carriedType = rules.unitTypes.at(carried.type);
   MovementType const& carriedMovementType = rules.movementTypes.at(carriedType.movementType);
 
-  // Find tiles carried can be unloaded to
-  std::vector<Coordinates> result;
-  for(Tile const* t : unloadTiles)
+  // Find adjacent tiles carried can be unloaded to
+  for(hex::Hex const& offset : hex::NEIGHBORS)
   {
-    auto effectIter = carriedMovementType.effectMap.find(t->type);
-    if(effectIter == carriedMovementType.effectMap.end() || effectIter->second >= 0)
+    Tile const* t = getTileAt(tile.x + offset.x, tile.y + offset.y);
+    if(t != nullptr && movementCost(carriedMovementType, t->type) >= 0)
     {
       result.push_back({t->x, t->y});
     }
   }
-
-  return result;
 }
 
-std::string wars::Game::updateTileFromJSON(const json::Value& value)
+wars::Game::ActionOptions wars::Game::findActionOptions(const std::string& unitId, const std::string& tileId) const
 {
-  Tile tile;
-  tile.id = value.get("tileId").stringValue();
-  tile.x = value.get("x").longValue();
-  tile.y = value.get("y").longValue();
-  tile.type = value.get("type").longValue();
-  tile.subtype = value.get("subtype").longValue();
-  tile.owner = value.get("owner").longValue();
-  tile.capturePoints = value.get("capturePoints").longValue();
-  tile.beingCaptured = value.get("beingCaptured").booleanValue();
-  tile.unitId = parseStringOrNull(value.get("unitId"), "");
+  ActionOptions options;
 
-  if(!tile.unitId.empty())
-  {
-    updateUnitFromJSON(value.get("unit"));
-  }
+  Unit const& unit = getUnit(unitId);
+  Tile const& tile = getTile(tileId);
+  UnitType const& unitType = rules.unitTypes.at(unit.type);
 
-  tiles[tile.id] = tile;
-  return tile.id;
-}
+  auto setAction = [&options](UnitAction action) {
+    options.actions.set(static_cast<int>(action));
+  };
 
-std::string wars::Game::updateUnitFromJSON(const json::Value& value)
-{
-  std::string unitId = value.get("unitId").stringValue();
+  bool const canLoad = unitCanLoadInto(unitId, tile.unitId);
+  bool const tileFree = tile.unitId.empty() || tile.unitId == unitId;
 
-  auto iter = units.find(unitId);
-  if(iter == units.end())
+  if(canLoad)
+    setAction(UnitAction::LOAD);
+  else
+    setAction(UnitAction::WAIT);
+
+  if(tileFree)
   {
-    Unit u;
-    u.id = unitId;
-    u.health = 100;
-    u.deployed = false;
-    u.capturing = false;
-    units[unitId] = u;
-  }
-  Unit& unit =  units[unitId];
+    options.attackTargets = findAttackOptions(unitId, {tile.x, tile.y});
+    if(!options.attackTargets.empty())
+      setAction(UnitAction::ATTACK);
 
-  if(value.has("owner"))
-    unit.owner = value.get("owner").longValue();
-  if(value.has("type"))
-    unit.type = value.get("type").longValue();
-  if(value.has("tileId"))
-    unit.tileId = parseStringOrNull(value.get("tileId"), "");
-  if(value.has("carriedBy"))
-    unit.carriedBy = parseStringOrNull(value.get("carriedBy"), "");
-  if(value.has("health"))
-    unit.health = value.get("health").longValue();
-  if(value.has("deployed"))
-    unit.deployed = value.get("deployed").booleanValue();
-  if(value.has("moved"))
-    unit.moved = value.get("moved").booleanValue();
-  if(value.has("capturing"))
-    unit.capturing = value.get("capturing").booleanValue();
+    bool canCapture = false;
+    for(int unitFlagId : unitType.flags)
+    {
+      canCapture |= rules.unitFlags.at(unitFlagId).name == "Capture";
+    }
 
-  if(value.has("carriedUnits"))
+    if(canCapture && !areAllies(unit.owner, tile.owner) && bitboards.capturable.test(tile.x, tile.y))
+      setAction(UnitAction::CAPTURE);
+  }
+
+  if(tile.unitId.empty() && !unit.deployed)
   {
-    json::Value carriedUnits = value.get("carriedUnits");
-    unsigned int numCarriedUnits = carriedUnits.size();
-    for(unsigned int i = 0; i < numCarriedUnits; ++i)
+    int weaponIds[] = {unitType.primaryWeapon, unitType.secondaryWeapon};
+    for(int weaponId : weaponIds)
     {
-      json::Value carriedUnit = carriedUnits.at(i);
-      std::string carriedUnitId = updateUnitFromJSON(carriedUnit);
-      unit.carriedUnits.push_back(carriedUnitId);
+      if(weaponId >= 0 && rules.weapons.at(weaponId).requireDeployed)
+        setAction(UnitAction::DEPLOY);
     }
   }
-  return unit.id;
-}
 
-int wars::Game::updatePlayerFromJSON(const json::Value& value)
-{
-  int playerNumber = value.get("playerNumber").longValue();
+  if(unit.deployed)
+    setAction(UnitAction::UNDEPLOY);
 
-  auto iter = players.find(playerNumber);
-  if(iter == players.end())
+  // Unload if any carried unit could stand on a neighboring tile
+  if(!unit.carriedUnits.empty())
   {
-    Player p;
-    p.playerNumber = playerNumber;
-    players[playerNumber] = p;
-  }
-  Player& player =  players[playerNumber];
+    Tile const* unloadTiles[6];
+    int numUnloadTiles = 0;
+    for(hex::Hex const& offset : hex::NEIGHBORS)
+    {
+      Tile const* t = getTileAt(tile.x + offset.x, tile.y + offset.y);
+      if(t != nullptr)
+        unloadTiles[numUnloadTiles++] = t;
+    }
 
-  if(value.has("_id"))
-    player.id = value.get("_id").stringValue();
-  if(value.has("userId"))
-    player.userId = parseStringOrNull(value.get("userId"), "");
-  if(value.has("playerName"))
-    player.playerName = parseStringOrNull(value.get("playerName"), "");
-  if(value.has("teamNumber"))
-    player.teamNumber = value.get("teamNumber").longValue();
-  if(value.get("funds").type() == json::Value::Type::NUMBER)
-    player.funds = value.get("funds").longValue();
-  if(value.has("score"))
-    player.score = value.get("score").longValue();
-  if(value.has("isMe"))
-    player.isMe = value.get("isMe").booleanValue();
-  if(value.get("settings").type() == json::Value::Type::OBJECT)
-  {
-    json::Value settings = value.get("settings");
-    if(settings.has("emailNotifications"))
-      player.emailNotifications = settings.get("emailNotifications").booleanValue();
-    if(settings.has("hidden"))
-      player.hidden = settings.get("hidden").booleanValue();
+    for(std::string const& carriedId : unit.carriedUnits)
+    {
+      UnitType const& carriedType = rules.unitTypes.at(getUnit(carriedId).type);
+      MovementType const& carriedMovementType = rules.movementTypes.at(carriedType.movementType);
+      for(int i = 0; i < numUnloadTiles; ++i)
+      {
+        if(movementCost(carriedMovementType, unloadTiles[i]->type) >= 0)
+          setAction(UnitAction::UNLOAD);
+      }
+    }
   }
 
-  return playerNumber;
+  return options;
 }
 
-namespace
+wars::Game::TransportPlan wars::Game::findTransportPlan(const std::string& unitId, const wars::Game::Coordinates& destination) const
 {
-  template<typename T>
-  std::unordered_map<int, T> parseAll(json::Value const& v)
+  Unit const& unit = getUnit(unitId);
+  UnitType const& unitType = rules.unitTypes.at(unit.type);
+  MovementType const& movementType = rules.movementTypes.at(unitType.movementType);
+
+  // States are indexed by tile handle
+  int const goalCell = gridCell(destination.x, destination.y);
+  int const goal = goalCell >= 0 ? tileColumns.grid[goalCell] : -1;
+  if(goal < 0)
+    return {};
+
+  int const numTiles = tileColumns.ids.size();
+
+  ArenaScope scope;
+
+  // Mode 0 is walking, mode n is being carried by carriers[n - 1]
+  ScratchVector<Unit const*> carriers;
+  ScratchVector<int> carrierTiles;
+  for(auto const& item : units)
   {
-    std::unordered_map<int, T> result;
-    std::vector<std::string> ids = v.properties();
-    for(std::string id : ids)
+    Unit const& carrier = item.second;
+    if(carrier.tileId.empty())
+      continue;
+
+    if(carrier.id == unit.carriedBy || unitCanLoadInto(unitId, carrier.id))
     {
-      json::Value json = v.get(id.data());
-      T t = parse<T>(json);
-      result[t.id] = t;
+      carriers.push_back(&carrier);
+      carrierTiles.push_back(tileHandle(carrier.tileId));
     }
-    return result;
   }
 
-  template<>
-  wars::Weapon parse(json::Value const& v)
-  {
-    wars::Weapon weapon;
-    weapon.id = v.get("id").longValue();
-    weapon.name = v.get("name").stringValue();
-    weapon.requireDeployed = v.get("requireDeployed").booleanValue();
+  auto isEnemyOccupied = [this, &unit](int tile) {
+    int const tileUnit = tileColumns.unit[tile];
+    return tileUnit >= 0 && !areAllies(unit.owner, unitColumns.owner[tileUnit]);
+  };
 
-    weapon.powerMap = parseIntIntMap(v.get("powerMap"));
-    weapon.rangeMap = parseIntIntMap(v.get("rangeMap"));
+  // Units may pass through allies but only stop on free tiles
+  auto canStop = [this, &unit](int tile, int carrier) {
+    int const tileUnit = tileColumns.unit[tile];
+    return tileUnit < 0 || tileUnit == unit.handle || tileUnit == carrier;
+  };
 
-    return weapon;
+  int const numStates = numTiles * (carriers.size() + 1);
+  ScratchVector<int> turns(numStates, std::numeric_limits<int>::max());
+  ScratchVector<int> spent(numStates, 0);
+  ScratchVector<int> parents(numStates, -1);
+
+  typedef std::tuple<int, int, int> QueueItem; // turn, spent movement, state
+  std::priority_queue<QueueItem, ScratchVector<QueueItem>, std::greater<QueueItem>> queue;
+
+  auto relax = [&](int state, int turn, int movement, int parent) {
+    if(std::make_pair(turn, movement) < std::make_pair(turns[state], spent[state]))
+    {
+      turns[state] = turn;
+      spent[state] = movement;
+      parents[state] = parent;
+      queue.push(std::make_tuple(turn, movement, state));
+    }
+  };
+
+  int start = -1;
+  if(unit.carriedBy.empty())
+  {
+    start = tileHandle(unit.tileId);
+  }
+  else
+  {
+    // Reject if the carrier is carried itself
+    int mode = std::find_if(carriers.begin(), carriers.end(), [&unit](Unit const* c) { return c->id == unit.carriedBy; }) - carriers.begin();
+    if(mode == static_cast<int>(carriers.size()))
+      return {};
+
+    start = (mode + 1) * numTiles + carrierTiles[mode];
+  }
+
+  // Reject if already there or destination is taken
+  if(start == goal || !canStop(goal, -1))
+    return {};
+
+  relax(start, unit.moved ? 1 : 0, 0, -1);
+
+  bool found = false;
+  while(!queue.empty())
+  {
+    int turn, movement, state;
+    std::tie(turn, movement, state) = queue.top();
+    queue.pop();
+
+    // Skip stale queue entries
+    if(turn != turns[state] || movement != spent[state])
+      continue;
+
+    int const mode = state / numTiles;
+    int const tile = state % numTiles;
+
+    // Check end condition
+    if(state == goal)
+    {
+      found = true;
+      break;
+    }
+
+    Unit const* carrier = mode > 0 ? carriers[mode - 1] : nullptr;
+    UnitType const& moverType = carrier ? rules.unitTypes.at(carrier->type) : unitType;
+    MovementType const& moverMovementType = carrier ? rules.movementTypes.at(moverType.movementType) : movementType;
+    int const mover = carrier ? carrier->handle : unit.handle;
+
+    // Process neighbors
+    for(int direction = 0; direction < 6; ++direction)
+    {
+      // Reject if does not exist
+      int const neighbor = neighborTile(tile, direction);
+      if(neighbor < 0)
+        continue;
+
+      // Reject if cannot traverse
+      int cost = movementCost(moverMovementType, tileColumns.type[neighbor]);
+      if(cost < 0 || cost > moverType.movement)
+        continue;
+
+      // Reject if contains enemy unit
+      if(isEnemyOccupied(neighbor))
+        continue;
+
+      // Continue next turn if out of movement points, which requires stopping here
+      int nextTurn = turn;
+      int nextMovement = movement + cost;
+      if(nextMovement > moverType.movement)
+      {
+        if(!canStop(tile, mover))
+          continue;
+
+        nextTurn += 1;
+        nextMovement = cost;
+      }
+
+      relax(mode * numTiles + neighbor, nextTurn, nextMovement, state);
+    }
+
+    if(mode == 0)
+    {
+      // Load into carriers standing here, carrier moves on with fresh movement points
+      for(unsigned int i = 0; i < carriers.size(); ++i)
+      {
+        if(carrierTiles[i] == tile)
+          relax((i + 1) * numTiles + tile, turn, 0, state);
+      }
+    }
+    else if(canStop(tile, mover) && movementCost(movementType, tileColumns.type[tile]) >= 0)
+    {
+      // Unload to free adjacent tiles, unloaded unit can move again next turn
+      for(int direction = 0; direction < 6; ++direction)
+      {
+        int const neighbor = neighborTile(tile, direction);
+        if(neighbor < 0)
+          continue;
+
+        if(tileColumns.unit[neighbor] >= 0 || movementCost(movementType, tileColumns.type[neighbor]) < 0)
+          continue;
+
+        relax(neighbor, turn + 1, 0, state);
+      }
+    }
+  }
+
+  if(!found)
+    return {};
+
+  ScratchVector<int> states;
+  for(int state = goal; state >= 0; state = parents[state])
+  {
+    states.push_back(state);
+  }
+  std::reverse(states.begin(), states.end());
+
+  // Split state chain into legs, one per unit or carrier action
+  auto position = [this, numTiles](int state) {
+    int const tile = state % numTiles;
+    return Coordinates{tileColumns.x[tile], tileColumns.y[tile]};
+  };
+
+  TransportPlan plan;
+  auto addLeg = [&plan](TransportLeg const& leg) {
+    if(leg.path.size() > 1 || leg.type == TransportLeg::Type::LOAD || leg.type == TransportLeg::Type::UNLOAD)
+      plan.push_back(leg);
+  };
+
+  int startMode = states.front() / numTiles;
+  TransportLeg leg = {
+    startMode == 0 ? TransportLeg::Type::MOVE : TransportLeg::Type::CARRY,
+    turns[states.front()],
+    startMode == 0 ? "" : carriers[startMode - 1]->id,
+    {position(states.front())},
+    {0, 0}
+  };
+
+  for(unsigned int i = 1; i < states.size(); ++i)
+  {
+    int const prevMode = states[i - 1] / numTiles;
+    int const mode = states[i] / numTiles;
+    int const turn = turns[states[i]];
+
+    if(prevMode == 0 && mode != 0)
+    {
+      leg.type = TransportLeg::Type::LOAD;
+      leg.carrierId = carriers[mode - 1]->id;
+      addLeg(leg);
+      leg = {TransportLeg::Type::CARRY, turn, leg.carrierId, {position(states[i])}, {0, 0}};
+    }
+    else if(prevMode != 0 && mode == 0)
+    {
+      leg.type = TransportLeg::Type::UNLOAD;
+      leg.unloadDestination = position(states[i]);
+      addLeg(leg);
+      leg = {TransportLeg::Type::MOVE, turn, "", {position(states[i])}, {0, 0}};
+    }
+    else
+    {
+      if(turn != leg.turn)
+      {
+        addLeg(leg);
+        leg = {leg.type, turn, leg.carrierId, {position(states[i - 1])}, {0, 0}};
+      }
+      leg.path.push_back(position(states[i]));
+    }
+  }
+  addLeg(leg);
+
+  return plan;
+}
+
+std::vector<wars::Game::UnitMove> wars::Game::findGroupMoves(const std::vector<std::pair<std::string, wars::Game::Coordinates>>& goals) const
+{
+  // Tiles are indexed by handle
+  int const numTiles = tileColumns.ids.size();
+
+  // Reservation table of the units tiles end up with, seeded with current positions
+  std::vector<int> reservations(tileColumns.unit);
+  std::unordered_map<int, int> plannedLoads;
+
+  struct Member
+  {
+    Unit const* unit;
+    int start;
+    Coordinates goal;
+    int distance;
+    int field; // flow field towards the goal, -1 to go by distance
+  };
+
+  // Units beyond their movement range from the goal head along terrain costs
+  // to it, with one flow field shared by all units of a movement type
+  std::vector<FlowField> fields;
+
+  std::vector<Member> members;
+  for(auto const& goal : goals)
+  {
+    Unit const& unit = getUnit(goal.first);
+    UnitType const& unitType = rules.unitTypes.at(unit.type);
+
+    // Reject if carried or already moved this turn
+    if(unit.tileId.empty() || unit.moved)
+      continue;
+
+    int const tile = tileHandle(unit.tileId);
+    Coordinates const pos = {tileColumns.x[tile], tileColumns.y[tile]};
+    int const distance = calculateDistance(pos, goal.second);
+
+    int field = -1;
+    if(distance > unitType.movement)
+    {
+      auto fieldIter = std::find_if(fields.begin(), fields.end(), [&](FlowField const& f) {
+        return f.getTarget() == goal.second && f.getMovementTypeId() == unitType.movementType;
+      });
+      if(fieldIter == fields.end())
+      {
+        fields.emplace_back(*this, goal.second, unitType.movementType);
+        fieldIter = fields.end() - 1;
+      }
+
+      // Goals the unit cannot walk to are approached by distance
+      if(fieldIter->getCost(pos) >= 0)
+        field = fieldIter - fields.begin();
+    }
+
+    members.push_back({&unit, tile, goal.second, distance, field});
+  }
+
+  auto goalDistance = [&](Member const& member, Coordinates const& pos) {
+    if(member.field < 0)
+      return calculateDistance(pos, member.goal);
+    int const cost = fields[member.field].getCost(pos);
+    return cost < 0 ? std::numeric_limits<int>::max() : cost;
+  };
+
+  // Plan units closest to their goals first so they claim the tiles around them
+  std::stable_sort(members.begin(), members.end(), [](Member const& a, Member const& b) {
+    return a.distance < b.distance;
+  });
+
+  std::vector<int> costs(numTiles, std::numeric_limits<int>::max());
+  std::vector<int> parents(numTiles, -1);
+  std::vector<int> visited;
+
+  typedef std::pair<int, int> QueueItem; // cost, tile
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+  std::vector<UnitMove> result;
+  std::vector<bool> planned(members.size(), false);
+
+  // Units staying put may block better tiles for others, retry them once tiles have been freed
+  bool progress = true;
+  while(progress)
+  {
+    progress = false;
+    for(unsigned int m = 0; m < members.size(); ++m)
+    {
+      if(planned[m])
+        continue;
+
+      Member const& member = members[m];
+      Unit const& unit = *member.unit;
+      UnitType const& unitType = rules.unitTypes.at(unit.type);
+      MovementType const& movementType = rules.movementTypes.at(unitType.movementType);
+
+      for(int tile : visited)
+      {
+        costs[tile] = std::numeric_limits<int>::max();
+        parents[tile] = -1;
+      }
+      visited.clear();
+
+      costs[member.start] = 0;
+      visited.push_back(member.start);
+      queue.push({0, member.start});
+
+      int best = member.start;
+      std::pair<int, int> bestScore = {goalDistance(member, {tileColumns.x[member.start], tileColumns.y[member.start]}), 0};
+      int bestCarrier = -1;
+
+      while(!queue.empty())
+      {
+        int cost = queue.top().first;
+        int tile = queue.top().second;
+        queue.pop();
+
+        // Skip stale queue entries
+        if(cost != costs[tile])
+          continue;
+
+        // Consider ending here if the tile is not reserved by another unit
+        Coordinates const pos = {tileColumns.x[tile], tileColumns.y[tile]};
+        std::pair<int, int> const score = {goalDistance(member, pos), cost};
+        if(score < bestScore)
+        {
+          int const reservedBy = reservations[tile];
+          if(reservedBy < 0)
+          {
+            best = tile;
+            bestScore = score;
+            bestCarrier = -1;
+          }
+          else if(pos == member.goal && reservedBy == tileColumns.unit[tile] && unitCanLoadInto(unit.id, unitColumns.ids[reservedBy]))
+          {
+            // Load into a carrier at the goal if it has room left after earlier planned loads
+            Unit const& carrier = getUnit(unitColumns.ids[reservedBy]);
+            UnitType const& carrierType = rules.unitTypes.at(carrier.type);
+            auto loadIter = plannedLoads.find(reservedBy);
+            int loads = loadIter != plannedLoads.end() ? loadIter->second : 0;
+            if(static_cast<int>(carrier.carriedUnits.size()) + loads < carrierType.carryNum)
+            {
+              best = tile;
+              bestScore = score;
+              bestCarrier = reservedBy;
+            }
+          }
+        }
+
+        // Process neighbors
+        for(int direction = 0; direction < 6; ++direction)
+        {
+          // Reject if does not exist
+          int const neighbor = neighborTile(tile, direction);
+          if(neighbor < 0)
+            continue;
+
+          // Reject if cannot traverse or not enough movement points
+          int tileCost = movementCost(movementType, tileColumns.type[neighbor]);
+          if(tileCost < 0 || cost + tileCost > unitType.movement)
+            continue;
+
+          // Reject if contains enemy unit, allies can be passed through
+          int const tileUnit = tileColumns.unit[neighbor];
+          if(tileUnit >= 0 && !areAllies(unit.owner, unitColumns.owner[tileUnit]))
+            continue;
+
+          if(cost + tileCost < costs[neighbor])
+          {
+            if(costs[neighbor] == std::numeric_limits<int>::max())
+              visited.push_back(neighbor);
+
+            costs[neighbor] = cost + tileCost;
+            parents[neighbor] = tile;
+            queue.push({cost + tileCost, neighbor});
+          }
+        }
+      }
+
+      if(best == member.start)
+        continue;
+
+      // Release origin and claim destination
+      reservations[member.start] = -1;
+      if(bestCarrier < 0)
+        reservations[best] = unit.handle;
+      else
+        plannedLoads[bestCarrier] += 1;
+
+      UnitMove move = {unit.id, {tileColumns.x[best], tileColumns.y[best]}, {}};
+      for(int tile = best; tile >= 0; tile = parents[tile])
+      {
+        move.path.push_back({tileColumns.x[tile], tileColumns.y[tile]});
+      }
+      std::reverse(move.path.begin(), move.path.end());
+      result.push_back(move);
+
+      planned[m] = true;
+      progress = true;
+    }
+  }
+
+  return result;
+}
+
+void wars::Game::rebuildAlliances()
+{
+  numAlliancePlayers = 1;
+  for(auto const& item : players)
+  {
+    numAlliancePlayers = std::max(numAlliancePlayers, item.first + 1);
+  }
+
+  // Neutral is only allied with itself and players of the same team with each other
+  alliances.assign(numAlliancePlayers * numAlliancePlayers, false);
+  alliances[0] = true;
+  for(auto const& a : players)
+  {
+    for(auto const& b : players)
+    {
+      if(a.first > 0 && b.first > 0 && a.second.teamNumber == b.second.teamNumber)
+        alliances[a.first * numAlliancePlayers + b.first] = true;
+    }
+  }
+}
+
+void wars::Game::rebuildColumns()
+{
+  tileColumns = TileColumns();
+  unitColumns = UnitColumns();
+  playerAssets.clear();
+
+  int maxX = std::numeric_limits<int>::min();
+  int maxY = std::numeric_limits<int>::min();
+  tileColumns.minX = std::numeric_limits<int>::max();
+  tileColumns.minY = std::numeric_limits<int>::max();
+  for(auto const& item : tiles)
+  {
+    tileColumns.minX = std::min(tileColumns.minX, item.second.x);
+    tileColumns.minY = std::min(tileColumns.minY, item.second.y);
+    maxX = std::max(maxX, item.second.x);
+    maxY = std::max(maxY, item.second.y);
+  }
+
+  if(tiles.empty())
+  {
+    tileColumns.minX = tileColumns.minY = 0;
+  }
+  else
+  {
+    tileColumns.width = maxX - tileColumns.minX + 1;
+    tileColumns.height = maxY - tileColumns.minY + 1;
+  }
+  tileColumns.grid.assign(tileColumns.width * tileColumns.height, -1);
+
+  // Order tile handles along a Hilbert curve so tiles near each other on
+  // the map are also near each other in the columns
+  unsigned int order = 1;
+  while(order < static_cast<unsigned int>(std::max(tileColumns.width, tileColumns.height)))
+  {
+    order *= 2;
+  }
+
+  std::vector<std::pair<unsigned int, Tile*>> tileOrder;
+  for(auto& item : tiles)
+  {
+    Tile& tile = item.second;
+    tileOrder.push_back({hilbertIndex(order, tile.x - tileColumns.minX, tile.y - tileColumns.minY), &tile});
+  }
+  std::sort(tileOrder.begin(), tileOrder.end());
+
+  // Assign all handles first so records can refer to each other
+  int numTiles = 0;
+  for(auto& item : tileOrder)
+  {
+    item.second->handle = numTiles++;
+  }
+
+  int numUnits = 0;
+  for(auto& item : units)
+  {
+    item.second.handle = numUnits++;
+  }
+
+  tileColumns.ids.resize(numTiles);
+  tileColumns.x.resize(numTiles);
+  tileColumns.y.resize(numTiles);
+  tileColumns.type.resize(numTiles);
+  tileColumns.owner.resize(numTiles, -1); // not yet counted in player assets
+  tileColumns.unit.resize(numTiles);
+
+  unitColumns.ids.resize(numUnits);
+  unitColumns.tile.resize(numUnits);
+  unitColumns.type.resize(numUnits);
+  unitColumns.owner.resize(numUnits);
+  unitColumns.health.resize(numUnits);
+  unitColumns.flags.resize(numUnits);
+
+  for(auto const& item : tiles)
+  {
+    updateTileColumns(item.second);
+  }
+
+  for(auto& item : units)
+  {
+    updateUnitColumns(item.second);
+  }
+
+  pathAbstraction->reset(tileColumns);
+}
+
+void wars::Game::updateTileColumns(const wars::Game::Tile& tile)
+{
+  int const handle = tile.handle;
+
+  // Move tile between player assets on ownership change
+  int const previousOwner = tileColumns.owner[handle];
+  if(previousOwner != tile.owner)
+  {
+    bool const income = hasTerrainFlag(rules, tile.type, "Funds");
+    if(previousOwner >= 0)
+    {
+      PlayerAssets& previousAssets = playerAssets[previousOwner];
+      removeHandle(previousAssets.tiles, handle);
+      previousAssets.incomeTiles -= income ? 1 : 0;
+    }
+
+    PlayerAssets& assets = playerAssets[tile.owner];
+    assets.tiles.push_back(handle);
+    assets.incomeTiles += income ? 1 : 0;
+  }
+
+  // Path costs depend on terrain and the unit on the tile
+  int const unit = tile.unitId.empty() ? -1 : units.at(tile.unitId).handle;
+  if(tileColumns.unit[handle] != unit || tileColumns.type[handle] != tile.type)
+    pathAbstraction->markTileDirty(tile.x, tile.y);
+
+  tileColumns.ids[handle] = tile.id;
+  tileColumns.x[handle] = tile.x;
+  tileColumns.y[handle] = tile.y;
+  tileColumns.type[handle] = tile.type;
+  tileColumns.owner[handle] = tile.owner;
+  tileColumns.unit[handle] = unit;
+  tileColumns.grid[(tile.y - tileColumns.minY) * tileColumns.width + tile.x - tileColumns.minX] = handle;
+}
+
+void wars::Game::updateUnitColumns(wars::Game::Unit& unit)
+{
+  // Allocate a handle for new units. Handles of destroyed units aren't
+  // reused, events may still refer to them.
+  if(unit.handle < 0)
+  {
+    unit.handle = unitColumns.ids.size();
+    unitColumns.ids.emplace_back();
+    unitColumns.tile.push_back(-1);
+    unitColumns.type.push_back(0);
+    unitColumns.owner.push_back(0);
+    unitColumns.health.push_back(0);
+    unitColumns.flags.push_back(0);
+  }
+
+  int const handle = unit.handle;
+
+  // Update player assets from the previous column values
+  bool const counted = unitColumns.flags[handle] & UnitColumns::ALIVE;
+  int const previousOwner = counted ? unitColumns.owner[handle] : -1;
+  int const previousValue = counted ? rules.unitTypes.at(unitColumns.type[handle]).price * unitColumns.health[handle] / 100 : 0;
+  int const value = rules.unitTypes.at(unit.type).price * unit.health / 100;
+  if(previousOwner != unit.owner)
+  {
+    if(previousOwner >= 0)
+    {
+      PlayerAssets& previousAssets = playerAssets[previousOwner];
+      removeHandle(previousAssets.units, handle);
+      previousAssets.armyValue -= previousValue;
+    }
+
+    PlayerAssets& assets = playerAssets[unit.owner];
+    assets.units.push_back(handle);
+    assets.armyValue += value;
+  }
+  else
+  {
+    playerAssets[unit.owner].armyValue += value - previousValue;
+  }
+
+  unitColumns.ids[handle] = unit.id;
+  unitColumns.tile[handle] = unit.tileId.empty() ? -1 : tiles.at(unit.tileId).handle;
+  unitColumns.type[handle] = unit.type;
+  unitColumns.owner[handle] = unit.owner;
+  unitColumns.health[handle] = unit.health;
+  unitColumns.flags[handle] = UnitColumns::ALIVE
+    | (unit.deployed ? UnitColumns::DEPLOYED : 0)
+    | (unit.moved ? UnitColumns::MOVED : 0)
+    | (unit.capturing ? UnitColumns::CAPTURING : 0);
+}
+
+int wars::Game::unitHandle(const std::string& unitId)
+{
+  // Built units get their handle before the event is pushed
+  auto iter = units.find(unitId);
+  if(iter == units.end())
+    return -1;
+
+  if(iter->second.handle < 0)
+    updateUnitColumns(iter->second);
+  return iter->second.handle;
+}
+
+int wars::Game::tileHandle(const std::string& tileId) const
+{
+  auto iter = tiles.find(tileId);
+  return iter != tiles.end() ? iter->second.handle : -1;
+}
+
+int wars::Game::unitTileHandle(const std::string& unitId) const
+{
+  auto iter = units.find(unitId);
+  return iter != units.end() ? tileHandle(iter->second.tileId) : -1;
+}
+
+wars::Game::EventPath wars::Game::storeEventPath(const wars::Game::Path& path)
+{
+  Coordinates* points = static_cast<Coordinates*>(eventPaths->allocate(path.size() * sizeof(Coordinates), alignof(Coordinates)));
+  std::copy(path.begin(), path.end(), points);
+  return {points, static_cast<int>(path.size())};
+}
+
+void wars::Game::resetEventPaths()
+{
+  // Snapshots still holding the paths of the previous game data keep them
+  if(eventPaths.use_count() == 1)
+    eventPaths->reset();
+  else
+    eventPaths = std::make_shared<Arena>(4096);
+}
+
+void wars::Game::resetBitboards()
+{
+  int minX = std::numeric_limits<int>::max();
+  int minY = std::numeric_limits<int>::max();
+  int maxX = std::numeric_limits<int>::min();
+  int maxY = std::numeric_limits<int>::min();
+  for(auto const& item : tiles)
+  {
+    minX = std::min(minX, item.second.x);
+    minY = std::min(minY, item.second.y);
+    maxX = std::max(maxX, item.second.x);
+    maxY = std::max(maxY, item.second.y);
+  }
+
+  bitboards = Bitboards();
+  if(tiles.empty())
+    return;
+
+  // Terrain does not change during the game so these are only set here
+  bitboards.capturable = Bitboard(minX, minY, maxX - minX + 1, maxY - minY + 1);
+  for(auto const& item : tiles)
+  {
+    Tile const& tile = item.second;
+    if(hasTerrainFlag(rules, tile.type, "Capturable"))
+      bitboards.capturable.set(tile.x, tile.y);
+  }
+}
+
+template<typename Json>
+std::string wars::Game::updateTileFromJSON(const Json& value)
+{
+  Tile tile;
+  tile.id = value.get("tileId").stringValue();
+  tile.x = value.get("x").longValue();
+  tile.y = value.get("y").longValue();
+  tile.type = value.get("type").longValue();
+  tile.subtype = value.get("subtype").longValue();
+  tile.owner = value.get("owner").longValue();
+  tile.capturePoints = value.get("capturePoints").longValue();
+  tile.beingCaptured = value.get("beingCaptured").booleanValue();
+  tile.unitId = parseStringOrNull(value.get("unitId"), "");
+
+  if(!tile.unitId.empty())
+  {
+    updateUnitFromJSON(value.get("unit"));
+  }
+
+  tiles[tile.id] = tile;
+  return tile.id;
+}
+
+template<typename Json>
+std::string wars::Game::updateUnitFromJSON(const Json& value)
+{
+  std::string unitId = value.get("unitId").stringValue();
+
+  auto iter = units.find(unitId);
+  if(iter == units.end())
+  {
+    Unit u;
+    u.id = unitId;
+    u.health = 100;
+    u.deployed = false;
+    u.capturing = false;
+    units[unitId] = u;
+  }
+  Unit& unit =  units[unitId];
+
+  if(value.has("owner"))
+    unit.owner = value.get("owner").longValue();
+  if(value.has("type"))
+    unit.type = value.get("type").longValue();
+  if(value.has("tileId"))
+    unit.tileId = parseStringOrNull(value.get("tileId"), "");
+  if(value.has("carriedBy"))
+    unit.carriedBy = parseStringOrNull(value.get("carriedBy"), "");
+  if(value.has("health"))
+    unit.health = value.get("health").longValue();
+  if(value.has("deployed"))
+    unit.deployed = value.get("deployed").booleanValue();
+  if(value.has("moved"))
+    unit.moved = value.get("moved").booleanValue();
+  if(value.has("capturing"))
+    unit.capturing = value.get("capturing").booleanValue();
+
+  if(value.has("carriedUnits"))
+  {
+    Json carriedUnits = value.get("carriedUnits");
+    unsigned int numCarriedUnits = carriedUnits.size();
+    for(unsigned int i = 0; i < numCarriedUnits; ++i)
+    {
+      Json carriedUnit = carriedUnits.at(i);
+      std::string carriedUnitId = updateUnitFromJSON(carriedUnit);
+      unit.carriedUnits.push_back(carriedUnitId);
+    }
+  }
+  return unit.id;
+}
+
+template<typename Json>
+int wars::Game::updatePlayerFromJSON(const Json& value)
+{
+  int playerNumber = value.get("playerNumber").longValue();
+
+  auto iter = players.find(playerNumber);
+  if(iter == players.end())
+  {
+    Player p;
+    p.playerNumber = playerNumber;
+    players[playerNumber] = p;
+  }
+  Player& player =  players[playerNumber];
+
+  if(value.has("_id"))
+    player.id = value.get("_id").stringValue();
+  if(value.has("userId"))
+    player.userId = parseStringOrNull(value.get("userId"), "");
+  if(value.has("playerName"))
+    player.playerName = parseStringOrNull(value.get("playerName"), "");
+  if(value.has("teamNumber"))
+    player.teamNumber = value.get("teamNumber").longValue();
+  if(value.get("funds").type() == Json::Type::NUMBER)
+    player.funds = value.get("funds").longValue();
+  if(value.has("score"))
+    player.score = value.get("score").longValue();
+  if(value.has("isMe"))
+    player.isMe = value.get("isMe").booleanValue();
+  if(value.get("settings").type() == Json::Type::OBJECT)
+  {
+    Json settings = value.get("settings");
+    if(settings.has("emailNotifications"))
+      player.emailNotifications = settings.get("emailNotifications").booleanValue();
+    if(settings.has("hidden"))
+      player.hidden = settings.get("hidden").booleanValue();
+  }
+
+  return playerNumber;
+}
+
+std::string wars::Game::updateTileFromJSON(wars::JsonReader& reader)
+{
+  Tile tile;
+  reader.beginObject();
+  while(reader.nextMember())
+  {
+    std::string const& key = reader.key();
+    if(key == "tileId")
+      tile.id = readString(reader);
+    else if(key == "x")
+      tile.x = readInt(reader, 0);
+    else if(key == "y")
+      tile.y = readInt(reader, 0);
+    else if(key == "type")
+      tile.type = readInt(reader, 0);
+    else if(key == "subtype")
+      tile.subtype = readInt(reader, 0);
+    else if(key == "owner")
+      tile.owner = readInt(reader, 0);
+    else if(key == "capturePoints")
+      tile.capturePoints = readInt(reader, 0);
+    else if(key == "beingCaptured")
+      tile.beingCaptured = readBoolean(reader);
+    else if(key == "unitId")
+      tile.unitId = readString(reader);
+    else if(key == "unit" && reader.peek() == JsonReader::Type::OBJECT)
+      updateUnitFromJSON(reader);
+    else
+      reader.skip();
+  }
+
+  tiles[tile.id] = tile;
+  return tile.id;
+}
+
+std::string wars::Game::updateUnitFromJSON(wars::JsonReader& reader)
+{
+  // Fields are collected first since the id may come after them
+  enum { OWNER = 1, TYPE = 2, TILE = 4, CARRIED_BY = 8, HEALTH = 16, DEPLOYED = 32, MOVED = 64, CAPTURING = 128 };
+  Unit fields;
+  int present = 0;
+
+  reader.beginObject();
+  while(reader.nextMember())
+  {
+    std::string const& key = reader.key();
+    if(key == "unitId")
+      fields.id = readString(reader);
+    else if(key == "owner")
+    {
+      fields.owner = readInt(reader, 0);
+      present |= OWNER;
+    }
+    else if(key == "type")
+    {
+      fields.type = readInt(reader, 0);
+      present |= TYPE;
+    }
+    else if(key == "tileId")
+    {
+      fields.tileId = readString(reader);
+      present |= TILE;
+    }
+    else if(key == "carriedBy")
+    {
+      fields.carriedBy = readString(reader);
+      present |= CARRIED_BY;
+    }
+    else if(key == "health")
+    {
+      fields.health = readInt(reader, 0);
+      present |= HEALTH;
+    }
+    else if(key == "deployed")
+    {
+      fields.deployed = readBoolean(reader);
+      present |= DEPLOYED;
+    }
+    else if(key == "moved")
+    {
+      fields.moved = readBoolean(reader);
+      present |= MOVED;
+    }
+    else if(key == "capturing")
+    {
+      fields.capturing = readBoolean(reader);
+      present |= CAPTURING;
+    }
+    else if(key == "carriedUnits" && reader.peek() == JsonReader::Type::ARRAY)
+    {
+      reader.beginArray();
+      while(reader.nextElement())
+      {
+        fields.carriedUnits.push_back(updateUnitFromJSON(reader));
+      }
+    }
+    else
+      reader.skip();
+  }
+
+  auto iter = units.find(fields.id);
+  if(iter == units.end())
+  {
+    Unit u;
+    u.id = fields.id;
+    u.health = 100;
+    u.deployed = false;
+    u.capturing = false;
+    units[fields.id] = u;
+  }
+  Unit& unit =  units[fields.id];
+
+  if(present & OWNER)
+    unit.owner = fields.owner;
+  if(present & TYPE)
+    unit.type = fields.type;
+  if(present & TILE)
+    unit.tileId = fields.tileId;
+  if(present & CARRIED_BY)
+    unit.carriedBy = fields.carriedBy;
+  if(present & HEALTH)
+    unit.health = fields.health;
+  if(present & DEPLOYED)
+    unit.deployed = fields.deployed;
+  if(present & MOVED)
+    unit.moved = fields.moved;
+  if(present & CAPTURING)
+    unit.capturing = fields.capturing;
+  unit.carriedUnits.insert(unit.carriedUnits.end(), fields.carriedUnits.begin(), fields.carriedUnits.end());
+
+  return unit.id;
+}
+
+int wars::Game::updatePlayerFromJSON(wars::JsonReader& reader)
+{
+  // Fields are collected first since the number may come after them
+  enum { ID = 1, USER = 2, NAME = 4, TEAM = 8, FUNDS = 16, SCORE = 32, IS_ME = 64, EMAIL = 128, HIDDEN = 256 };
+  Player fields;
+  int present = 0;
+
+  reader.beginObject();
+  while(reader.nextMember())
+  {
+    std::string const& key = reader.key();
+    if(key == "playerNumber")
+      fields.playerNumber = readInt(reader, 0);
+    else if(key == "_id")
+    {
+      fields.id = readString(reader);
+      present |= ID;
+    }
+    else if(key == "userId")
+    {
+      fields.userId = readString(reader);
+      present |= USER;
+    }
+    else if(key == "playerName")
+    {
+      fields.playerName = readString(reader);
+      present |= NAME;
+    }
+    else if(key == "teamNumber")
+    {
+      fields.teamNumber = readInt(reader, 0);
+      present |= TEAM;
+    }
+    else if(key == "funds" && reader.peek() == JsonReader::Type::NUMBER)
+    {
+      fields.funds = reader.readLong();
+      present |= FUNDS;
+    }
+    else if(key == "score")
+    {
+      fields.score = readInt(reader, 0);
+      present |= SCORE;
+    }
+    else if(key == "isMe")
+    {
+      fields.isMe = readBoolean(reader);
+      present |= IS_ME;
+    }
+    else if(key == "settings" && reader.peek() == JsonReader::Type::OBJECT)
+    {
+      reader.beginObject();
+      while(reader.nextMember())
+      {
+        if(reader.key() == "emailNotifications")
+        {
+          fields.emailNotifications = readBoolean(reader);
+          present |= EMAIL;
+        }
+        else if(reader.key() == "hidden")
+        {
+          fields.hidden = readBoolean(reader);
+          present |= HIDDEN;
+        }
+        else
+          reader.skip();
+      }
+    }
+    else
+      reader.skip();
+  }
+
+  int playerNumber = fields.playerNumber;
+  auto iter = players.find(playerNumber);
+  if(iter == players.end())
+  {
+    Player p;
+    p.playerNumber = playerNumber;
+    players[playerNumber] = p;
+  }
+  Player& player =  players[playerNumber];
+
+  if(present & ID)
+    player.id = fields.id;
+  if(present & USER)
+    player.userId = fields.userId;
+  if(present & NAME)
+    player.playerName = fields.playerName;
+  if(present & TEAM)
+    player.teamNumber = fields.teamNumber;
+  if(present & FUNDS)
+    player.funds = fields.funds;
+  if(present & SCORE)
+    player.score = fields.score;
+  if(present & IS_ME)
+    player.isMe = fields.isMe;
+  if(present & EMAIL)
+    player.emailNotifications = fields.emailNotifications;
+  if(present & HIDDEN)
+    player.hidden = fields.hidden;
+
+  return playerNumber;
+}
+
+namespace
+{
+  template<typename T>
+  std::unordered_map<int, T> parseAll(json::Value const& v)
+  {
+    std::unordered_map<int, T> result;
+    std::vector<std::string> ids = v.properties();
+    for(std::string id : ids)
+    {
+      json::Value json = v.get(id.data());
+      T t = parse<T>(json);
+      result[t.id] = t;
+    }
+    return result;
+  }
+
+  template<>
+  wars::Weapon parse(json::Value const& v)
+  {
+    wars::Weapon weapon;
+    weapon.id = v.get("id").longValue();
+    weapon.name = v.get("name").stringValue();
+    weapon.requireDeployed = v.get("requireDeployed").booleanValue();
+
+    weapon.powerMap = parseIntIntMap(v.get("powerMap"));
+    weapon.rangeMap = parseIntIntMap(v.get("rangeMap"));
+
+    return weapon;
   }
 
   std::unordered_map<int, int> parseIntIntMap(json::Value const& v)
@@ -1419,9 +2980,7 @@ namespace
     std::unordered_map<int, int> result;
     for(std::string const& s : props)
     {
-      int i = 0;
-      std::istringstream(s) >> i;
-      result[i] = v.get(s).longValue();
+      result[parseIntKey(s)] = v.get(s).longValue();
     }
 
     return result;
@@ -1433,8 +2992,7 @@ namespace
     std::unordered_map<int, int> result;
     for(std::string const& s : props)
     {
-      int i = 0;
-      std::istringstream(s) >> i;
+      int i = parseIntKey(s);
       json::Value prop = v.get(s);
       if(prop.type() == json::Value::Type::NULL_JSON)
       {
@@ -1481,6 +3039,7 @@ namespace
     wars::TerrainType value;
     value.id = v.get("id").longValue();
     value.name = v.get("name").stringValue();
+    value.defense = v.get("defense").longValue();
     value.buildTypes = parseIntSet(v.get("buildTypes"));
     value.repairTypes = parseIntSet(v.get("repairTypes"));
     value.flags = parseIntSet(v.get("flags"));
@@ -1542,7 +3101,261 @@ namespace
     return rules;
   }
 
-  std::unordered_set<int> parseIntSet(json::Value const& v)
+  template<typename T>
+  std::unordered_map<int, T> readAll(wars::JsonReader& r)
+  {
+    std::unordered_map<int, T> result;
+    if(r.readNull())
+      return result;
+
+    r.beginObject();
+    while(r.nextMember())
+    {
+      T t = read<T>(r);
+      result[t.id] = t;
+    }
+    return result;
+  }
+
+  // Members of the objects common to all rule types
+  template<typename T>
+  bool readIdAndName(wars::JsonReader& r, T& value)
+  {
+    if(r.key() == "id")
+      value.id = readInt(r, 0);
+    else if(r.key() == "name")
+      value.name = readString(r);
+    else
+      return false;
+    return true;
+  }
+
+  template<typename T>
+  T readNamed(wars::JsonReader& r)
+  {
+    T value = T();
+    r.beginObject();
+    while(r.nextMember())
+    {
+      if(!readIdAndName(r, value))
+        r.skip();
+    }
+    return value;
+  }
+
+  template<>
+  wars::Weapon read(wars::JsonReader& r)
+  {
+    wars::Weapon weapon = wars::Weapon();
+    r.beginObject();
+    while(r.nextMember())
+    {
+      if(readIdAndName(r, weapon))
+        continue;
+      else if(r.key() == "requireDeployed")
+        weapon.requireDeployed = readBoolean(r);
+      else if(r.key() == "powerMap")
+        weapon.powerMap = readIntIntMap(r, 0);
+      else if(r.key() == "rangeMap")
+        weapon.rangeMap = readIntIntMap(r, 0);
+      else
+        r.skip();
+    }
+    return weapon;
+  }
+
+  template<>
+  wars::Armor read(wars::JsonReader& r)
+  {
+    return readNamed<wars::Armor>(r);
+  }
+
+  template<>
+  wars::UnitClass read(wars::JsonReader& r)
+  {
+    return readNamed<wars::UnitClass>(r);
+  }
+
+  template<>
+  wars::TerrainFlag read(wars::JsonReader& r)
+  {
+    return readNamed<wars::TerrainFlag>(r);
+  }
+
+  template<>
+  wars::TerrainType read(wars::JsonReader& r)
+  {
+    wars::TerrainType value = wars::TerrainType();
+    r.beginObject();
+    while(r.nextMember())
+    {
+      if(readIdAndName(r, value))
+        continue;
+      else if(r.key() == "defense")
+        value.defense = readInt(r, 0);
+      else if(r.key() == "buildTypes")
+        value.buildTypes = readIntSet(r);
+      else if(r.key() == "repairTypes")
+        value.repairTypes = readIntSet(r);
+      else if(r.key() == "flags")
+        value.flags = readIntSet(r);
+      else
+        r.skip();
+    }
+    return value;
+  }
+
+  template<>
+  wars::MovementType read(wars::JsonReader& r)
+  {
+    wars::MovementType value = wars::MovementType();
+    r.beginObject();
+    while(r.nextMember())
+    {
+      if(readIdAndName(r, value))
+        continue;
+      else if(r.key() == "effectMap")
+        value.effectMap = readIntIntMap(r, -1);
+      else
+        r.skip();
+    }
+    return value;
+  }
+
+  template<>
+  wars::UnitFlag read(wars::JsonReader& r)
+  {
+    return readNamed<wars::UnitFlag>(r);
+  }
+
+  template<>
+  wars::UnitType read(wars::JsonReader& r)
+  {
+    wars::UnitType value = wars::UnitType();
+    r.beginObject();
+    while(r.nextMember())
+    {
+      std::string const& key = r.key();
+      if(readIdAndName(r, value))
+        continue;
+      else if(key == "unitClass")
+        value.unitClass = readInt(r, 0);
+      else if(key == "price")
+        value.price = readInt(r, 0);
+      else if(key == "primaryWeapon")
+        value.primaryWeapon = readInt(r, -1);
+      else if(key == "secondaryWeapon")
+        value.secondaryWeapon = readInt(r, -1);
+      else if(key == "armor")
+        value.armor = readInt(r, 0);
+      else if(key == "defenseMap")
+        value.defenseMap = readIntIntMap(r, 0);
+      else if(key == "movementType")
+        value.movementType = readInt(r, 0);
+      else if(key == "movement")
+        value.movement = readInt(r, 0);
+      else if(key == "carryClasses")
+        value.carryClasses = readIntSet(r);
+      else if(key == "carryNum")
+        value.carryNum = readInt(r, 0);
+      else if(key == "flags")
+        value.flags = readIntSet(r);
+      else
+        r.skip();
+    }
+    return value;
+  }
+
+  template<>
+  wars::Rules read(wars::JsonReader& r)
+  {
+    wars::Rules rules;
+    r.beginObject();
+    while(r.nextMember())
+    {
+      std::string const& key = r.key();
+      if(key == "weapons")
+        rules.weapons = readAll<wars::Weapon>(r);
+      else if(key == "armors")
+        rules.armors = readAll<wars::Armor>(r);
+      else if(key == "unitClasses")
+        rules.unitClasses = readAll<wars::UnitClass>(r);
+      else if(key == "terrainFlags")
+        rules.terrainFlags = readAll<wars::TerrainFlag>(r);
+      else if(key == "terrains")
+        rules.terrainTypes = readAll<wars::TerrainType>(r);
+      else if(key == "movementTypes")
+        rules.movementTypes = readAll<wars::MovementType>(r);
+      else if(key == "unitFlags")
+        rules.unitFlags = readAll<wars::UnitFlag>(r);
+      else if(key == "units")
+        rules.unitTypes = readAll<wars::UnitType>(r);
+      else
+        r.skip();
+    }
+    return rules;
+  }
+
+  // Property names of the int maps
+  std::unordered_map<int, int> readIntIntMap(wars::JsonReader& r, int nullValue)
+  {
+    std::unordered_map<int, int> result;
+    if(r.readNull())
+      return result;
+
+    r.beginObject();
+    while(r.nextMember())
+    {
+      int const key = r.keyInt();
+      result[key] = readInt(r, nullValue);
+    }
+    return result;
+  }
+
+  std::unordered_set<int> readIntSet(wars::JsonReader& r)
+  {
+    std::unordered_set<int> result;
+    if(r.readNull())
+      return result;
+
+    r.beginArray();
+    while(r.nextElement())
+    {
+      result.insert(r.readLong());
+    }
+    return result;
+  }
+
+  int readInt(wars::JsonReader& r, int nullValue)
+  {
+    return r.readNull() ? nullValue : r.readLong();
+  }
+
+  std::string readString(wars::JsonReader& r)
+  {
+    return r.readNull() ? std::string() : r.readString();
+  }
+
+  bool readBoolean(wars::JsonReader& r)
+  {
+    return r.readNull() ? false : r.readBoolean();
+  }
+
+  int parseIntKey(std::string const& key)
+  {
+    return std::strtol(key.c_str(), nullptr, 10);
+  }
+
+  // Perfect over the event action names, see Game::findEventAction
+  std::size_t actionHash(std::string const& name)
+  {
+    if(name.empty())
+      return 0;
+    return (name.size() * 16 + name.front() + name.back() * 20) & 31;
+  }
+
+  template<typename Json>
+  std::unordered_set<int> parseIntSet(Json const& v)
   {
     std::unordered_set<int> result;
     for(unsigned int i = 0; i < v.size(); ++i)
@@ -1551,9 +3364,10 @@ namespace
     }
     return result;
   }
-  int parseIntOrNull(json::Value const& v, int nullValue)
+  template<typename Json>
+  int parseIntOrNull(Json const& v, int nullValue)
   {
-    if(v.type() == json::Value::Type::NULL_JSON)
+    if(v.type() == Json::Type::NULL_JSON)
     {
       return nullValue;
     }
@@ -1562,9 +3376,10 @@ namespace
       return v.longValue();
     }
   }
-  std::string parseStringOrNull(json::Value const& v, std::string const& nullValue)
+  template<typename Json>
+  std::string parseStringOrNull(Json const& v, std::string const& nullValue)
   {
-    if(v.type() == json::Value::Type::NULL_JSON)
+    if(v.type() == Json::Type::NULL_JSON)
     {
       return nullValue;
     }
@@ -1574,18 +3389,65 @@ namespace
     }
 
   }
-  wars::Game::Path parsePath(json::Value const& v)
+  int movementCost(wars::MovementType const& movementType, int terrainId)
+  {
+    auto effectIter = movementType.effectMap.find(terrainId);
+    return effectIter != movementType.effectMap.end() ? effectIter->second : 1;
+  }
+
+  bool hasTerrainFlag(wars::Rules const& rules, int terrainId, std::string const& flagName)
+  {
+    for(int terrainFlagId : rules.terrainTypes.at(terrainId).flags)
+    {
+      if(rules.terrainFlags.at(terrainFlagId).name == flagName)
+        return true;
+    }
+    return false;
+  }
+
+  void removeHandle(std::vector<int>& handles, int handle)
+  {
+    auto iter = std::find(handles.begin(), handles.end(), handle);
+    if(iter != handles.end())
+    {
+      *iter = handles.back();
+      handles.pop_back();
+    }
+  }
+
+  // Position of (x, y) along a Hilbert curve filling an order x order square
+  unsigned int hilbertIndex(unsigned int order, unsigned int x, unsigned int y)
+  {
+    unsigned int index = 0;
+    for(unsigned int s = order / 2; s > 0; s /= 2)
+    {
+      unsigned int const rx = (x & s) > 0;
+      unsigned int const ry = (y & s) > 0;
+      index += s * s * ((3 * rx) ^ ry);
+
+      // Rotate quadrant
+      if(ry == 0)
+      {
+        if(rx == 1)
+        {
+          x = s - 1 - x;
+          y = s - 1 - y;
+        }
+        std::swap(x, y);
+      }
+    }
+    return index;
+  }
+
+  // Stable like std::stable_sort but without a temporary buffer, and fast on
+  // the nearly sorted search queues
+  template<typename Iterator>
+  void insertionSort(Iterator begin, Iterator end)
   {
-    wars::Game::Path path;
-    unsigned int numCoordinates = v.size();
-    for(int i = 0; i < numCoordinates; ++i)
+    for(Iterator i = begin; i != end; ++i)
     {
-      json::Value value = v.at(i);
-      int x = value.get("x").longValue();
-      int y = value.get("y").longValue();
-      path.push_back({x, y});
+      std::rotate(std::upper_bound(begin, i, *i), i, i + 1);
     }
-    return path;
   }
 }
 
@@ -3,11 +3,18 @@
 
 #include <string>
 #include <vector>
+#include <bitset>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <memory>
 
 #include "rules.h"
 #include "stream.h"
+#include "bitboard.h"
+#include "arena.h"
+#include "jsonview.h"
+#include "jsonreader.h"
 
 namespace json
 {
@@ -16,6 +23,8 @@ namespace json
 
 namespace wars
 {
+  class PathAbstraction;
+
   class Game
   {
   public:
@@ -30,6 +39,44 @@ namespace wars
     };
     typedef std::vector<Coordinates> Path;
     static const int NEUTRAL_PLAYER_NUMBER = 0;
+    // The rules don't carry income, so this mirrors the server's fixed
+    // income per funds tile. Local funds are checked against the server.
+    static const int FUNDS_PER_TILE = 100;
+
+    struct TransportLeg
+    {
+      enum class Type { MOVE, LOAD, CARRY, UNLOAD };
+      Type type;
+      int turn;
+      std::string carrierId;
+      Path path;
+      Coordinates unloadDestination;
+    };
+    typedef std::vector<TransportLeg> TransportPlan;
+
+    enum class UnitAction : int { WAIT = 0, ATTACK, CAPTURE, DEPLOY, UNDEPLOY, LOAD, UNLOAD };
+    static const int NUM_UNIT_ACTIONS = 7;
+
+    struct ActionOptions
+    {
+      bool has(UnitAction action) const { return actions.test(static_cast<int>(action)); }
+
+      std::bitset<NUM_UNIT_ACTIONS> actions;
+      std::unordered_map<std::string, int> attackTargets;
+    };
+
+    struct UnitMove
+    {
+      std::string unitId;
+      Coordinates destination;
+      Path path;
+    };
+
+    struct AttackTarget
+    {
+      int unit; // unit handle
+      int damage;
+    };
 
     enum class EventType {
       GAMEDATA, MOVE, WAIT, ATTACK, COUNTERATTACK, CAPTURE, CAPTURED,
@@ -38,6 +85,23 @@ namespace wars
       END_TURN, TURN_TIMEOUT, FINISHED, SURRENDER
     };
 
+    // Path of a move event, stored in the game's event path arena
+    struct EventPath
+    {
+      Coordinates const* begin() const { return points; }
+      Coordinates const* end() const { return points + length; }
+
+      Coordinates const* points;
+      int length;
+    };
+
+    // Self-contained and trivially copyable, so events can be queued,
+    // journaled or sent to other threads. Units and tiles are referred to by
+    // handle. Events are pushed before the game changes and carry the tiles
+    // units were on, -1 for carried units, so consumers don't depend on the
+    // state at the time they run. Handles and paths stay valid until the
+    // next GAMEDATA event: handles of destroyed units aren't reused and
+    // still resolve with getUnitId(int).
     struct Event
     {
       EventType type;
@@ -45,78 +109,91 @@ namespace wars
       {
         struct
         {
-          std::string const* unitId;
-          std::string const* tileId;
-          Path const* path;
+          int unit;
+          int from;
+          int tile;
+          EventPath path;
         } move;
         struct
         {
-          std::string const* unitId;
+          int unit;
+          int tile;
         } wait;
         struct
         {
-          std::string const* attackerId;
-          std::string const* targetId;
+          int attacker;
+          int target;
           int damage;
+          int attackerTile;
+          int targetTile;
         } attack;
         struct
         {
-          std::string const* attackerId;
-          std::string const* targetId;
+          int attacker;
+          int target;
           int damage;
+          int attackerTile;
+          int targetTile;
         } counterattack;
         struct
         {
-          std::string const* unitId;
-          std::string const* tileId;
+          int unit;
+          int tile;
           int left;
         } capture;
         struct
         {
-          std::string const* unitId;
-          std::string const* tileId;
+          int unit;
+          int tile;
+          int owner; // new owner of the tile
         } captured;
         struct
         {
-          std::string const* unitId;
+          int unit;
+          int tile;
         } deploy;
         struct
         {
-          std::string const* unitId;
+          int unit;
+          int tile;
         } undeploy;
         struct
         {
-          std::string const* unitId;
-          std::string const* carrierId;
+          int unit;
+          int carrier;
+          int tile;
         } load;
         struct
         {
-          std::string const* unitId;
-          std::string const* carrierId;
-          std::string const* tileId;
+          int unit;
+          int carrier;
+          int from; // carrier's tile
+          int tile;
         } unload;
         struct
         {
-          std::string const* unitId;
+          int unit;
+          int tile;
         } destroy;
         struct
         {
-          std::string const* unitId;
+          int unit;
+          int tile;
           int newHealth;
         } repair;
         struct
         {
-          std::string const* tileId;
-          std::string const* unitId;
+          int tile;
+          int unit;
         } build;
         struct
         {
-          std::string const* tileId;
+          int tile;
           int newCapturePoints;
         } regenerateCapturePoints;
         struct
         {
-          std::string const* tileId;
+          int tile;
         } produceFunds;
         struct
         {
@@ -152,9 +229,10 @@ namespace wars
       std::string unitId;
       int capturePoints;
       bool beingCaptured;
+      int handle;
 
       Tile() : id(), x(0), y(0), type(0), subtype(0), owner(0),
-        unitId(), capturePoints(0), beingCaptured(false)
+        unitId(), capturePoints(0), beingCaptured(false), handle(-1)
       {}
     };
     struct Unit
@@ -169,9 +247,59 @@ namespace wars
       bool moved;
       bool capturing;
       std::vector<std::string> carriedUnits;
+      int handle;
 
       Unit() : id(), tileId(), type(0), owner(0), carriedBy(), health(0),
-        deployed(false), moved(false), capturing(false), carriedUnits()
+        deployed(false), moved(false), capturing(false), carriedUnits(), handle(-1)
+      {}
+    };
+
+    // Frequently scanned fields of tiles and units in contiguous arrays
+    // indexed by handle, kept in sync with the records by the handlers
+    struct TileColumns
+    {
+      std::vector<std::string> ids;
+      std::vector<int> x;
+      std::vector<int> y;
+      std::vector<int> type;
+      std::vector<int> owner;
+      std::vector<int> unit; // unit handle, -1 if none
+
+      // Tile handles by coordinates, -1 if no tile
+      std::vector<int> grid;
+      int minX;
+      int minY;
+      int width;
+      int height;
+
+      TileColumns() : ids(), x(), y(), type(), owner(), unit(),
+        grid(), minX(0), minY(0), width(0), height(0)
+      {}
+    };
+
+    struct UnitColumns
+    {
+      static const unsigned char ALIVE = 1;
+      static const unsigned char DEPLOYED = 2;
+      static const unsigned char MOVED = 4;
+      static const unsigned char CAPTURING = 8;
+
+      std::vector<std::string> ids;
+      std::vector<int> tile; // tile handle, -1 if carried
+      std::vector<int> type;
+      std::vector<int> owner;
+      std::vector<int> health;
+      std::vector<unsigned char> flags; // cleared for destroyed units
+    };
+
+    struct PlayerAssets
+    {
+      std::vector<int> units; // unit handles
+      std::vector<int> tiles; // owned tile handles
+      int incomeTiles;
+      int armyValue; // unit prices scaled by health
+
+      PlayerAssets() : units(), tiles(), incomeTiles(0), armyValue(0)
       {}
     };
 
@@ -196,6 +324,9 @@ namespace wars
     Game();
     ~Game();
 
+    // Copy of the game state without event subscribers
+    Game snapshot() const;
+
     Stream<Event> events();
 
     void setRulesFromJSON(json::Value const& value);
@@ -203,6 +334,17 @@ namespace wars
     void processEventFromJSON(json::Value const& value);
     void processEventsFromJSON(json::Value const& value);
 
+    // Read straight from a view over the received message
+    void setGameDataFromJSON(JsonView::Value const& value);
+    void processEventFromJSON(JsonView::Value const& value);
+    void processEventsFromJSON(JsonView::Value const& value);
+
+    // Streamed into the game structures without building a document
+    void setRulesFromJSON(JsonReader& reader);
+    void setGameDataFromJSON(JsonReader& reader);
+    void processEventFromJSON(JsonReader& reader);
+    void processEventsFromJSON(JsonReader& reader);
+
     // Game event handlers
     void moveUnit(std::string const& unitId, std::string const& tileId, Path const& path);
     void waitUnit(std::string const& unitId);
@@ -225,17 +367,26 @@ namespace wars
     void finished(int winnerPlayerNumber);
     void surrender(int playerNumber);
 
+    // Overwrite locally tracked funds with the server's value
+    void setFunds(int playerNumber, int funds);
 
     Tile const& getTile(std::string const& tileId) const;
     Unit const& getUnit(std::string const& unitId) const;
+    Tile const& getTile(int handle) const;
+    Unit const& getUnit(int handle) const;
+    std::string const& getUnitId(int handle) const; // destroyed units too
     Player const& getPlayer(int playerNumber) const;
 
     std::unordered_map<std::string, Tile> const& getTiles() const;
     std::unordered_map<std::string, Unit> const& getUnits() const;
     std::unordered_map<int, Player> const& getPlayers() const;
+    TileColumns const& getTileColumns() const;
+    UnitColumns const& getUnitColumns() const;
+    PlayerAssets const& getPlayerAssets(int playerNumber) const;
     Rules const& getRules() const;
 
     Player const& getInTurn();
+    int getInTurnNumber() const;
     Tile const* getTileAt(int x, int y) const;
 
     std::string const& getGameId() const;
@@ -243,12 +394,18 @@ namespace wars
     int calculateDistance(Coordinates const& a, Coordinates const& b) const;
     bool areAllies(int playerNumber1, int playerNumber2) const;
     Path findShortestPath(Coordinates const& a, Coordinates const& b) const;
+    void findShortestPath(Coordinates const& a, Coordinates const& b, Path& path) const;
     Path findUnitPath(std::string const& unitId, Coordinates const& destination) const;
+    void findUnitPath(std::string const& unitId, Coordinates const& destination, Path& path) const;
     std::vector<Coordinates> neighborCoordinates(Coordinates const& pos) const;
     std::vector<Coordinates> findMovementOptions(std::string const& unitId) const;
+    void findMovementOptions(std::string const& unitId, std::vector<Coordinates>& result) const;
     int calculateWeaponPower(Weapon const& weapon, int armorId, int distance) const;
+    int calculateAttackPower(UnitType const& attackerType, bool attackerDeployed, int armorId, int distance) const;
+    int calculateDefense(UnitType const& targetType, int terrainId) const;
     int calculateAttackDamage(UnitType const& attackerType, int attackerHealth, bool attackerDeployed, UnitType const& targetType, int targetHealth, int distance, int targetTerrainId) const;
     std::unordered_map<std::string, int> findAttackOptions(std::string const& unitId, Coordinates const& position) const;
+    void findAttackOptions(std::string const& unitId, Coordinates const& position, std::vector<AttackTarget>& result) const;
     bool unitCanLoadInto(std::string const& unitId, std::string const& carrierId) const;
     bool unitCanAttackFromTile(std::string const& unitId, std::string const& tileId) const;
     bool unitCanCaptureTile(std::string const& unitId, std::string const& tileId) const;
@@ -257,13 +414,84 @@ namespace wars
     bool unitCanUnloadAtTile(std::string const& unitId, std::string const& tileId) const;
     bool unitCanUnloadUnitFromTileToCoordinates(std::string const& unitId, std::string const& carriedId, std::string const& tileId, Coordinates const& destination) const;
     std::vector<Coordinates> unitUnloadUnitFromTileOptions(std::string const& unitId, std::string const& carriedId, std::string const& tileId) const;
+    void unitUnloadUnitFromTileOptions(std::string const& unitId, std::string const& carriedId, std::string const& tileId, std::vector<Coordinates>& result) const;
+    ActionOptions findActionOptions(std::string const& unitId, std::string const& tileId) const;
+    TransportPlan findTransportPlan(std::string const& unitId, Coordinates const& destination) const;
+    std::vector<UnitMove> findGroupMoves(std::vector<std::pair<std::string, Coordinates>> const& goals) const;
 
   private:
     static std::unordered_map<std::string, State> const STATE_NAMES;
 
-    std::string updateTileFromJSON(json::Value const& value);
-    std::string updateUnitFromJSON(json::Value const& value);
-    int updatePlayerFromJSON(json::Value const& value);
+    // Fields of an event's content, decoded in one pass whatever the action
+    struct EventContent
+    {
+      std::string action;
+      std::string unitId;
+      std::string tileId;
+      std::string attackerId;
+      std::string targetId;
+      std::string carrierId;
+      Path path;
+      bool hasDamage;
+      int damage;
+      int left;
+      int newHealth;
+      int newCapturePoints;
+      int player;
+      int winner;
+
+      // Source of the unit object, read in full by build
+      char const* unit;
+      std::size_t unitLength;
+
+      EventContent() : action(), unitId(), tileId(), attackerId(), targetId(), carrierId(), path(),
+        hasDamage(false), damage(0), left(0), newHealth(0), newCapturePoints(0), player(0), winner(0),
+        unit(nullptr), unitLength(0)
+      {}
+    };
+
+    typedef void (*EventAction)(Game& game, EventContent const& content);
+    struct EventActionEntry
+    {
+      char const* name;
+      EventAction action;
+    };
+
+    static EventActionEntry const EVENT_ACTIONS[];
+    static EventAction findEventAction(std::string const& name);
+
+    int gridCell(int x, int y) const;
+    int neighborTile(int tile, int direction) const; // tile handle, -1 if none
+    void findAttackTargets(Unit const& unit, Coordinates const& position, ScratchVector<AttackTarget>& result) const;
+
+    struct Bitboards
+    {
+      Bitboard capturable;
+    };
+
+    void rebuildAlliances();
+    void rebuildColumns();
+    void updateTileColumns(Tile const& tile);
+    void updateUnitColumns(Unit& unit);
+
+    int unitHandle(std::string const& unitId);
+    int tileHandle(std::string const& tileId) const;
+    int unitTileHandle(std::string const& unitId) const;
+    EventPath storeEventPath(Path const& path);
+    void resetEventPaths();
+
+    void resetBitboards();
+
+    template<typename Json> void setGameData(Json const& value);
+    void processEvent(JsonReader& reader, EventContent& content);
+    void readEventContent(JsonReader& reader, EventContent& content);
+    std::string readEventUnitId(JsonReader& reader);
+    template<typename Json> std::string updateTileFromJSON(Json const& value);
+    template<typename Json> std::string updateUnitFromJSON(Json const& value);
+    template<typename Json> int updatePlayerFromJSON(Json const& value);
+    std::string updateTileFromJSON(JsonReader& reader);
+    std::string updateUnitFromJSON(JsonReader& reader);
+    int updatePlayerFromJSON(JsonReader& reader);
 
     std::string gameId;
     std::string authorId;
@@ -283,7 +511,15 @@ namespace wars
     std::unordered_map<std::string, Tile> tiles;
     std::unordered_map<std::string, Unit> units;
     std::unordered_map<int, Player> players;
+    TileColumns tileColumns;
+    UnitColumns unitColumns;
+    std::unordered_map<int, PlayerAssets> playerAssets;
+    std::vector<bool> alliances;
+    int numAlliancePlayers;
+    Bitboards bitboards;
 
+    std::shared_ptr<PathAbstraction> pathAbstraction; // long range searches, not shared with snapshots
+    std::shared_ptr<Arena> eventPaths; // shared with snapshots
     Stream<Event> eventStream;
   };
 }
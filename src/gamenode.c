@@ -1,6 +1,5 @@
 #include "gamenode.h"
 #include "libwebsockets.h"
-#include "libsocketio.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -10,20 +9,48 @@
 #include <curl/curl.h>
 #include <time.h>
 
+typedef enum queueDataType {
+  QUEUE_DATA_MESSAGE,
+  QUEUE_DATA_HEARTBEAT,
+  QUEUE_DATA_METHOD_LIST
+} queueDataType;
+
+// Outgoing message with room for the libwebsockets padding on both sides.
+// The buffer belongs to its slot in the write queue and is reused by the
+// messages that later occupy the slot.
 typedef struct queueData {
   char* data;
-  int size;
-  struct queueData* next;
+  size_t capacity; // payload that fits between the paddings
+  size_t size;
+  queueDataType type;
 } queueData;
 
+// Buffers grown past this for a large message are released once sent
+#define WRITE_BUFFER_KEEP_SIZE (64 * 1024)
+
 typedef struct _gamenode {
   struct libwebsocket_context* wsCtx;
   struct libwebsocket* ws;
   struct lws_context_creation_info wsInfo;
-  struct queueData* writeQueue;
 
+  // Ring of writeQueueCapacity slots, a power of two, with writeCount
+  // messages queued from writeHead
+  queueData* writeQueue;
+  unsigned int writeQueueCapacity;
+  unsigned int writeHead;
+  unsigned int writeCount;
+  char heartbeatQueued;
+  gamenodeWriteStats writeStats;
+
+  // Fragments of the message being received, kept between messages
   char* readBuffer;
   size_t readBufferSize;
+  size_t readLength;
+  size_t maxMessageSize;
+
+  struct pollfd* pollFds;
+  unsigned int numPollFds;
+  unsigned int pollFdsCapacity;
 
   char* sioSessionId;
   int sioHeartbeatInterval;
@@ -46,12 +73,14 @@ gamenode* gamenodeNew(gamenodeCallbackFunc callback)
 {
   gamenode* gn = calloc(1, sizeof(gamenode));
   gn->callback = callback;
-  gn->writeQueue = NULL;
+  gn->maxMessageSize = GAMENODE_DEFAULT_MAX_MESSAGE_SIZE;
   return gn;
 }
 
+// Partial sends are buffered by libwebsockets, which holds off writable
+// callbacks until they are flushed
 static struct libwebsocket_protocols wsProtocols[] = {
-{"gamenode", callback_gamenode, 0, 1024, 1},
+{"gamenode", callback_gamenode, 0, 1024, 0},
 { 0 }
 };
 
@@ -77,6 +106,15 @@ void gamenodeFree(gamenode* gn)
     free(gn->sioSessionId);
   }
 
+  unsigned int j;
+  for(j = 0; j < gn->writeQueueCapacity; ++j)
+  {
+    free(gn->writeQueue[j].data);
+  }
+  free(gn->writeQueue);
+
+  free(gn->readBuffer);
+  free(gn->pollFds);
   free(gn);
 }
 
@@ -198,48 +236,244 @@ void gamenodeDisconnect(gamenode* gn)
     gn->gamenodeMessageId = 0;
   }
 
-  while(gn->writeQueue)
+  gn->numPollFds = 0;
+  gn->readLength = 0;
+
+  // Unsent messages are dropped, their buffers stay for the next connection
+  gn->writeHead = 0;
+  gn->writeCount = 0;
+  gn->heartbeatQueued = 0;
+}
+
+static char growWriteQueue(gamenode* gn)
+{
+  unsigned int capacity = gn->writeQueueCapacity ? gn->writeQueueCapacity * 2 : 8;
+  queueData* queue = calloc(capacity, sizeof(queueData));
+  if(!queue)
+    return 0;
+
+  // Unwrapped so the queue starts from the first slot
+  unsigned int i;
+  for(i = 0; i < gn->writeQueueCapacity; ++i)
   {
-    queueData* qd = gn->writeQueue;
-    gn->writeQueue = gn->writeQueue->next;
-    free(qd->data);
-    free(qd);
+    queue[i] = gn->writeQueue[(gn->writeHead + i) & (gn->writeQueueCapacity - 1)];
   }
+
+  free(gn->writeQueue);
+  gn->writeQueue = queue;
+  gn->writeQueueCapacity = capacity;
+  gn->writeHead = 0;
+  ++gn->writeStats.allocations;
+  return 1;
 }
 
-static void queueDataForSending(gamenode* gn, char const* data)
+// Slot after the last queued message, filled in place and then queued with
+// commitMessage. Returns NULL if the queue can't grow.
+static queueData* beginMessage(gamenode* gn, queueDataType type)
 {
-  //printf("Queuing data: %s\n", data);
-  size_t qdSize = sizeof(queueData);
-  struct queueData* qData = calloc(2, qdSize);
-  qData->size = strlen(data);
-  qData->data = calloc(1, LWS_SEND_BUFFER_PRE_PADDING + qData->size + LWS_SEND_BUFFER_POST_PADDING);
-  strcpy(qData->data + LWS_SEND_BUFFER_PRE_PADDING, data);
-  qData->next = NULL;
-  // Find end of queue and append
-  queueData** last = &gn->writeQueue;
-  while(*last) last = &(*last)->next;
-  *last = qData;
+  if(gn->writeCount == gn->writeQueueCapacity && !growWriteQueue(gn))
+    return NULL;
+
+  queueData* d = &gn->writeQueue[(gn->writeHead + gn->writeCount) & (gn->writeQueueCapacity - 1)];
+  d->size = 0;
+  d->type = type;
+  return d;
 }
 
-char gamenodeHandle(gamenode* gn)
+static char reserveMessage(gamenode* gn, queueData* d, size_t length)
+{
+  size_t required = d->size + length;
+  if(required <= d->capacity)
+    return 1;
+
+  size_t capacity = d->capacity ? d->capacity : 256;
+  while(capacity < required)
+  {
+    capacity *= 2;
+  }
+
+  char* data = realloc(d->data, LWS_SEND_BUFFER_PRE_PADDING + capacity + LWS_SEND_BUFFER_POST_PADDING);
+  if(!data)
+    return 0;
+
+  d->data = data;
+  d->capacity = capacity;
+  ++gn->writeStats.allocations;
+  return 1;
+}
+
+static char appendMessage(gamenode* gn, queueData* d, char const* data, size_t length)
+{
+  if(!reserveMessage(gn, d, length))
+    return 0;
+
+  memcpy(d->data + LWS_SEND_BUFFER_PRE_PADDING + d->size, data, length);
+  d->size += length;
+  return 1;
+}
+
+#define appendMessageLiteral(gn, d, s) appendMessage(gn, d, s, sizeof(s) - 1)
+
+static char appendMessageLong(gamenode* gn, queueData* d, long value)
+{
+  if(!reserveMessage(gn, d, 24))
+    return 0;
+
+  d->size += sprintf(d->data + LWS_SEND_BUFFER_PRE_PADDING + d->size, "%ld", value);
+  return 1;
+}
+
+// Appends a string as a quoted JSON string
+static char appendMessageString(gamenode* gn, queueData* d, char const* s)
+{
+  static char const hex[] = "0123456789abcdef";
+  size_t length = strlen(s);
+  if(!reserveMessage(gn, d, length * 6 + 2))
+    return 0;
+
+  char* out = d->data + LWS_SEND_BUFFER_PRE_PADDING + d->size;
+  char* p = out;
+  *p++ = '"';
+  for(; *s; ++s)
+  {
+    unsigned char c = *s;
+    if(c == '"' || c == '\\')
+    {
+      *p++ = '\\';
+      *p++ = c;
+    }
+    else if(c < 0x20)
+    {
+      *p++ = '\\';
+      *p++ = 'u';
+      *p++ = '0';
+      *p++ = '0';
+      *p++ = hex[c >> 4];
+      *p++ = hex[c & 0xF];
+    }
+    else
+    {
+      *p++ = c;
+    }
+  }
+  *p++ = '"';
+  d->size += p - out;
+  return 1;
+}
+
+static void commitMessage(gamenode* gn)
+{
+  ++gn->writeCount;
+  ++gn->writeStats.messages;
+
+  // Ask for a writable callback right away so pollers wait for POLLOUT
+  if(gn->ws)
+  {
+    libwebsocket_callback_on_writable(gn->wsCtx, gn->ws);
+  }
+}
+
+// Drops the message at the head of the queue once it has been written
+static void releaseMessage(gamenode* gn)
+{
+  queueData* d = &gn->writeQueue[gn->writeHead];
+  if(d->type == QUEUE_DATA_HEARTBEAT)
+    gn->heartbeatQueued = 0;
+
+  if(d->capacity > WRITE_BUFFER_KEEP_SIZE)
+  {
+    free(d->data);
+    d->data = NULL;
+    d->capacity = 0;
+  }
+
+  gn->writeHead = (gn->writeHead + 1) & (gn->writeQueueCapacity - 1);
+  --gn->writeCount;
+}
+
+static void queueHeartbeat(gamenode* gn)
+{
+  // The server only needs one, a heartbeat still waiting covers this one
+  if(gn->heartbeatQueued)
+    return;
+
+  queueData* d = beginMessage(gn, QUEUE_DATA_HEARTBEAT);
+  if(d && appendMessageLiteral(gn, d, "2:::"))
+  {
+    gn->heartbeatQueued = 1;
+    commitMessage(gn);
+  }
+}
+
+static void prepareService(gamenode* gn)
 {
   // Request write for heartbeat if necessary
   time_t now;
   time(&now);
   if(now - gn->sioPreviousHeartbeat > gn->sioHeartbeatInterval / 2)
   {
-    queueDataForSending(gn, "2:::");
+    queueHeartbeat(gn);
     gn->sioPreviousHeartbeat = now;
   }
 
-  if (gn->writeQueue)
+  if (gn->writeCount)
   {
     libwebsocket_callback_on_writable(gn->wsCtx, gn->ws);
   }
+}
+
+char gamenodeHandle(gamenode* gn)
+{
+  prepareService(gn);
   return libwebsocket_service(gn->wsCtx, 0);
 }
 
+struct pollfd const* gamenodePollFds(gamenode* gn, unsigned int* numPollFds)
+{
+  *numPollFds = gn->numPollFds;
+  return gn->pollFds;
+}
+
+char gamenodeServiceFd(gamenode* gn, struct pollfd* pollFd)
+{
+  prepareService(gn);
+  return libwebsocket_service_fd(gn->wsCtx, pollFd);
+}
+
+static struct pollfd* findPollFd(gamenode* gn, int fd)
+{
+  unsigned int i;
+  for(i = 0; i < gn->numPollFds; ++i)
+  {
+    if(gn->pollFds[i].fd == fd)
+      return &gn->pollFds[i];
+  }
+  return NULL;
+}
+
+static void addPollFd(gamenode* gn, int fd, short events)
+{
+  if(gn->numPollFds == gn->pollFdsCapacity)
+  {
+    gn->pollFdsCapacity = gn->pollFdsCapacity ? gn->pollFdsCapacity * 2 : 4;
+    gn->pollFds = realloc(gn->pollFds, gn->pollFdsCapacity * sizeof(struct pollfd));
+  }
+
+  struct pollfd* pollFd = &gn->pollFds[gn->numPollFds++];
+  pollFd->fd = fd;
+  pollFd->events = events;
+  pollFd->revents = 0;
+}
+
+static void removePollFd(gamenode* gn, int fd)
+{
+  struct pollfd* pollFd = findPollFd(gn, fd);
+  if(pollFd)
+  {
+    *pollFd = gn->pollFds[--gn->numPollFds];
+  }
+}
+
 const char* LWS_EXT_CALLBACK_STR[] = {
   "LWS_CALLBACK_ESTABLISHED",
   "LWS_CALLBACK_CLIENT_CONNECTION_ERROR",
@@ -280,48 +514,139 @@ const char* LWS_EXT_CALLBACK_STR[] = {
   "LWS_CALLBACK_USER"
 };
 
-long int sendMessage(gamenode* gn, long msgId, chckJson* msg)
+// Starts a gamenode message in a socket.io message packet "3:id::", the
+// caller continues with the members after the type
+static queueData* beginGamenodeMessage(gamenode* gn, queueDataType type, long packetId, long msgId, char const* msgType)
 {
-  size_t size;
-  char* msgData = chckJsonEncode(msg, &size);
-  int headerSize = snprintf(NULL, 0, "3:%d::", msgId);
-  char* msgStr = calloc(size + headerSize, sizeof(char));
-  sprintf(msgStr, "3:%d::", msgId);
-  strcat(msgStr, msgData);
-  free(msgData);
-  queueDataForSending(gn, msgStr);
-  free(msgStr);
+  queueData* d = beginMessage(gn, type);
+  if(d && appendMessageLiteral(gn, d, "3:") && appendMessageLong(gn, d, packetId)
+     && appendMessageLiteral(gn, d, "::{\"id\":") && appendMessageLong(gn, d, msgId)
+     && appendMessageLiteral(gn, d, ",\"type\":") && appendMessageString(gn, d, msgType))
+  {
+    return d;
+  }
+  return NULL;
+}
 
-  return msgId;
+// Closes and queues the message, unless filling it failed
+static void endGamenodeMessage(gamenode* gn, queueData* d, char ok)
+{
+  if(d && ok && appendMessageLiteral(gn, d, "}"))
+  {
+    commitMessage(gn);
+  }
+  else
+  {
+    printf("Error queuing message, out of memory\n");
+  }
 }
 
 void sendMethodList(gamenode* gn)
 {
-  chckJson* methods = chckJsonNew(CHCK_JSON_TYPE_ARRAY);
+  // A list still waiting at the end of the queue is outdated, rewrite it
+  if(gn->writeCount)
+  {
+    unsigned int tail = (gn->writeHead + gn->writeCount - 1) & (gn->writeQueueCapacity - 1);
+    if(gn->writeQueue[tail].type == QUEUE_DATA_METHOD_LIST)
+      --gn->writeCount;
+  }
+
+  long msgId = gn->gamenodeMessageId++;
+  queueData* d = beginGamenodeMessage(gn, QUEUE_DATA_METHOD_LIST, msgId, msgId, "methodList");
+  char ok = d && appendMessageLiteral(gn, d, ",\"content\":[");
 
   int i;
-  for (i = 0; i < gn->numMethodNames; ++i)
+  for (i = 0; ok && i < gn->numMethodNames; ++i)
   {
-    chckJsonChildAppend(methods, chckJsonNewString(gn->methodNames[i]));
+    ok = (i == 0 || appendMessageLiteral(gn, d, ",")) && appendMessageString(gn, d, gn->methodNames[i]);
   }
 
-  long msgId = gn->gamenodeMessageId++;
+  endGamenodeMessage(gn, d, ok && appendMessageLiteral(gn, d, "]"));
+}
 
-  chckJson* msg = chckJsonNew(CHCK_JSON_TYPE_OBJECT);
-  chckJsonProperty(msg,  "id", chckJsonNewNumberLong(msgId));
-  chckJsonProperty(msg,  "type", chckJsonNewString("methodList"));
-  chckJsonProperty(msg,  "content", methods);
+// Appends a fragment to the receive buffer, growing it geometrically so a
+// message in many fragments is assembled in linear time. The frame's
+// remaining payload is reserved up front when known. Fails if the message
+// would exceed the maximum size.
+static char appendReceived(gamenode* gn, char const* data, size_t len, size_t remaining)
+{
+  size_t required = gn->readLength + len;
+  if(required > gn->maxMessageSize || remaining > gn->maxMessageSize - required)
+    return 0;
 
-  sendMessage(gn, msgId, msg);
+  if(required + remaining > gn->readBufferSize)
+  {
+    size_t size = gn->readBufferSize ? gn->readBufferSize : 4096;
+    while(size < required + remaining)
+    {
+      size *= 2;
+    }
+
+    char* buffer = realloc(gn->readBuffer, size);
+    if(!buffer)
+      return 0;
+
+    gn->readBuffer = buffer;
+    gn->readBufferSize = size;
+  }
 
-  chckJsonFreeAll(msg);
+  memcpy(gn->readBuffer + gn->readLength, data, len);
+  gn->readLength = required;
+  return 1;
+}
+
+enum sioPacketType
+{
+  SIO_PACKET_DISCONNECT,
+  SIO_PACKET_CONNECT,
+  SIO_PACKET_HEARTBEAT,
+  SIO_PACKET_MESSAGE,
+  SIO_PACKET_JSON_MESSAGE,
+  SIO_PACKET_EVENT,
+  SIO_PACKET_ACK,
+  SIO_PACKET_ERROR,
+  SIO_PACKET_NOOP
+};
+
+// Splits a socket.io frame "type:id:endpoint:data" without copying it.
+// Returns the packet type and points data into the frame, or -1 if the
+// frame is malformed.
+static int parseFrame(char const* frame, size_t length, char const** data, size_t* dataLength)
+{
+  if(length < 1 || frame[0] < '0' || frame[0] > '8')
+    return -1;
+
+  int type = frame[0] - '0';
+  *data = NULL;
+  *dataLength = 0;
+
+  // Skip the id and endpoint fields
+  size_t i = 1;
+  int separators = 0;
+  while(i < length && separators < 3)
+  {
+    if(frame[i++] == ':')
+      ++separators;
+  }
+
+  if(separators < 2)
+    return -1;
+
+  if(separators == 3)
+  {
+    *data = frame + i;
+    *dataLength = length - i;
+  }
+
+  return type;
 }
 
 static int callback_gamenode(struct libwebsocket_context *context, struct libwebsocket *wsi,
                              enum libwebsocket_callback_reasons reason, void *user, void *in, size_t len)
 {
   gamenode* gn = (gamenode*) libwebsocket_context_user(context);
-  if(reason != LWS_CALLBACK_GET_THREAD_ID && reason != LWS_CALLBACK_LOCK_POLL)
+  if(reason != LWS_CALLBACK_GET_THREAD_ID && reason != LWS_CALLBACK_LOCK_POLL
+     && reason != LWS_CALLBACK_UNLOCK_POLL && reason != LWS_CALLBACK_CHANGE_MODE_POLL_FD)
     printf("%s\n", LWS_EXT_CALLBACK_STR[reason]);
 
   switch(reason)
@@ -343,45 +668,37 @@ static int callback_gamenode(struct libwebsocket_context *context, struct libweb
     case LWS_CALLBACK_CLIENT_RECEIVE:
     {
       const size_t remaining = libwebsockets_remaining_packet_payload(wsi);
-      if(remaining || !libwebsocket_is_final_fragment(wsi))
+      const char lastFragment = !remaining && libwebsocket_is_final_fragment(wsi);
+
+      // A message in a single fragment is handled straight from the input
+      char* buffer = (char*) in;
+      size_t length = len;
+      if(!lastFragment || gn->readLength)
       {
-        // Not last fragment, buffer
-        if(!gn->readBuffer)
+        if(!appendReceived(gn, buffer, len, remaining))
         {
-          gn->readBufferSize = len + remaining + 1;
-          gn->readBuffer = calloc(gn->readBufferSize, sizeof(char));
+          printf("Message larger than %lu bytes, closing connection\n", (unsigned long) gn->maxMessageSize);
+          gn->readLength = 0;
+          return -1;
         }
-        strcat(gn->readBuffer, (char*)  in);
-        return 0;
-      }
 
-      char* buffer = (char*) in;
-      if(gn->readBuffer)
-      {
-        // Last fragment, data previously buffered
-        strcat(gn->readBuffer, (char*)  in);
+        if(!lastFragment)
+          return 0;
+
         buffer = gn->readBuffer;
+        length = gn->readLength;
       }
 
-      //printf("Received: %s\n", buffer);
-      lsio_packet_t* packet = calloc(1, sizeof(lsio_packet_t));
-      lsio_packet_init(packet);
-
-      int parseResult = lsio_packet_parse(packet, buffer);
+      //printf("Received: %.*s\n", (int) length, buffer);
+      char const* data = NULL;
+      size_t dataLength = 0;
+      int packetType = parseFrame(buffer, length, &data, &dataLength);
 
-      if(parseResult == LSIO_ERROR)
+      switch(packetType)
       {
-        printf("Error parsing packet\n");
-        break;
-      }
-      //printf("packet type = %d\n", packet.type);
-
-      switch(packet->type)
-      {
-        case LSIO_PACKET_TYPE_UNDEFINED: break;
-        case LSIO_PACKET_TYPE_DISCONNECT:
+        case SIO_PACKET_DISCONNECT:
           return -1;
-        case LSIO_PACKET_TYPE_CONNECT:
+        case SIO_PACKET_CONNECT:
         {
           gamenodeEvent event;
           event.type = GAMENODE_CONNECTED;
@@ -389,74 +706,54 @@ static int callback_gamenode(struct libwebsocket_context *context, struct libweb
           gn->callback(gn, &event);
           break;
         }
-        case LSIO_PACKET_TYPE_HEARTBEAT:break;
-        case LSIO_PACKET_TYPE_MESSAGE:
+        case SIO_PACKET_MESSAGE:
         {
-          chckJsonDecoder* decoder = chckJsonDecoderNew();
-          chckJson* msg = chckJsonDecoderDecode(decoder, packet->data);
-          chckJsonDecoderFree(decoder);
-          chckJson* msgType = chckJsonGetProperty(msg, "type");
-          //printf("msgType = %s\n", msgType->string_value);
-          if(strcmp(chckJsonGetString(msgType), "response") == 0)
-          {
-            gamenodeEvent event;
-            event.type = GAMENODE_RESPONSE;
-            event.response.id = chckJsonGetLong(chckJsonGetProperty(msg, "id"));
-            event.response.value = chckJsonGetProperty(msg, "content");
-            gn->callback(gn, &event);
-          }
-          else if(strcmp(chckJsonGetString(msgType), "call") == 0)
-          {
-            gamenodeEvent event;
-            event.type = GAMENODE_METHOD_CALL;
-            event.methodCall.id = chckJsonGetLong(chckJsonGetProperty(msg, "id"));
-            event.methodCall.methodName= chckJsonGetString(chckJsonGetProperty(msg, "method"));
-            event.methodCall.params = chckJsonGetProperty(msg, "params");
-            gn->callback(gn, &event);
-          }
-          else if(strcmp(chckJsonGetString(msgType), "methodList") == 0)
-          {
-          }
-          chckJsonFreeAll(msg);
+          // Handed over in place, the receiver parses what it needs
+          gamenodeEvent event;
+          event.type = GAMENODE_MESSAGE;
+          event.message.data = data;
+          event.message.length = dataLength;
+          gn->callback(gn, &event);
           break;
         }
-        case LSIO_PACKET_TYPE_JSON_MESSAGE: break;
-        case LSIO_PACKET_TYPE_EVENT: break;
-        case LSIO_PACKET_TYPE_ACK: break;
-        case LSIO_PACKET_TYPE_ERROR:
+        case SIO_PACKET_ERROR:
         {
           gamenodeEvent event;
           event.type = GAMENODE_ERROR;
           gn->callback(gn, &event);
           break;
         }
-        case LSIO_PACKET_TYPE_NOOP: break;
+        case -1:
+          printf("Error parsing packet\n");
+          break;
+        default: break;
       }
 
-      lsio_packet_free(packet);
-      if(gn->readBuffer)
-      {
-        free(gn->readBuffer);
-        gn->readBuffer = NULL;
-      }
+      gn->readLength = 0;
       //printf("LWS_CALLBACK_CLIENT_RECEIVE handled\n");
       break;
     }
     case LWS_CALLBACK_CLIENT_RECEIVE_PONG: break;
     case LWS_CALLBACK_CLIENT_WRITEABLE:
     {
-      while(gn->writeQueue)
+      while(gn->writeCount)
       {
-        queueData* d = gn->writeQueue;
+        // Left queued until the socket drains
         if(lws_send_pipe_choked(wsi))
         {
-          printf("Send pipe congested while tried to write, skipping sending: %s\n", d->data + LWS_SEND_BUFFER_PRE_PADDING);
+          ++gn->writeStats.deferredWrites;
+          libwebsocket_callback_on_writable(context, wsi);
           break;
         }
-        //printf("Sending: %s\n", d->data + LWS_SEND_BUFFER_PRE_PADDING);
-        libwebsocket_write(wsi, d->data + LWS_SEND_BUFFER_PRE_PADDING, d->size, LWS_WRITE_TEXT);
-        gn->writeQueue = d->next;
-        free(d->data);
+
+        queueData* d = &gn->writeQueue[gn->writeHead];
+        //printf("Sending: %.*s\n", (int) d->size, d->data + LWS_SEND_BUFFER_PRE_PADDING);
+        if(libwebsocket_write(wsi, (unsigned char*) d->data + LWS_SEND_BUFFER_PRE_PADDING, d->size, LWS_WRITE_TEXT) < 0)
+        {
+          printf("Error writing message, closing connection\n");
+          return -1;
+        }
+        releaseMessage(gn);
       }
       break;
     }
@@ -487,6 +784,28 @@ static int callback_gamenode(struct libwebsocket_context *context, struct libweb
       return -1;
     }
     case LWS_CALLBACK_GET_THREAD_ID: break;
+    case LWS_CALLBACK_ADD_POLL_FD:
+    {
+      struct libwebsocket_pollargs* pa = (struct libwebsocket_pollargs*) in;
+      addPollFd(gn, pa->fd, pa->events);
+      break;
+    }
+    case LWS_CALLBACK_DEL_POLL_FD:
+    {
+      struct libwebsocket_pollargs* pa = (struct libwebsocket_pollargs*) in;
+      removePollFd(gn, pa->fd);
+      break;
+    }
+    case LWS_CALLBACK_CHANGE_MODE_POLL_FD:
+    {
+      struct libwebsocket_pollargs* pa = (struct libwebsocket_pollargs*) in;
+      struct pollfd* pollFd = findPollFd(gn, pa->fd);
+      if(pollFd)
+      {
+        pollFd->events = pa->events;
+      }
+      break;
+    }
     default: break;
   }
 
@@ -522,38 +841,58 @@ void gamenodeSetMethodNames(gamenode* gn, const char** methodNames, unsigned int
 
 long gamenodeMethodCall(gamenode* gn, const char* methodName, chckJson* params)
 {
-  chckJson* msg = chckJsonNew(CHCK_JSON_TYPE_OBJECT);
-  long msgId = gn->gamenodeMessageId++;
-  chckJsonProperty(msg,  "id", chckJsonNewNumberLong(msgId));
-  chckJsonProperty(msg,  "type", chckJsonNewString("call"));
-  chckJsonProperty(msg,  "method", chckJsonNewString(methodName));
+  size_t size;
+  char* text = chckJsonEncode(params, &size);
+  long msgId = gamenodeMethodCallText(gn, methodName, text, strlen(text));
+  free(text);
+  chckJsonFreeAll(params);
+  return msgId;
+}
 
-  if(chckJsonGetType(params) == CHCK_JSON_TYPE_ARRAY)
-  {
-    chckJsonProperty(msg,  "params", params);
-  }
-  else
+long gamenodeMethodCallText(gamenode* gn, const char* methodName, const char* params, size_t length)
+{
+  // A single parameter is wrapped in an array
+  size_t i = 0;
+  while(i < length && (params[i] == ' ' || params[i] == '\t' || params[i] == '\n' || params[i] == '\r'))
   {
-    chckJson* paramArray = chckJsonNew(CHCK_JSON_TYPE_ARRAY);
-    chckJsonChildAppend(paramArray, params);
-    chckJsonProperty(msg,  "params", paramArray);
+    ++i;
   }
+  char isArray = i < length && params[i] == '[';
 
-  sendMessage(gn, msgId, msg);
-  chckJsonFreeAll(msg);
+  long msgId = gn->gamenodeMessageId++;
+  queueData* d = beginGamenodeMessage(gn, QUEUE_DATA_MESSAGE, msgId, msgId, "call");
+  char ok = d && appendMessageLiteral(gn, d, ",\"method\":") && appendMessageString(gn, d, methodName)
+      && appendMessageLiteral(gn, d, ",\"params\":")
+      && (isArray || appendMessageLiteral(gn, d, "[")) && appendMessage(gn, d, params, length)
+      && (isArray || appendMessageLiteral(gn, d, "]"));
+  endGamenodeMessage(gn, d, ok);
   return msgId;
 }
 
 
 void gamenodeResponse(gamenode* gn, long int msgId, chckJson* value)
 {
-  chckJson* msg = chckJsonNew(CHCK_JSON_TYPE_OBJECT);
-  chckJsonProperty(msg,  "id", chckJsonNewNumberLong(msgId));
-  chckJsonProperty(msg,  "type", chckJsonNewString("response"));
-  chckJsonProperty(msg,  "content", value);
+  size_t size;
+  char* text = chckJsonEncode(value, &size);
+  gamenodeResponseText(gn, msgId, text, strlen(text));
+  free(text);
+  chckJsonFreeAll(value);
+}
 
-  sendMessage(gn, ++gn->gamenodeMessageId, msg);
-  chckJsonFreeAll(msg);
+void gamenodeResponseText(gamenode* gn, long int msgId, const char* value, size_t length)
+{
+  queueData* d = beginGamenodeMessage(gn, QUEUE_DATA_MESSAGE, ++gn->gamenodeMessageId, msgId, "response");
+  endGamenodeMessage(gn, d, d && appendMessageLiteral(gn, d, ",\"content\":") && appendMessage(gn, d, value, length));
+}
+
+void gamenodeWriteStatistics(gamenode* gn, gamenodeWriteStats* stats)
+{
+  *stats = gn->writeStats;
+}
+
+void gamenodeSetMaxMessageSize(gamenode* gn, size_t maxMessageSize)
+{
+  gn->maxMessageSize = maxMessageSize;
 }
 
 void gamenodeSetUserData(gamenode* gn, void* data)
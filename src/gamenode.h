@@ -2,19 +2,22 @@
 #define GAMENODE_H
 
 #include "json.h"
+#include <poll.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define GAMENODE_DEFAULT_MAX_MESSAGE_SIZE (64 * 1024 * 1024)
+
 typedef struct _gamenode gamenode;
 typedef enum gamenodeEventType
 {
   GAMENODE_CONNECTED,
   GAMENODE_DISCONNECTED,
   GAMENODE_ERROR,
-  GAMENODE_RESPONSE,
-  GAMENODE_METHOD_CALL
+  GAMENODE_MESSAGE
 } gamenodeEventType;
 
 typedef struct gamenodeEvent {
@@ -35,18 +38,21 @@ typedef struct gamenodeEvent {
     } error;
     struct
     {
-      long id;
-      chckJson* value;
-    } response;
-    struct
-    {
-      long id;
-      char const* methodName;
-      chckJson* params;
-    } methodCall;
+      // JSON text of the message inside the receive buffer, valid only
+      // during the callback and not NUL terminated
+      char const* data;
+      size_t length;
+    } message;
   };
 } gamenodeEvent;
 
+// Counters of the outgoing message queue
+typedef struct gamenodeWriteStats {
+  unsigned long messages;
+  unsigned long allocations; // queue and message buffer growth
+  unsigned long deferredWrites; // writes put off until the socket drained
+} gamenodeWriteStats;
+
 typedef void (*gamenodeCallbackFunc)(gamenode*, gamenodeEvent const*);
 
 gamenode* gamenodeNew(gamenodeCallbackFunc callback);
@@ -60,14 +66,29 @@ char gamenodeConnect(gamenode* gn,
 void gamenodeDisconnect(gamenode* gn);
 char gamenodeHandle(gamenode* gn);
 
+// External polling: poll the descriptors and service those with events.
+// A NULL pollFd only sends heartbeats and handles timeouts.
+struct pollfd const* gamenodePollFds(gamenode* gn, unsigned int* numPollFds);
+char gamenodeServiceFd(gamenode* gn, struct pollfd* pollFd);
+
+// Longer messages close the connection
+void gamenodeSetMaxMessageSize(gamenode* gn, size_t maxMessageSize);
+
 void gamenodeSetUserData(gamenode* gn, void* data);
 void* gamenodeUserData(gamenode* gn);
 
 void gamenodeSetMethodNames(gamenode* gn, const char** methodNames, unsigned int numMethodNames);
 
+// Take ownership of the JSON and free it
 long int gamenodeMethodCall(gamenode* gn, char const* methodName, chckJson* params);
 void gamenodeResponse(gamenode* gn, long int msgId, chckJson* value);
 
+// Same with JSON text, copied straight into the outgoing message
+long int gamenodeMethodCallText(gamenode* gn, char const* methodName, char const* params, size_t length);
+void gamenodeResponseText(gamenode* gn, long int msgId, char const* value, size_t length);
+
+void gamenodeWriteStatistics(gamenode* gn, gamenodeWriteStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
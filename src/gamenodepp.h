@@ -3,10 +3,12 @@
 
 #include "gamenode.h"
 #include "jsonpp.h"
+#include "jsonview.h"
 #include <string>
 #include <functional>
 #include <map>
 #include <vector>
+#include <iostream>
 #include "stream.h"
 #include "promise.h"
 
@@ -15,7 +17,12 @@ class Gamenode
 public:
   typedef std::function<json::Value(json::Value const&)> Method;
   typedef std::function<void(json::Value const&)> VoidMethod;
-  Gamenode() : _gn(gamenodeNew(gamenodeCallback)), _callbacks()
+
+  // Receives the params as a view into the receive buffer, valid only
+  // during the call
+  typedef std::function<void(wars::JsonView::Value const&)> ViewMethod;
+
+  Gamenode() : _gn(gamenodeNew(gamenodeCallback)), _view(), _methods(), _callbacks(), _rawCallbacks()
   {
     gamenodeSetUserData(_gn, this);
   }
@@ -28,28 +35,25 @@ public:
 
   void onMethod(std::string const& methodName, Method method)
   {
-    _methods[methodName] = method;
-    std::vector<const char*> methodList;
-    for(auto& pair : _methods)
-    {
-      methodList.push_back(pair.first.data());
-    }
-    gamenodeSetMethodNames(_gn, methodList.data(), methodList.size());
+    addMethod(methodName, [method](wars::JsonView::Value const& params) {
+      return method(json::Value::parse(params.toString()));
+    });
   }
 
   void onVoidMethod(std::string const& methodName, VoidMethod method)
   {
-    _methods[methodName] = [method](json::Value const& v) mutable {
-      method(v);
+    addMethod(methodName, [method](wars::JsonView::Value const& params) {
+      method(json::Value::parse(params.toString()));
       return json::Value::null();
-    };
+    });
+  }
 
-    std::vector<const char*> methodList;
-    for(auto& pair : _methods)
-    {
-      methodList.push_back(pair.first.data());
-    }
-    gamenodeSetMethodNames(_gn, methodList.data(), methodList.size());
+  void onViewMethod(std::string const& methodName, ViewMethod method)
+  {
+    addMethod(methodName, [method](wars::JsonView::Value const& params) {
+      method(params);
+      return json::Value::null();
+    });
   }
 
   Stream<void> connected()
@@ -77,6 +81,11 @@ public:
     return gamenodeConnect(_gn, address.data(), port, path.data(), host.data(), origin.data()) == 0;
   }
 
+  void setMaxMessageSize(std::size_t maxMessageSize)
+  {
+    gamenodeSetMaxMessageSize(_gn, maxMessageSize);
+  }
+
   void disconnect()
   {
     gamenodeDisconnect(_gn);
@@ -87,16 +96,47 @@ public:
     return gamenodeHandle(_gn) == 0;
   }
 
+  void pollFds(std::vector<pollfd>& fds) const
+  {
+    unsigned int numPollFds = 0;
+    pollfd const* pollFds = gamenodePollFds(_gn, &numPollFds);
+    fds.insert(fds.end(), pollFds, pollFds + numPollFds);
+  }
+
+  bool service(pollfd* pollFd = nullptr)
+  {
+    return gamenodeServiceFd(_gn, pollFd) == 0;
+  }
+
+
+  gamenodeWriteStats writeStats() const
+  {
+    gamenodeWriteStats stats;
+    gamenodeWriteStatistics(_gn, &stats);
+    return stats;
+  }
+
 
   Promise<json::Value> call(std::string const& methodName, json::Value const& params)
   {
-    json::Value paramsClone = params;
-    long msgId = gamenodeMethodCall(_gn, methodName.data(), paramsClone.extract());
+    std::string text = params.toString();
+    long msgId = gamenodeMethodCallText(_gn, methodName.data(), text.data(), text.size());
     Promise<json::Value> promise;
     _callbacks[msgId] = promise;
     return promise;
   }
 
+  // Fulfilled with the JSON text of the response content, for callers
+  // that read it through a view instead of building a document
+  Promise<std::string> callRaw(std::string const& methodName, json::Value const& params)
+  {
+    std::string text = params.toString();
+    long msgId = gamenodeMethodCallText(_gn, methodName.data(), text.data(), text.size());
+    Promise<std::string> promise;
+    _rawCallbacks[msgId] = promise;
+    return promise;
+  }
+
 
 private:
   static void gamenodeCallback(gamenode* gn, gamenodeEvent const* event)
@@ -120,47 +160,89 @@ private:
         gnpp->_error.push();
         break;
       }
-      case GAMENODE_RESPONSE:
-      {
-        gnpp->handleResponse(event->response.id, event->response.value);
-        break;
-      }
-      case GAMENODE_METHOD_CALL:
+      case GAMENODE_MESSAGE:
       {
-        gnpp->handleMethodCall(event->methodCall.id, event->methodCall.methodName, event->methodCall.params);
+        gnpp->handleMessage(event->message.data, event->message.length);
         break;
       }
     }
   }
 
-  void handleResponse(long msgId, chckJson* value)
+  typedef std::function<json::Value(wars::JsonView::Value const&)> Handler;
+
+  void addMethod(std::string const& methodName, Handler handler)
+  {
+    _methods[methodName] = handler;
+    std::vector<const char*> methodList;
+    for(auto& pair : _methods)
+    {
+      methodList.push_back(pair.first.data());
+    }
+    gamenodeSetMethodNames(_gn, methodList.data(), methodList.size());
+  }
+
+  void handleMessage(char const* data, std::size_t length)
   {
+    if(!_view.parse(data, length))
+    {
+      std::cerr << "Error parsing gamenode message" << std::endl;
+      return;
+    }
+
+    wars::JsonView::Value message = _view.root();
+    std::string type = message.get("type").stringValue();
+    long msgId = message.get("id").longValue();
+    if(type == "response")
+    {
+      handleResponse(msgId, message.get("content"));
+    }
+    else if(type == "call")
+    {
+      handleMethodCall(msgId, message.get("method").stringValue(), message.get("params"));
+    }
+  }
+
+  void handleResponse(long msgId, wars::JsonView::Value const& content)
+  {
+    auto rawIter = _rawCallbacks.find(msgId);
+    if(rawIter != _rawCallbacks.end())
+    {
+      Promise<std::string> promise = rawIter->second;
+      _rawCallbacks.erase(rawIter);
+      promise.fulfill(content.toString());
+      return;
+    }
+
     auto iter = _callbacks.find(msgId);
     if(iter != _callbacks.end())
     {
       Promise<json::Value> promise = iter->second;
-      json::Value v(chckJsonCopy(value));
+      json::Value v = json::Value::parse(content.toString());
       promise.fulfill(v);
       _callbacks.erase(iter);
     }
   }
-  void handleMethodCall(long msgId, std::string const& methodName, chckJson* params)
+  void handleMethodCall(long msgId, std::string const& methodName, wars::JsonView::Value const& params)
   {
     auto iter = _methods.find(methodName);
     if(iter != _methods.end())
     {
       auto& callback = iter->second;
-      json::Value p(chckJsonCopy(params));
-      json::Value ret = callback(p);
+      json::Value ret = callback(params);
       if(ret.type() != json::Value::Type::NONE)
-        gamenodeResponse(_gn, msgId, ret.extract());
+      {
+        std::string text = ret.toString();
+        gamenodeResponseText(_gn, msgId, text.data(), text.size());
+      }
     }
   }
 
 
   gamenode* _gn;
-  std::map<std::string, Method> _methods;
+  wars::JsonView _view; // reused for every message
+  std::map<std::string, Handler> _methods;
   std::map<long, Promise<json::Value>> _callbacks;
+  std::map<long, Promise<std::string>> _rawCallbacks;
   Stream<void> _connected;
   Stream<void> _disconnected;
   Stream<void> _error;
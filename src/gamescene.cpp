@@ -2,9 +2,17 @@
 
 
 wars::GameScene::GameScene(wars::Game* game, Theme* theme) :
-  _game(game), _theme(theme), _sky(nullptr), _units(), _tiles(), _eventSub()
+  _game(game), _theme(theme), _sky(nullptr), _rectToHexMatrix(), _units(), _tiles(), _tileOrder(), _eventSlot()
 {
-  _eventSub = _game->events().on([this](wars::Game::Event const& e) {
+  kmMat4 mat = {
+    _theme->base.x.x, _theme->base.x.y, _theme->base.x.z, 0,
+    _theme->base.y.x, _theme->base.y.y, _theme->base.y.z, 0,
+    _theme->base.z.x, _theme->base.z.y, _theme->base.z.z, 0,
+    0, 0, 0, 1
+  };
+  kmMat4Inverse(&_rectToHexMatrix, &mat);
+
+  _game->events().connect(_eventSlot, [this](wars::Game::Event const& e) {
     switch(e.type)
     {
       case wars::Game::EventType::GAMEDATA:
@@ -14,10 +22,10 @@ wars::GameScene::GameScene(wars::Game* game, Theme* theme) :
       }
       case wars::Game::EventType::MOVE:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.move.unitId);
-        wars::Game::Tile const& next = _game->getTile(*e.move.tileId);
-        wars::Game::Tile const& prev = _game->getTile(unit.tileId);
-        glhckObject* o = _units.at(unit.id).obj;
+        std::string const& unitId = _game->getUnitId(e.move.unit);
+        wars::Game::Tile const& next = _game->getTile(e.move.tile);
+        wars::Game::Tile const& prev = _game->getTile(e.move.from);
+        glhckObject* o = _units.at(unitId).obj;
         kmVec3 pos = hexToRect({static_cast<kmScalar>(next.x), static_cast<kmScalar>(next.y), 1});
         glhckObjectPositionf(o, pos.x, pos.y, pos.z);
 
@@ -27,106 +35,97 @@ wars::GameScene::GameScene(wars::Game* game, Theme* theme) :
       }
       case wars::Game::EventType::WAIT:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.wait.unitId);
-        wars::Game::Tile const& curr = _game->getTile(unit.tileId);
+        wars::Game::Tile const& curr = _game->getTile(e.wait.tile);
         _tiles.at(curr.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::ATTACK:
       {
-        wars::Game::Unit const& attacker = _game->getUnit(*e.attack.attackerId);
-        wars::Game::Unit const& target = _game->getUnit(*e.attack.targetId);
-        _tiles.at(attacker.tileId).labelUpdate = true;
-        _tiles.at(target.tileId).labelUpdate = true;
+        _tiles.at(_game->getTile(e.attack.attackerTile).id).labelUpdate = true;
+        _tiles.at(_game->getTile(e.attack.targetTile).id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::COUNTERATTACK:
       {
-        wars::Game::Unit const& attacker = _game->getUnit(*e.counterattack.attackerId);
-        wars::Game::Unit const& target = _game->getUnit(*e.counterattack.targetId);
-        _tiles.at(attacker.tileId).labelUpdate = true;
-        _tiles.at(target.tileId).labelUpdate = true;
+        _tiles.at(_game->getTile(e.counterattack.attackerTile).id).labelUpdate = true;
+        _tiles.at(_game->getTile(e.counterattack.targetTile).id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::CAPTURE:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.capture.unitId);
-        wars::Game::Tile const& tile = _game->getTile(*e.capture.tileId);
+        wars::Game::Tile const& tile = _game->getTile(e.capture.tile);
         _tiles.at(tile.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::CAPTURED:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.captured.unitId);
-        wars::Game::Tile const& tile = _game->getTile(*e.captured.tileId);
+        wars::Game::Tile const& tile = _game->getTile(e.captured.tile);
         auto tileIter = _tiles.find(tile.id);
         if(tileIter != _tiles.end()  && tileIter->second.prop != nullptr)
         {
-          updatePropTexture(tileIter->second.prop, tile.type, unit.owner);
+          updatePropTexture(tileIter->second.prop, tile.type, e.captured.owner);
         }
         _tiles.at(tile.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::DEPLOY:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.deploy.unitId);
-        wars::Game::Tile const& curr = _game->getTile(unit.tileId);
+        wars::Game::Tile const& curr = _game->getTile(e.deploy.tile);
         _tiles.at(curr.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::UNDEPLOY:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.undeploy.unitId);
-        wars::Game::Tile const& curr = _game->getTile(unit.tileId);
+        wars::Game::Tile const& curr = _game->getTile(e.undeploy.tile);
         _tiles.at(curr.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::LOAD:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.load.unitId);
-        wars::Game::Unit const& carrier = _game->getUnit(*e.load.carrierId);
-        wars::Game::Tile const& curr = _game->getTile(unit.tileId);
-        glhckObject* o = _units.at(unit.id).obj;
-        _units.erase(unit.id);
+        std::string const& unitId = _game->getUnitId(e.load.unit);
+        wars::Game::Tile const& curr = _game->getTile(e.load.tile);
+        glhckObject* o = _units.at(unitId).obj;
+        _units.erase(unitId);
         glhckObjectFree(o);
         _tiles.at(curr.id).labelUpdate = true;
-        _tiles.at(carrier.tileId).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::UNLOAD:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.unload.unitId);
-        wars::Game::Unit const& carrier = _game->getUnit(*e.unload.carrierId);
-        wars::Game::Tile const& next = _game->getTile(*e.unload.tileId);
+        wars::Game::Unit const& unit = _game->getUnit(e.unload.unit);
+        wars::Game::Tile const& prev = _game->getTile(e.unload.from);
+        wars::Game::Tile const& next = _game->getTile(e.unload.tile);
         glhckObject* unitObject = createUnitObject(unit);
         _units[unit.id] = {unit.id, unitObject};
         kmVec3 pos = hexToRect({static_cast<kmScalar>(next.x), static_cast<kmScalar>(next.y), 1});
         glhckObjectPositionf(unitObject, pos.x, pos.y, pos.z);
-        _tiles.at(carrier.tileId).labelUpdate = true;
+        _tiles.at(prev.id).labelUpdate = true;
         _tiles.at(next.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::DESTROY:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.destroy.unitId);
-        wars::Game::Tile const& curr = _game->getTile(unit.tileId);
-        glhckObject* o = _units.at(unit.id).obj;
-        _units.erase(unit.id);
-        glhckObjectFree(o);
-        _tiles.at(curr.id).labelUpdate = true;
+        // Carried units have no object or tile
+        auto unitIter = _units.find(_game->getUnitId(e.destroy.unit));
+        if(unitIter != _units.end())
+        {
+          glhckObjectFree(unitIter->second.obj);
+          _units.erase(unitIter);
+        }
+        if(e.destroy.tile >= 0)
+          _tiles.at(_game->getTile(e.destroy.tile).id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::REPAIR:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.repair.unitId);
-        wars::Game::Tile const& curr = _game->getTile(unit.tileId);
+        wars::Game::Tile const& curr = _game->getTile(e.repair.tile);
         _tiles.at(curr.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::BUILD:
       {
-        wars::Game::Unit const& unit = _game->getUnit(*e.build.unitId);
-        wars::Game::Tile const& tile = _game->getTile(*e.build.tileId);
+        wars::Game::Unit const& unit = _game->getUnit(e.build.unit);
+        wars::Game::Tile const& tile = _game->getTile(e.build.tile);
         glhckObject* unitObject = createUnitObject(unit);
         if(unitObject != nullptr)
           _units[unit.id] = {unit.id, unitObject};
@@ -135,13 +134,13 @@ wars::GameScene::GameScene(wars::Game* game, Theme* theme) :
       }
       case wars::Game::EventType::REGENERATE_CAPTURE_POINTS:
       {
-        wars::Game::Tile const& tile = _game->getTile(*e.regenerateCapturePoints.tileId);
+        wars::Game::Tile const& tile = _game->getTile(e.regenerateCapturePoints.tile);
         _tiles.at(tile.id).labelUpdate = true;
         break;
       }
       case wars::Game::EventType::PRODUCE_FUNDS:
       {
-        wars::Game::Tile const& tile = _game->getTile(*e.produceFunds.tileId);
+        wars::Game::Tile const& tile = _game->getTile(e.produceFunds.tile);
         _tiles.at(tile.id).labelUpdate = true;
         break;
       }
@@ -182,27 +181,25 @@ void wars::GameScene::render()
   glhckRenderClear(GLHCK_DEPTH_BUFFER_BIT | GLHCK_COLOR_BUFFER_BIT);
 
   bool tilesHighlighted = false;
-  for(auto& item : _tiles)
+  for(Tile* tile : _tileOrder)
   {
-    Game::Tile const& tile = _game->getTile(item.first);
-
     bool selected = false; /*tile.x == _inputState.hexCursor.x
         && tile.y == _inputState.hexCursor.y;*/
-    glhckObjectDrawAABB(item.second.hex, selected);
-    glhckObjectDraw(item.second.hex);
+    glhckObjectDrawAABB(tile->hex, selected);
+    glhckObjectDraw(tile->hex);
 
-    tilesHighlighted |= item.second.effects.highlight;
+    tilesHighlighted |= tile->effects.highlight;
   }
   glhckRender();
 
   if(tilesHighlighted)
   {
     glhckRenderBlendFunc(GLHCK_ONE, GLHCK_ONE);
-    for(auto& item : _tiles)
+    for(Tile* tile : _tileOrder)
     {
-      if(item.second.effects.highlight)
+      if(tile->effects.highlight)
       {
-        glhckObjectDraw(item.second.hex);
+        glhckObjectDraw(tile->hex);
       }
     }
 
@@ -210,22 +207,22 @@ void wars::GameScene::render()
     glhckRenderBlendFunc(GLHCK_ZERO, GLHCK_ZERO);
   }
 
-  for(auto& item : _tiles)
+  for(Tile* tile : _tileOrder)
   {
-    if(item.second.prop != nullptr)
-      glhckObjectDraw(item.second.prop);
+    if(tile->prop != nullptr)
+      glhckObjectDraw(tile->prop);
   }
   glhckRender();
 
   if(tilesHighlighted)
   {
     glhckRenderBlendFunc(GLHCK_ONE, GLHCK_ONE);
-    for(auto& item : _tiles)
+    for(Tile* tile : _tileOrder)
     {
-      if(item.second.effects.highlight)
+      if(tile->effects.highlight)
       {
-        if(item.second.prop != nullptr)
-          glhckObjectDraw(item.second.prop);
+        if(tile->prop != nullptr)
+          glhckObjectDraw(tile->prop);
       }
     }
 
@@ -271,21 +268,21 @@ void wars::GameScene::render()
   glhckRenderClear(GLHCK_DEPTH_BUFFER_BIT);
   glhckRenderBlendFunc(GLHCK_SRC_ALPHA, GLHCK_ONE_MINUS_SRC_ALPHA);
 
-  for(auto& item : _tiles)
+  for(Tile* tile : _tileOrder)
   {
-    if(item.second.labelUpdate)
+    if(tile->labelUpdate)
     {
-      updateHexLabel(item.first);
-      item.second.labelUpdate = false;
+      updateHexLabel(tile->id);
+      tile->labelUpdate = false;
     }
 
-    if(item.second.label.isVisible())
+    if(tile->label.isVisible())
     {
-      const kmVec3* pos = glhckObjectGetPosition(item.second.hex);
-      glhckObjectPosition(item.second.label.getObject(), pos);
-      glhckObjectRotationf(item.second.label.getObject(), 45, 0, 0);
-      glhckObjectMovef(item.second.label.getObject(), 0, -1.5, 1);
-      glhckObjectDraw(item.second.label.getObject());
+      const kmVec3* pos = glhckObjectGetPosition(tile->hex);
+      glhckObjectPosition(tile->label.getObject(), pos);
+      glhckObjectRotationf(tile->label.getObject(), 45, 0, 0);
+      glhckObjectMovef(tile->label.getObject(), 0, -1.5, 1);
+      glhckObjectDraw(tile->label.getObject());
     }
   }
 
@@ -307,16 +304,7 @@ kmVec3 wars::GameScene::hexToRect(const kmVec3& v)
 kmVec3 wars::GameScene::rectToHex(const kmVec3& v)
 {
   kmVec3 result;
-  kmMat4 mat = {
-    _theme->base.x.x, _theme->base.x.y, _theme->base.x.z, 0,
-    _theme->base.y.x, _theme->base.y.y, _theme->base.y.z, 0,
-    _theme->base.z.x, _theme->base.z.y, _theme->base.z.z, 0,
-    0, 0, 0, 1
-  };
-
-  kmMat4Inverse(&mat, &mat);
-
-  kmVec3Transform(&result, &v, &mat);
+  kmVec3Transform(&result, &v, &_rectToHexMatrix);
   return result;
 }
 
@@ -408,6 +396,13 @@ void wars::GameScene::initializeFromGame()
   kmVec3Add(&skySpherePosition, &minWorldCoords, &maxWorldCoords);
   kmVec3Scale(&skySpherePosition, &skySpherePosition, 0.5);
 
+  // Draw tiles in the game's tile handle order, which follows the map
+  _tileOrder.clear();
+  for(std::string const& tileId : _game->getTileColumns().ids)
+  {
+    _tileOrder.push_back(&_tiles.at(tileId));
+  }
+
   _sky = glhckModelNew("models/sky.glhckm", skySphereSize, glhckImportDefaultModelParameters());
   glhckObjectPosition(_sky, &skySpherePosition);
 
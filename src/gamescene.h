@@ -63,11 +63,13 @@ namespace wars
     Game* _game;
     Theme* _theme;
     glhckObject* _sky;
+    kmMat4 _rectToHexMatrix;
 
     std::unordered_map<std::string, Unit> _units;
     std::unordered_map<std::string, Tile> _tiles;
+    std::vector<Tile*> _tileOrder;
 
-    Stream<wars::Game::Event>::Subscription _eventSub;
+    Stream<wars::Game::Event>::Slot _eventSlot;
   };
 
 }
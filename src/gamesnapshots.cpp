@@ -0,0 +1,150 @@
+#include "gamesnapshots.h"
+
+#include <stdexcept>
+
+wars::GameSnapshots::GameSnapshots() : _current(nullptr), _epoch(1), _retired(), _version(0)
+{
+  for(int i = 0; i < MAX_READERS; ++i)
+  {
+    _claimed[i].store(false);
+    _pinned[i].store(0);
+  }
+}
+
+wars::GameSnapshots::~GameSnapshots()
+{
+  for(Retired const& retired : _retired)
+  {
+    delete retired.version;
+  }
+  delete _current.load();
+}
+
+void wars::GameSnapshots::publish(const wars::Game& game)
+{
+  Version* previous = _current.exchange(new Version(game, ++_version));
+
+  // Readers that pinned after the epoch advances can only see the new version
+  if(previous != nullptr)
+  {
+    _retired.push_back({previous, _epoch.fetch_add(1)});
+  }
+
+  reclaim();
+}
+
+void wars::GameSnapshots::reclaim()
+{
+  unsigned long oldestPin = 0;
+  for(int i = 0; i < MAX_READERS; ++i)
+  {
+    unsigned long const pinned = _pinned[i].load();
+    if(pinned != 0 && (oldestPin == 0 || pinned < oldestPin))
+      oldestPin = pinned;
+  }
+
+  auto iter = _retired.begin();
+  while(iter != _retired.end())
+  {
+    if(oldestPin == 0 || oldestPin > iter->epoch)
+    {
+      delete iter->version;
+      iter = _retired.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+}
+
+unsigned long wars::GameSnapshots::version() const
+{
+  return _version;
+}
+
+unsigned int wars::GameSnapshots::retiredCount() const
+{
+  return _retired.size();
+}
+
+wars::GameSnapshots::Reader::Reader(wars::GameSnapshots& snapshots) : _snapshots(snapshots), _slot(-1), _pinCount(0)
+{
+  for(int i = 0; i < MAX_READERS && _slot < 0; ++i)
+  {
+    bool expected = false;
+    if(_snapshots._claimed[i].compare_exchange_strong(expected, true))
+      _slot = i;
+  }
+
+  if(_slot < 0)
+  {
+    throw std::runtime_error("No free game snapshot reader slots");
+  }
+}
+
+wars::GameSnapshots::Reader::~Reader()
+{
+  _snapshots._pinned[_slot].store(0);
+  _snapshots._claimed[_slot].store(false);
+}
+
+wars::GameSnapshots::Snapshot wars::GameSnapshots::Reader::pin()
+{
+  // Announce the epoch before loading so the version can't be reclaimed in between
+  if(_pinCount++ == 0)
+  {
+    _snapshots._pinned[_slot].store(_snapshots._epoch.load());
+  }
+
+  return Snapshot(this, _snapshots._current.load());
+}
+
+void wars::GameSnapshots::Reader::unpin()
+{
+  if(--_pinCount == 0)
+  {
+    _snapshots._pinned[_slot].store(0);
+  }
+}
+
+wars::GameSnapshots::Snapshot::Snapshot(wars::GameSnapshots::Reader* reader, Version const* version) :
+  _reader(reader), _version(version)
+{
+
+}
+
+wars::GameSnapshots::Snapshot::Snapshot(wars::GameSnapshots::Snapshot&& other) :
+  _reader(other._reader), _version(other._version)
+{
+  other._reader = nullptr;
+  other._version = nullptr;
+}
+
+wars::GameSnapshots::Snapshot::~Snapshot()
+{
+  if(_reader != nullptr)
+  {
+    _reader->unpin();
+  }
+}
+
+bool wars::GameSnapshots::Snapshot::valid() const
+{
+  return _version != nullptr;
+}
+
+unsigned long wars::GameSnapshots::Snapshot::version() const
+{
+  return _version != nullptr ? _version->number : 0;
+}
+
+const wars::Game& wars::GameSnapshots::Snapshot::game() const
+{
+  return _version->game;
+}
+
+const wars::Game* wars::GameSnapshots::Snapshot::operator->() const
+{
+  return &_version->game;
+}
@@ -0,0 +1,102 @@
+#ifndef WARS_GAMESNAPSHOTS_H
+#define WARS_GAMESNAPSHOTS_H
+
+#include "game.h"
+
+#include <atomic>
+#include <vector>
+
+namespace wars
+{
+  // Immutable versions of a game for readers on other threads. The game
+  // thread publishes a copy when readers need the current state. Readers pin
+  // the current version without locking, and versions are deleted once no
+  // reader pinned before their replacement is still holding them.
+  class GameSnapshots
+  {
+  private:
+    struct Version;
+
+  public:
+    static const int MAX_READERS = 32;
+
+    class Reader;
+
+    // Pinned version, valid until destroyed
+    class Snapshot
+    {
+    public:
+      Snapshot(Snapshot&& other);
+      ~Snapshot();
+      Snapshot(Snapshot const&) = delete;
+      Snapshot& operator=(Snapshot const&) = delete;
+
+      bool valid() const;
+      unsigned long version() const;
+      Game const& game() const;
+      Game const* operator->() const;
+
+    private:
+      friend class Reader;
+      Snapshot(Reader* reader, Version const* version);
+
+      Reader* _reader;
+      Version const* _version;
+    };
+
+    // Reader slot for one thread
+    class Reader
+    {
+    public:
+      Reader(GameSnapshots& snapshots);
+      ~Reader();
+      Reader(Reader const&) = delete;
+      Reader& operator=(Reader const&) = delete;
+
+      Snapshot pin();
+
+    private:
+      friend class Snapshot;
+      void unpin();
+
+      GameSnapshots& _snapshots;
+      int _slot;
+      int _pinCount;
+    };
+
+    GameSnapshots();
+    ~GameSnapshots();
+    GameSnapshots(GameSnapshots const&) = delete;
+    GameSnapshots& operator=(GameSnapshots const&) = delete;
+
+    // Game thread only
+    void publish(Game const& game);
+    void reclaim();
+    unsigned long version() const;
+    unsigned int retiredCount() const;
+
+  private:
+    struct Version
+    {
+      Version(Game const& game, unsigned long number) : game(game.snapshot()), number(number)
+      {}
+
+      Game const game;
+      unsigned long const number;
+    };
+
+    struct Retired
+    {
+      Version* version;
+      unsigned long epoch;
+    };
+
+    std::atomic<Version*> _current;
+    std::atomic<unsigned long> _epoch;
+    std::atomic<bool> _claimed[MAX_READERS];
+    std::atomic<unsigned long> _pinned[MAX_READERS]; // epoch at pin, 0 if not pinned
+    std::vector<Retired> _retired;
+    unsigned long _version;
+  };
+}
+#endif // WARS_GAMESNAPSHOTS_H
@@ -1,4 +1,5 @@
 #include "glhckview.h"
+#include "hex.h"
 #include <iostream>
 #include <stdexcept>
 #include <cmath>
@@ -49,8 +50,8 @@ void wars::GlhckView::term()
 }
 
 wars::GlhckView::GlhckView(Input* input) :
-  _input(input), _game(nullptr), _gameScene(nullptr), _window(nullptr), _shouldQuit(false),  _menu(),
-  _funds(0), _statusText(nullptr), _statusFont(0), _gameInitialized(false)
+  _input(input), _game(nullptr), _precompute(nullptr), _gameScene(nullptr), _window(nullptr), _shouldQuit(false),  _menu(),
+  _fundsCheckCountdown(0), _fundsChanges(0), _statusText(nullptr), _statusFont(0), _gameInitialized(false)
 {
   _window = glfwCreateWindow(800, 480, "warshck", NULL, NULL);
   _glfwEvents = glfwhckEventQueueNew(_window, GLFWHCK_EVENTS_ALL);
@@ -100,12 +101,14 @@ void wars::GlhckView::setGame(Game* game)
     delete _gameScene;
   _gameScene = new GameScene(_game, &_theme);
 
-  eventSub = _game->events().on([this](wars::Game::Event const& e) {
+  _game->events().connect(eventSlot, [this](wars::Game::Event const& e) {
     switch(e.type)
     {
       case wars::Game::EventType::GAMEDATA:
       {
-        updateFunds();
+        ++_fundsChanges;
+        _fundsCheckCountdown = FUNDS_CHECK_INTERVAL;
+        checkFunds();
         _gameInitialized = true;
         _inputState.acceptInput = true;
         break;
@@ -156,11 +159,12 @@ void wars::GlhckView::setGame(Game* game)
       }
       case wars::Game::EventType::REPAIR:
       {
+        ++_fundsChanges;
         break;
       }
       case wars::Game::EventType::BUILD:
       {
-        updateFunds();
+        ++_fundsChanges;
         break;
       }
       case wars::Game::EventType::REGENERATE_CAPTURE_POINTS:
@@ -169,11 +173,17 @@ void wars::GlhckView::setGame(Game* game)
       }
       case wars::Game::EventType::PRODUCE_FUNDS:
       {
+        ++_fundsChanges;
         break;
       }
       case wars::Game::EventType::BEGIN_TURN:
       {
-        updateFunds();
+        // Funds are tracked locally, only verify them every few turns
+        if(--_fundsCheckCountdown <= 0)
+        {
+          _fundsCheckCountdown = FUNDS_CHECK_INTERVAL;
+          checkFunds();
+        }
         break;
       }
       case wars::Game::EventType::END_TURN:
@@ -200,6 +210,11 @@ void wars::GlhckView::setGame(Game* game)
   });
 }
 
+void wars::GlhckView::setOptionsPrecompute(OptionsPrecompute* precompute)
+{
+  _precompute = precompute;
+}
+
 bool wars::GlhckView::handle()
 {
   if(!_gameInitialized)
@@ -391,8 +406,9 @@ void wars::GlhckView::handleInput()
     kmRay3IntersectPlane(&pointer, &_inputState.mouse.ray, &plane);
 
     pointer = _gameScene->rectToHex(pointer);
-    _inputState.hexCursor.x = static_cast<int>(std::round(pointer.x));
-    _inputState.hexCursor.y = static_cast<int>(std::round(pointer.y));
+    hex::Hex cursor = hex::round(pointer.x, pointer.y);
+    _inputState.hexCursor.x = cursor.x;
+    _inputState.hexCursor.y = cursor.y;
   }
 
   if(_inputState.mouse.leftButton)
@@ -446,7 +462,8 @@ void wars::GlhckView::handleClick()
             if(unit.owner == inTurn.playerNumber && !unit.moved)
             {
               _inputState.selected.unitId = unit.id;
-              _inputState.hexOptions = _game->findMovementOptions(unit.id);
+              if(_precompute == nullptr || !_precompute->getMovementOptions(unit.id, _inputState.hexOptions))
+                _game->findMovementOptions(unit.id, _inputState.hexOptions);
               if(unit.deployed || _inputState.hexOptions.size() <= 1)
               {
                 _phase = Phase::ACTION;
@@ -626,8 +643,6 @@ void wars::GlhckView::handleKey(int key)
           case Action::ATTACK:
           {
             _phase = Phase::ATTACK;
-            Game::Tile const& tile = _game->getTile(_inputState.selected.tileId);
-            _inputState.attackOptions = _game->findAttackOptions(_inputState.selected.unitId, {tile.x, tile.y});
             std::cout << "Attack options:" << std::endl;
             for(auto const& o : _inputState.attackOptions)
             {
@@ -761,7 +776,7 @@ void wars::GlhckView::handleKey(int key)
 
         Game::Unit const& carrier = _game->getUnit(_inputState.selected.unitId);
         Game::Unit const& carried = _game->getUnit(carrier.carriedUnits.at(_inputState.selected.carriedIndex));
-        _inputState.hexOptions = _game->unitUnloadUnitFromTileOptions(carrier.id, carried.id, _inputState.selected.tileId);
+        _game->unitUnloadUnitFromTileOptions(carrier.id, carried.id, _inputState.selected.tileId, _inputState.hexOptions);
 
         _gameScene->setHighlightedTiles(_inputState.hexOptions);
       }
@@ -777,7 +792,7 @@ void wars::GlhckView::handleKey(int key)
       if(_menu.input(key, &result))
       {
         UnitType const& unitType = _game->getRules().unitTypes.at(result);
-        if(_funds >= unitType.price)
+        if(myFunds() >= unitType.price)
         {
           std::cout << "Build unit id " << result << std::endl;
           Game::Tile const& tile = _game->getTile(_inputState.selected.tileId);
@@ -843,23 +858,27 @@ void wars::GlhckView::handleKey(int key)
 
 void wars::GlhckView::initializeActionMenu()
 {
+  Game::ActionOptions options;
   Game::Tile const& tile = _game->getTile(_inputState.selected.tileId);
+  if(_precompute == nullptr || !_precompute->getActionOptions(_inputState.selected.unitId, {tile.x, tile.y}, options))
+    options = _game->findActionOptions(_inputState.selected.unitId, _inputState.selected.tileId);
+  _inputState.attackOptions = options.attackTargets;
 
   _menu.clear();
   _menu.addOption(Action::CANCEL, "Cancel");
-  if(!_game->unitCanLoadInto(_inputState.selected.unitId, tile.unitId))
+  if(options.has(Game::UnitAction::WAIT))
     _menu.addOption(Action::WAIT, "Wait");
-  if(_game->unitCanAttackFromTile(_inputState.selected.unitId, _inputState.selected.tileId))
+  if(options.has(Game::UnitAction::ATTACK))
     _menu.addOption(Action::ATTACK, "Attack");
-  if(_game->unitCanCaptureTile(_inputState.selected.unitId, _inputState.selected.tileId))
+  if(options.has(Game::UnitAction::CAPTURE))
     _menu.addOption(Action::CAPTURE, "Capture");
-  if(_game->unitCanDeployAtTile(_inputState.selected.unitId, _inputState.selected.tileId))
+  if(options.has(Game::UnitAction::DEPLOY))
     _menu.addOption(Action::DEPLOY, "Deploy");
-  if(_game->unitCanUndeploy(_inputState.selected.unitId, _inputState.selected.tileId))
+  if(options.has(Game::UnitAction::UNDEPLOY))
     _menu.addOption(Action::UNDEPLOY, "Undeploy");
-  if(_game->unitCanLoadInto(_inputState.selected.unitId, tile.unitId))
+  if(options.has(Game::UnitAction::LOAD))
     _menu.addOption(Action::LOAD, "Load");
-  if(_game->unitCanUnloadAtTile(_inputState.selected.unitId, _inputState.selected.tileId))
+  if(options.has(Game::UnitAction::UNLOAD))
     _menu.addOption(Action::UNLOAD, "Unload");
   _menu.update();
 }
@@ -880,7 +899,7 @@ void wars::GlhckView::updateStatusText()
 
   std::ostringstream oss;
   oss << PHASE_NAMES[static_cast<int>(_phase)]
-      << " | " << _funds << " credits";
+      << " | " << myFunds() << " credits";
   oss << " | " << "Player " << _game->getInTurn().playerNumber << " (" << _game->getInTurn().playerName << ")";
   setStatusText(oss.str());
 }
@@ -900,13 +919,35 @@ void wars::GlhckView::setStatusText(const std::string& str)
   glhckTextStash(_statusText, _statusFont, 24, 4, h, str.data(), nullptr);
 }
 
-void wars::GlhckView::updateFunds()
+void wars::GlhckView::checkFunds()
 {
-  _input->funds(_game->getGameId()).then<void>([this](int const& value) {
-    _funds = value;
+  // Funds changed locally while the request was in flight make the reply stale
+  int const fundsChanges = _fundsChanges;
+  _input->funds(_game->getGameId()).then<void>([this, fundsChanges](int const& value) {
+    if(fundsChanges != _fundsChanges)
+      return;
+
+    for(auto const& item : _game->getPlayers())
+    {
+      if(item.second.isMe && item.second.funds != value)
+      {
+        std::cerr << "Local funds " << item.second.funds << " differ from server funds " << value << std::endl;
+        _game->setFunds(item.first, value);
+      }
+    }
   });
 }
 
+int wars::GlhckView::myFunds() const
+{
+  for(auto const& item : _game->getPlayers())
+  {
+    if(item.second.isMe)
+      return item.second.funds;
+  }
+  return 0;
+}
+
 wars::Input::Path wars::GlhckView::convertPath(const wars::Game::Path& path) const
 {
   Input::Path result;
@@ -10,6 +10,7 @@
 #include "textmenu.h"
 #include "gamescene.h"
 #include "theme.h"
+#include "optionsprecompute.h"
 
 #include <string>
 #include <unordered_map>
@@ -27,10 +28,13 @@ namespace wars
     ~GlhckView();
 
     void setGame(Game* game) override;
+    void setOptionsPrecompute(OptionsPrecompute* precompute);
     bool handle() override;
     void quit();
 
   private:
+    static const int FUNDS_CHECK_INTERVAL = 5; // turns between server funds checks
+
 /*    struct Unit
     {
       std::string id;
@@ -100,7 +104,8 @@ namespace wars
     void initializeActionMenu();
     void updateStatusText();
     void setStatusText(std::string const& str);
-    void updateFunds();
+    void checkFunds();
+    int myFunds() const;
 //    void updatePropTexture(glhckObject* o, int terrainId, int owner);
 //    void updateHexLabel(std::string const& id);
 
@@ -112,8 +117,9 @@ namespace wars
 */
     Input* _input;
     Game* _game;
+    OptionsPrecompute* _precompute;
     GameScene* _gameScene;
-    Stream<wars::Game::Event>::Subscription eventSub;
+    Stream<wars::Game::Event>::Slot eventSlot;
     GLFWwindow* _window;
     glhckCamera* _camera;
     glfwhckEventQueue* _glfwEvents;
@@ -133,7 +139,8 @@ namespace wars
 
     TextMenu _menu;
 
-    int _funds;
+    int _fundsCheckCountdown;
+    int _fundsChanges; // funds changing events, counted to spot stale server funds
     glhckText* _statusText;
     unsigned int _statusFont;
 
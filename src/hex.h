@@ -0,0 +1,186 @@
+#ifndef WARS_HEX_H
+#define WARS_HEX_H
+
+#include <cmath>
+
+// Axial hex coordinate math. Neighbors of (x, y) are offset by
+// (±1, 0), (0, ±1), (+1, -1) and (-1, +1); cube coordinates add z = -x - y.
+namespace wars
+{
+  namespace hex
+  {
+    struct Hex
+    {
+      int x;
+      int y;
+    };
+
+    struct Cube
+    {
+      int x;
+      int y;
+      int z;
+    };
+
+    // Opposite directions are adjacent, so direction ^ 1 reverses direction
+    constexpr Hex NEIGHBORS[6] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, -1}, {-1, 1}};
+
+    // Directions in order around a hexagon, used to walk rings
+    constexpr Hex RING_DIRECTIONS[6] = {{1, 0}, {1, -1}, {0, -1}, {-1, 0}, {-1, 1}, {0, 1}};
+
+    constexpr Hex neighbor(Hex const& h, int direction)
+    {
+      return {h.x + NEIGHBORS[direction].x, h.y + NEIGHBORS[direction].y};
+    }
+
+    constexpr Cube toCube(Hex const& h)
+    {
+      return {h.x, h.y, -h.x - h.y};
+    }
+
+    constexpr Hex fromCube(Cube const& c)
+    {
+      return {c.x, c.y};
+    }
+
+    constexpr int abs(int v)
+    {
+      return (v ^ (v >> 31)) - (v >> 31);
+    }
+
+    constexpr int distance(int dx, int dy)
+    {
+      return (abs(dx) + abs(dy) + abs(dx + dy)) / 2;
+    }
+
+    constexpr int distance(Hex const& a, Hex const& b)
+    {
+      return distance(b.x - a.x, b.y - a.y);
+    }
+
+    // Nearest hex to fractional axial coordinates
+    template<typename T>
+    Hex round(T x, T y)
+    {
+      T const z = -x - y;
+      T rx = std::round(x);
+      T ry = std::round(y);
+      T const rz = std::round(z);
+
+      T const dx = std::abs(rx - x);
+      T const dy = std::abs(ry - y);
+      T const dz = std::abs(rz - z);
+
+      // Fix the coordinate with the largest rounding error
+      if(dx > dy && dx > dz)
+        rx = -ry - rz;
+      else if(dy > dz)
+        ry = -rx - rz;
+
+      return {static_cast<int>(rx), static_cast<int>(ry)};
+    }
+
+    // Hexes at exactly the given distance from a center
+    class Ring
+    {
+    public:
+      class Iterator
+      {
+      public:
+        constexpr Iterator(Hex const& current, int radius, int side, int step) :
+          _current(current), _radius(radius), _side(side), _step(step)
+        {}
+
+        Hex const& operator*() const { return _current; }
+        bool operator!=(Iterator const& other) const { return _side != other._side || _step != other._step; }
+
+        Iterator& operator++()
+        {
+          if(_radius == 0)
+          {
+            _side = 6;
+            return *this;
+          }
+
+          _current.x += RING_DIRECTIONS[_side].x;
+          _current.y += RING_DIRECTIONS[_side].y;
+          if(++_step == _radius)
+          {
+            _step = 0;
+            ++_side;
+          }
+          return *this;
+        }
+
+      private:
+        Hex _current;
+        int _radius;
+        int _side;
+        int _step;
+      };
+
+      constexpr Ring(Hex const& center, int radius) : _center(center), _radius(radius) {}
+
+      Iterator begin() const
+      {
+        return Iterator({_center.x + RING_DIRECTIONS[4].x * _radius, _center.y + RING_DIRECTIONS[4].y * _radius}, _radius, _radius < 0 ? 6 : 0, 0);
+      }
+      Iterator end() const { return Iterator(_center, _radius, 6, 0); }
+
+    private:
+      Hex _center;
+      int _radius;
+    };
+
+    // Hexes within a range of distances from a center, ring by ring outwards
+    class Spiral
+    {
+    public:
+      class Iterator
+      {
+      public:
+        Iterator(Hex const& center, int radius, int maxRadius, bool atEnd) :
+          _center(center), _radius(radius), _maxRadius(maxRadius),
+          _ring(atEnd ? Ring(center, radius).end() : Ring(center, radius).begin())
+        {}
+
+        Hex const& operator*() const { return *_ring; }
+        int radius() const { return _radius; }
+        bool operator!=(Iterator const& other) const { return _radius != other._radius || _ring != other._ring; }
+
+        Iterator& operator++()
+        {
+          ++_ring;
+          if(!(_ring != Ring(_center, _radius).end()) && _radius < _maxRadius)
+          {
+            ++_radius;
+            _ring = Ring(_center, _radius).begin();
+          }
+          return *this;
+        }
+
+      private:
+        Hex _center;
+        int _radius;
+        int _maxRadius;
+        Ring::Iterator _ring;
+      };
+
+      constexpr Spiral(Hex const& center, int minRadius, int maxRadius) :
+        _center(center), _minRadius(minRadius < 0 ? 0 : minRadius), _maxRadius(maxRadius)
+      {}
+
+      Iterator begin() const
+      {
+        return _minRadius > _maxRadius ? end() : Iterator(_center, _minRadius, _maxRadius, false);
+      }
+      Iterator end() const { return Iterator(_center, _maxRadius, _maxRadius, true); }
+
+    private:
+      Hex _center;
+      int _minRadius;
+      int _maxRadius;
+    };
+  }
+}
+#endif // WARS_HEX_H
@@ -0,0 +1,331 @@
+#include "jsonreader.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+  bool isDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  // Leading integer of a string, 0 if there is none. Integers past the
+  // range of long saturate.
+  long parseLong(char const* s, char const* end)
+  {
+    bool const negative = s < end && *s == '-';
+    if(negative)
+      ++s;
+
+    long const limit = std::numeric_limits<long>::max();
+    long result = 0;
+    for(; s < end && isDigit(*s); ++s)
+    {
+      int const digit = *s - '0';
+      if(result > (limit - digit) / 10)
+        return negative ? std::numeric_limits<long>::min() : limit;
+      result = result * 10 + digit;
+    }
+    return negative ? -result : result;
+  }
+
+  // Doubles past the range of long saturate, casting them is undefined
+  long toLong(double value)
+  {
+    double const limit = -static_cast<double>(std::numeric_limits<long>::min());
+    if(value >= limit)
+      return std::numeric_limits<long>::max();
+    if(value <= -limit)
+      return std::numeric_limits<long>::min();
+    return value == value ? static_cast<long>(value) : 0;
+  }
+}
+
+wars::JsonReader::JsonReader(const char* data, std::size_t length) :
+  _data(data), _length(length), _pos(0), _first(true), _key()
+{
+
+}
+
+wars::JsonReader::JsonReader(const std::string& text) :
+  JsonReader(text.data(), text.size())
+{
+
+}
+
+wars::JsonReader::Type wars::JsonReader::peek()
+{
+  skipWhitespace();
+  if(_pos >= _length)
+    return Type::NONE;
+
+  switch(_data[_pos])
+  {
+    case '{': return Type::OBJECT;
+    case '[': return Type::ARRAY;
+    case '"': return Type::STRING;
+    case 't':
+    case 'f': return Type::BOOLEAN;
+    case 'n': return Type::NULL_JSON;
+    default: return _data[_pos] == '-' || isDigit(_data[_pos]) ? Type::NUMBER : Type::NONE;
+  }
+}
+
+void wars::JsonReader::beginObject()
+{
+  skipWhitespace();
+  expect('{');
+  _first = true;
+}
+
+bool wars::JsonReader::nextMember()
+{
+  skipWhitespace();
+  if(_pos < _length && _data[_pos] == '}')
+  {
+    ++_pos;
+    _first = false;
+    return false;
+  }
+
+  if(!_first)
+  {
+    expect(',');
+    skipWhitespace();
+  }
+  _first = false;
+
+  _key.clear();
+  readStringInto(_key);
+  skipWhitespace();
+  expect(':');
+  return true;
+}
+
+void wars::JsonReader::beginArray()
+{
+  skipWhitespace();
+  expect('[');
+  _first = true;
+}
+
+bool wars::JsonReader::nextElement()
+{
+  skipWhitespace();
+  if(_pos < _length && _data[_pos] == ']')
+  {
+    ++_pos;
+    _first = false;
+    return false;
+  }
+
+  if(!_first)
+    expect(',');
+  _first = false;
+  return true;
+}
+
+const std::string& wars::JsonReader::key() const
+{
+  return _key;
+}
+
+int wars::JsonReader::keyInt() const
+{
+  return parseLong(_key.data(), _key.data() + _key.size());
+}
+
+long wars::JsonReader::readLong()
+{
+  if(peek() != Type::NUMBER)
+    fail("Expected a number");
+
+  std::size_t const start = _pos;
+  long result = parseLong(_data + _pos, _data + _length);
+  if(_data[_pos] == '-')
+    ++_pos;
+  while(_pos < _length && isDigit(_data[_pos]))
+  {
+    ++_pos;
+  }
+
+  // Fractions and exponents take the slow path
+  if(_pos < _length && (_data[_pos] == '.' || _data[_pos] == 'e' || _data[_pos] == 'E'))
+  {
+    _pos = start;
+    result = toLong(readDouble());
+  }
+  return result;
+}
+
+double wars::JsonReader::readDouble()
+{
+  if(peek() != Type::NUMBER)
+    fail("Expected a number");
+
+  std::size_t const start = _pos;
+  for(++_pos; _pos < _length; ++_pos)
+  {
+    char const c = _data[_pos];
+    if(!(isDigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'))
+      break;
+  }
+
+  // Numbers aren't terminated in the buffer
+  char buffer[64];
+  std::size_t const length = _pos - start;
+  if(length >= sizeof(buffer))
+    return std::strtod(std::string(_data + start, length).c_str(), nullptr);
+
+  std::memcpy(buffer, _data + start, length);
+  buffer[length] = '\0';
+  return std::strtod(buffer, nullptr);
+}
+
+bool wars::JsonReader::readBoolean()
+{
+  skipWhitespace();
+  if(_length - _pos >= 4 && std::strncmp(_data + _pos, "true", 4) == 0)
+  {
+    _pos += 4;
+    return true;
+  }
+  if(_length - _pos >= 5 && std::strncmp(_data + _pos, "false", 5) == 0)
+  {
+    _pos += 5;
+    return false;
+  }
+  fail("Expected a boolean");
+}
+
+std::string wars::JsonReader::readString()
+{
+  std::string result;
+  readString(result);
+  return result;
+}
+
+void wars::JsonReader::readString(std::string& out)
+{
+  out.clear();
+  skipWhitespace();
+  readStringInto(out);
+}
+
+bool wars::JsonReader::readNull()
+{
+  skipWhitespace();
+  if(_length - _pos >= 4 && std::strncmp(_data + _pos, "null", 4) == 0)
+  {
+    _pos += 4;
+    return true;
+  }
+  return false;
+}
+
+void wars::JsonReader::skip()
+{
+  // Brackets are counted without telling them apart, the structure of
+  // skipped values isn't validated
+  int depth = 0;
+  do
+  {
+    skipWhitespace();
+    if(_pos >= _length)
+      fail("Unexpected end of input");
+
+    char const c = _data[_pos];
+    if(depth == 0 && std::strchr(",:]}", c) != nullptr)
+      fail("Expected a value");
+
+    if(c == '{' || c == '[')
+    {
+      ++depth;
+      ++_pos;
+    }
+    else if(c == '}' || c == ']')
+    {
+      --depth;
+      ++_pos;
+    }
+    else if(c == ',' || c == ':')
+    {
+      ++_pos;
+    }
+    else if(c == '"')
+    {
+      for(++_pos; _pos < _length && _data[_pos] != '"'; ++_pos)
+      {
+        if(_data[_pos] == '\\')
+          ++_pos;
+      }
+      if(_pos >= _length)
+        fail("Unterminated string");
+      ++_pos;
+    }
+    else
+    {
+      std::size_t const start = _pos;
+      while(_pos < _length && std::strchr(",:]} \t\r\n", _data[_pos]) == nullptr)
+      {
+        ++_pos;
+      }
+      if(_pos == start)
+        fail("Unexpected character");
+    }
+  } while(depth > 0);
+
+  _first = false;
+}
+
+const char* wars::JsonReader::position()
+{
+  skipWhitespace();
+  return _data + _pos;
+}
+
+void wars::JsonReader::skipWhitespace()
+{
+  while(_pos < _length && (_data[_pos] == ' ' || _data[_pos] == '\t' || _data[_pos] == '\n' || _data[_pos] == '\r'))
+  {
+    ++_pos;
+  }
+}
+
+void wars::JsonReader::expect(char c)
+{
+  if(_pos >= _length || _data[_pos] != c)
+    fail("Unexpected character");
+  ++_pos;
+}
+
+void wars::JsonReader::readStringInto(std::string& out)
+{
+  expect('"');
+  std::size_t const start = _pos;
+  bool escaped = false;
+  for(; _pos < _length && _data[_pos] != '"'; ++_pos)
+  {
+    if(_data[_pos] == '\\')
+    {
+      escaped = true;
+      ++_pos;
+    }
+  }
+  if(_pos >= _length)
+    fail("Unterminated string");
+
+  if(escaped)
+    JsonView::unescape(_data + start, _pos - start, out);
+  else
+    out.append(_data + start, _pos - start);
+  ++_pos;
+}
+
+void wars::JsonReader::fail(const char* message) const
+{
+  throw std::runtime_error(std::string(message) + " in JSON at offset " + std::to_string(_pos));
+}
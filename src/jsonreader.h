@@ -0,0 +1,72 @@
+#ifndef WARS_JSONREADER_H
+#define WARS_JSONREADER_H
+
+#include "jsonview.h"
+
+#include <string>
+#include <cstddef>
+
+namespace wars
+{
+  // Forward-only JSON reader. Values are consumed in document order straight
+  // from the buffer, so callers fill their own structures as they go without
+  // a document in between. Malformed input throws std::runtime_error.
+  //
+  //   reader.beginObject();
+  //   while(reader.nextMember())
+  //   {
+  //     if(reader.key() == "id")
+  //       id = reader.readLong();
+  //     else
+  //       reader.skip();
+  //   }
+  class JsonReader
+  {
+  public:
+    typedef JsonView::Type Type;
+
+    JsonReader(char const* data, std::size_t length);
+    explicit JsonReader(std::string const& text);
+    JsonReader(JsonReader const&) = delete;
+    JsonReader& operator=(JsonReader const&) = delete;
+
+    // Type of the next value
+    Type peek();
+
+    // False once the closing bracket has been consumed. nextMember() leaves
+    // the member's name in key().
+    void beginObject();
+    bool nextMember();
+    void beginArray();
+    bool nextElement();
+
+    std::string const& key() const;
+    int keyInt() const;
+
+    long readLong();
+    double readDouble();
+    bool readBoolean();
+    std::string readString();
+    void readString(std::string& out);
+
+    // Consumes a null, leaves anything else
+    bool readNull();
+    void skip();
+
+    // Next unread character, for keeping the source of a value
+    char const* position();
+
+  private:
+    void skipWhitespace();
+    void expect(char c);
+    void readStringInto(std::string& out);
+    [[noreturn]] void fail(char const* message) const;
+
+    char const* _data;
+    std::size_t _length;
+    std::size_t _pos;
+    bool _first; // no separator before the next member or element
+    std::string _key;
+  };
+}
+#endif // WARS_JSONREADER_H
@@ -0,0 +1,459 @@
+#include "jsonview.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+  bool isWhitespace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  int hexDigit(char c)
+  {
+    if(c >= '0' && c <= '9')
+      return c - '0';
+    if(c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  unsigned int parseHex4(char const* s)
+  {
+    unsigned int result = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+      int const digit = hexDigit(s[i]);
+      if(digit < 0)
+        return 0xFFFD;
+      result = result * 16 + digit;
+    }
+    return result;
+  }
+
+  void appendUtf8(std::string& out, unsigned int codepoint)
+  {
+    if(codepoint < 0x80)
+    {
+      out += static_cast<char>(codepoint);
+    }
+    else if(codepoint < 0x800)
+    {
+      out += static_cast<char>(0xC0 | (codepoint >> 6));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else if(codepoint < 0x10000)
+    {
+      out += static_cast<char>(0xE0 | (codepoint >> 12));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else
+    {
+      out += static_cast<char>(0xF0 | (codepoint >> 18));
+      out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+  }
+}
+
+void wars::JsonView::unescape(const char* s, std::size_t length, std::string& out)
+{
+  for(std::size_t i = 0; i < length; ++i)
+  {
+    if(s[i] != '\\' || i + 1 == length)
+    {
+      out += s[i];
+      continue;
+    }
+
+    char const c = s[++i];
+    switch(c)
+    {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u':
+      {
+        if(i + 4 >= length)
+          return;
+
+        unsigned int codepoint = parseHex4(s + i + 1);
+        i += 4;
+
+        // Surrogate pair
+        if(codepoint >= 0xD800 && codepoint < 0xDC00 && i + 6 < length && s[i + 1] == '\\' && s[i + 2] == 'u')
+        {
+          unsigned int const low = parseHex4(s + i + 3);
+          if(low >= 0xDC00 && low < 0xE000)
+          {
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            i += 6;
+          }
+        }
+        appendUtf8(out, codepoint);
+        break;
+      }
+      default: out += c; break;
+    }
+  }
+}
+
+wars::JsonView::JsonView() :
+  _data(nullptr), _tokens(), _open()
+{
+
+}
+
+bool wars::JsonView::parse(const char* data, std::size_t length)
+{
+  if(!tokenize(data, length))
+  {
+    _data = nullptr;
+    _tokens.clear();
+    return false;
+  }
+  return true;
+}
+
+bool wars::JsonView::parse(const std::string& text)
+{
+  return parse(text.data(), text.size());
+}
+
+wars::JsonView::Value wars::JsonView::root() const
+{
+  return Value(this, _tokens.empty() ? -1 : 0);
+}
+
+bool wars::JsonView::tokenize(const char* data, std::size_t length)
+{
+  _data = data;
+  _tokens.clear();
+  _open.clear();
+
+  std::size_t p = 0;
+  bool needValue = true;
+  bool justOpened = false;
+
+  while(true)
+  {
+    while(p < length && isWhitespace(data[p]))
+      ++p;
+
+    if(_open.empty() && !needValue)
+      return p == length;
+
+    if(p >= length)
+      return false;
+
+    if(!needValue)
+    {
+      // Separator or end of the enclosing container
+      Token& parent = _tokens[_open.back()];
+      char const close = parent.type == Type::OBJECT ? '}' : ']';
+      if(data[p] == ',')
+      {
+        needValue = true;
+        ++p;
+        continue;
+      }
+      else if(data[p] == close)
+      {
+        parent.length = p + 1 - parent.start;
+        parent.next = _tokens.size();
+        _open.pop_back();
+        ++p;
+        continue;
+      }
+      return false;
+    }
+
+    if(!_open.empty())
+    {
+      Token& parent = _tokens[_open.back()];
+      char const close = parent.type == Type::OBJECT ? '}' : ']';
+      if(justOpened && data[p] == close)
+      {
+        parent.length = p + 1 - parent.start;
+        parent.next = _tokens.size();
+        _open.pop_back();
+        justOpened = false;
+        needValue = false;
+        ++p;
+        continue;
+      }
+
+      parent.count += 1;
+
+      if(parent.type == Type::OBJECT)
+      {
+        // Key, stored as a string token before its value
+        if(data[p] != '"')
+          return false;
+
+        Token key = {Type::STRING, false, static_cast<unsigned int>(p), 0, 0, 0, 0, 0};
+        for(++p; p < length && data[p] != '"'; ++p)
+        {
+          if(data[p] == '\\')
+          {
+            key.escaped = true;
+            ++p;
+          }
+        }
+        if(p >= length)
+          return false;
+        ++p;
+        key.length = p - key.start;
+        key.next = _tokens.size() + 1;
+        _tokens.push_back(key);
+
+        while(p < length && isWhitespace(data[p]))
+          ++p;
+        if(p >= length || data[p] != ':')
+          return false;
+        ++p;
+        while(p < length && isWhitespace(data[p]))
+          ++p;
+        if(p >= length)
+          return false;
+      }
+    }
+
+    justOpened = false;
+    Token token = {Type::NONE, false, static_cast<unsigned int>(p), 0, 0, 0, 0, 0};
+    char const c = data[p];
+    if(c == '{' || c == '[')
+    {
+      token.type = c == '{' ? Type::OBJECT : Type::ARRAY;
+      token.cursorToken = _tokens.size() + 1;
+      _open.push_back(_tokens.size());
+      _tokens.push_back(token);
+      justOpened = true;
+      ++p;
+      continue;
+    }
+    else if(c == '"')
+    {
+      token.type = Type::STRING;
+      for(++p; p < length && data[p] != '"'; ++p)
+      {
+        if(data[p] == '\\')
+        {
+          token.escaped = true;
+          ++p;
+        }
+      }
+      if(p >= length)
+        return false;
+      ++p;
+    }
+    else if(c == '-' || (c >= '0' && c <= '9'))
+    {
+      token.type = Type::NUMBER;
+      for(++p; p < length; ++p)
+      {
+        char const d = data[p];
+        if(!((d >= '0' && d <= '9') || d == '.' || d == 'e' || d == 'E' || d == '+' || d == '-'))
+          break;
+      }
+    }
+    else if(length - p >= 4 && std::strncmp(data + p, "true", 4) == 0)
+    {
+      token.type = Type::BOOLEAN;
+      p += 4;
+    }
+    else if(length - p >= 5 && std::strncmp(data + p, "false", 5) == 0)
+    {
+      token.type = Type::BOOLEAN;
+      p += 5;
+    }
+    else if(length - p >= 4 && std::strncmp(data + p, "null", 4) == 0)
+    {
+      token.type = Type::NULL_JSON;
+      p += 4;
+    }
+    else
+    {
+      return false;
+    }
+
+    token.length = p - token.start;
+    token.next = _tokens.size() + 1;
+    _tokens.push_back(token);
+    needValue = false;
+  }
+}
+
+bool wars::JsonView::matchesKey(const wars::JsonView::Token& token, const char* key, std::size_t keyLength) const
+{
+  char const* text = _data + token.start + 1;
+  std::size_t const textLength = token.length - 2;
+  if(!token.escaped)
+    return textLength == keyLength && std::memcmp(text, key, keyLength) == 0;
+
+  std::string unescaped;
+  unescape(text, textLength, unescaped);
+  return unescaped == std::string(key, keyLength);
+}
+
+wars::JsonView::Type wars::JsonView::Value::type() const
+{
+  return _token < 0 ? Type::NONE : _view->_tokens[_token].type;
+}
+
+wars::JsonView::Value wars::JsonView::Value::get(const char* key) const
+{
+  if(type() != Type::OBJECT)
+    return Value();
+
+  std::vector<Token> const& tokens = _view->_tokens;
+  std::size_t const keyLength = std::strlen(key);
+  unsigned int member = _token + 1;
+  for(unsigned int i = 0; i < tokens[_token].count; ++i)
+  {
+    unsigned int const value = member + 1;
+    if(_view->matchesKey(tokens[member], key, keyLength))
+      return Value(_view, value);
+    member = tokens[value].next;
+  }
+  return Value();
+}
+
+wars::JsonView::Value wars::JsonView::Value::get(const std::string& key) const
+{
+  return get(key.c_str());
+}
+
+bool wars::JsonView::Value::has(const char* key) const
+{
+  return get(key).type() != Type::NONE;
+}
+
+wars::JsonView::Value wars::JsonView::Value::at(unsigned int index) const
+{
+  if(type() != Type::ARRAY || index >= _view->_tokens[_token].count)
+    return Value();
+
+  Token& array = _view->_tokens[_token];
+  unsigned int i = 0;
+  unsigned int element = _token + 1;
+  if(array.cursorIndex <= index)
+  {
+    i = array.cursorIndex;
+    element = array.cursorToken;
+  }
+
+  for(; i < index; ++i)
+  {
+    element = _view->_tokens[element].next;
+  }
+
+  array.cursorIndex = index;
+  array.cursorToken = element;
+  return Value(_view, element);
+}
+
+unsigned int wars::JsonView::Value::size() const
+{
+  Type const t = type();
+  return t == Type::OBJECT || t == Type::ARRAY ? _view->_tokens[_token].count : 0;
+}
+
+std::string wars::JsonView::Value::stringValue() const
+{
+  if(type() != Type::STRING)
+    return std::string();
+
+  Token const& token = _view->_tokens[_token];
+  char const* text = _view->_data + token.start + 1;
+  if(!token.escaped)
+    return std::string(text, token.length - 2);
+
+  std::string result;
+  result.reserve(token.length - 2);
+  unescape(text, token.length - 2, result);
+  return result;
+}
+
+long wars::JsonView::Value::longValue() const
+{
+  if(type() != Type::NUMBER)
+    return 0;
+
+  Token const& token = _view->_tokens[_token];
+  char const* text = _view->_data + token.start;
+  char const* end = text + token.length;
+  bool const negative = *text == '-';
+  if(negative)
+    ++text;
+
+  // Integers past the range of long saturate
+  long const limit = std::numeric_limits<long>::max();
+  long result = 0;
+  for(; text < end && *text >= '0' && *text <= '9'; ++text)
+  {
+    int const digit = *text - '0';
+    if(result > (limit - digit) / 10)
+      return negative ? std::numeric_limits<long>::min() : limit;
+    result = result * 10 + digit;
+  }
+
+  // Fractions and exponents take the slow path, saturating too as casting
+  // doubles out of range is undefined
+  if(text < end)
+  {
+    double const value = doubleValue();
+    double const range = -static_cast<double>(std::numeric_limits<long>::min());
+    if(value >= range)
+      return limit;
+    if(value <= -range)
+      return std::numeric_limits<long>::min();
+    return value == value ? static_cast<long>(value) : 0;
+  }
+
+  return negative ? -result : result;
+}
+
+double wars::JsonView::Value::doubleValue() const
+{
+  if(type() != Type::NUMBER)
+    return 0;
+
+  // Numbers aren't terminated in the buffer
+  Token const& token = _view->_tokens[_token];
+  char buffer[64];
+  if(token.length >= sizeof(buffer))
+    return std::strtod(toString().c_str(), nullptr);
+
+  std::memcpy(buffer, _view->_data + token.start, token.length);
+  buffer[token.length] = '\0';
+  return std::strtod(buffer, nullptr);
+}
+
+bool wars::JsonView::Value::booleanValue() const
+{
+  return type() == Type::BOOLEAN && _view->_data[_view->_tokens[_token].start] == 't';
+}
+
+const char* wars::JsonView::Value::data() const
+{
+  return _token < 0 ? nullptr : _view->_data + _view->_tokens[_token].start;
+}
+
+std::size_t wars::JsonView::Value::length() const
+{
+  return _token < 0 ? 0 : _view->_tokens[_token].length;
+}
+
+std::string wars::JsonView::Value::toString() const
+{
+  return _token < 0 ? std::string() : std::string(data(), length());
+}
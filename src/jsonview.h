@@ -0,0 +1,89 @@
+#ifndef WARS_JSONVIEW_H
+#define WARS_JSONVIEW_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace wars
+{
+  // Read-only JSON document over a caller's buffer. Parsing records one
+  // token per value in document order without copying any text, and values
+  // are views that decode on access. The buffer must outlive the view and
+  // the view is reused between messages, so steady state parsing doesn't
+  // allocate.
+  class JsonView
+  {
+  public:
+    enum class Type { NONE, NULL_JSON, OBJECT, ARRAY, NUMBER, STRING, BOOLEAN };
+
+    class Value
+    {
+    public:
+      typedef JsonView::Type Type;
+
+      Value() : _view(nullptr), _token(-1)
+      {}
+
+      Type type() const;
+      Value get(char const* key) const;
+      Value get(std::string const& key) const;
+      bool has(char const* key) const;
+      Value at(unsigned int index) const;
+      unsigned int size() const;
+
+      std::string stringValue() const;
+      long longValue() const;
+      double doubleValue() const;
+      bool booleanValue() const;
+
+      // Source text of the value
+      char const* data() const;
+      std::size_t length() const;
+      std::string toString() const;
+
+    private:
+      friend class JsonView;
+      Value(JsonView const* view, int token) : _view(view), _token(token)
+      {}
+
+      JsonView const* _view;
+      int _token;
+    };
+
+    JsonView();
+    JsonView(JsonView const&) = delete;
+    JsonView& operator=(JsonView const&) = delete;
+
+    // False on malformed input, leaving an empty document
+    bool parse(char const* data, std::size_t length);
+    bool parse(std::string const& text);
+    Value root() const;
+
+    // Appends the decoded contents of a string between its quotes
+    static void unescape(char const* s, std::size_t length, std::string& out);
+
+  private:
+    struct Token
+    {
+      Type type;
+      bool escaped; // string contains escapes
+      unsigned int start;
+      unsigned int length;
+      unsigned int count; // array elements or object members
+      unsigned int next; // token after this value
+
+      // Element last returned by at(), so sequential access is linear
+      unsigned int cursorIndex;
+      unsigned int cursorToken;
+    };
+
+    bool tokenize(char const* data, std::size_t length);
+    bool matchesKey(Token const& token, char const* key, std::size_t keyLength) const;
+
+    char const* _data;
+    mutable std::vector<Token> _tokens; // array cursors move on access
+    std::vector<unsigned int> _open;
+  };
+}
+#endif // WARS_JSONVIEW_H
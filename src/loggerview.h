@@ -13,7 +13,7 @@ namespace wars
   public:
     void setGame(Game* game) override
     {
-      eventSub = game->events().on([game](wars::Game::Event const& e) {
+      game->events().connect(eventSlot, [game](wars::Game::Event const& e) {
         auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
         std::cout << now << ": ";
 
@@ -26,107 +26,95 @@ namespace wars
           }
           case wars::Game::EventType::MOVE:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.move.unitId);
-            wars::Game::Tile const& next = game->getTile(*e.move.tileId);
-            wars::Game::Tile const& prev = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " moves from (" << prev.x << ", " << prev.y  << ") to (" << next.x << ", " << next.y << ")" << std::endl;
+            wars::Game::Tile const& next = game->getTile(e.move.tile);
+            wars::Game::Tile const& prev = game->getTile(e.move.from);
+            std::cout << "Unit " << game->getUnitId(e.move.unit) << " moves from (" << prev.x << ", " << prev.y  << ") to (" << next.x << ", " << next.y << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::WAIT:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.wait.unitId);
-            wars::Game::Tile const& curr = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " waits at (" << curr.x << ", " << curr.y  << ")" << std::endl;
+            wars::Game::Tile const& curr = game->getTile(e.wait.tile);
+            std::cout << "Unit " << game->getUnitId(e.wait.unit) << " waits at (" << curr.x << ", " << curr.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::ATTACK:
           {
-            wars::Game::Unit const& attacker = game->getUnit(*e.attack.attackerId);
-            wars::Game::Unit const& target = game->getUnit(*e.attack.targetId);
-            std::cout << "Unit " << attacker.id << " attacks unit " << target.id << ", inflicts " << e.attack.damage  << " points damage" << std::endl;
+            std::cout << "Unit " << game->getUnitId(e.attack.attacker) << " attacks unit " << game->getUnitId(e.attack.target) << ", inflicts " << e.attack.damage  << " points damage" << std::endl;
             break;
           }
           case wars::Game::EventType::COUNTERATTACK:
           {
-            wars::Game::Unit const& attacker = game->getUnit(*e.counterattack.attackerId);
-            wars::Game::Unit const& target = game->getUnit(*e.counterattack.targetId);
-            std::cout << "Unit " << attacker.id << " counterattacks unit " << target.id << ", inflicts " << e.counterattack.damage  << " points damage" << std::endl;
+            std::cout << "Unit " << game->getUnitId(e.counterattack.attacker) << " counterattacks unit " << game->getUnitId(e.counterattack.target) << ", inflicts " << e.counterattack.damage  << " points damage" << std::endl;
             break;
           }
           case wars::Game::EventType::CAPTURE:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.capture.unitId);
-            wars::Game::Tile const& tile = game->getTile(*e.capture.tileId);
-            std::cout << "Unit " << unit.id << " captures tile at (" << tile.x << ", " << tile.y  << "), " << e.capture.left << " capture points left" << std::endl;
+            wars::Game::Tile const& tile = game->getTile(e.capture.tile);
+            std::cout << "Unit " << game->getUnitId(e.capture.unit) << " captures tile at (" << tile.x << ", " << tile.y  << "), " << e.capture.left << " capture points left" << std::endl;
             break;
           }
           case wars::Game::EventType::CAPTURED:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.captured.unitId);
-            wars::Game::Tile const& tile = game->getTile(*e.captured.tileId);
-            std::cout << "Unit " << unit.id << " captured tile at (" << tile.x << ", " << tile.y  << ")" << std::endl;
+            wars::Game::Tile const& tile = game->getTile(e.captured.tile);
+            std::cout << "Unit " << game->getUnitId(e.captured.unit) << " captured tile at (" << tile.x << ", " << tile.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::DEPLOY:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.deploy.unitId);
-            wars::Game::Tile const& curr = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " deploys at (" << curr.x << ", " << curr.y  << ")" << std::endl;
+            wars::Game::Tile const& curr = game->getTile(e.deploy.tile);
+            std::cout << "Unit " << game->getUnitId(e.deploy.unit) << " deploys at (" << curr.x << ", " << curr.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::UNDEPLOY:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.undeploy.unitId);
-            wars::Game::Tile const& curr = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " undeploys at (" << curr.x << ", " << curr.y  << ")" << std::endl;
+            wars::Game::Tile const& curr = game->getTile(e.undeploy.tile);
+            std::cout << "Unit " << game->getUnitId(e.undeploy.unit) << " undeploys at (" << curr.x << ", " << curr.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::LOAD:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.load.unitId);
-            wars::Game::Unit const& carrier = game->getUnit(*e.load.carrierId);
-            wars::Game::Tile const& curr = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " loads into unit " << carrier.id << " at (" << curr.x << ", " << curr.y  << ")" << std::endl;
+            wars::Game::Tile const& curr = game->getTile(e.load.tile);
+            std::cout << "Unit " << game->getUnitId(e.load.unit) << " loads into unit " << game->getUnitId(e.load.carrier) << " at (" << curr.x << ", " << curr.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::UNLOAD:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.unload.unitId);
-            wars::Game::Unit const& carrier = game->getUnit(*e.unload.carrierId);
-            wars::Game::Tile const& next = game->getTile(*e.unload.tileId);
-            std::cout << "Unit " << unit.id << " unloads from unit " << carrier.id << " to (" << next.x << ", " << next.y  << ")" << std::endl;
+            wars::Game::Tile const& next = game->getTile(e.unload.tile);
+            std::cout << "Unit " << game->getUnitId(e.unload.unit) << " unloads from unit " << game->getUnitId(e.unload.carrier) << " to (" << next.x << ", " << next.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::DESTROY:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.destroy.unitId);
-            wars::Game::Tile const& curr = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " destroyed at (" << curr.x << ", " << curr.y  << ")" << std::endl;
+            std::cout << "Unit " << game->getUnitId(e.destroy.unit) << " destroyed";
+            if(e.destroy.tile >= 0)
+            {
+              wars::Game::Tile const& curr = game->getTile(e.destroy.tile);
+              std::cout << " at (" << curr.x << ", " << curr.y  << ")";
+            }
+            std::cout << std::endl;
             break;
           }
           case wars::Game::EventType::REPAIR:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.repair.unitId);
-            wars::Game::Tile const& curr = game->getTile(unit.tileId);
-            std::cout << "Unit " << unit.id << " repaired at (" << curr.x << ", " << curr.y  << "), new health = " << e.repair.newHealth << " points" << std::endl;
+            wars::Game::Tile const& curr = game->getTile(e.repair.tile);
+            std::cout << "Unit " << game->getUnitId(e.repair.unit) << " repaired at (" << curr.x << ", " << curr.y  << "), new health = " << e.repair.newHealth << " points" << std::endl;
             break;
           }
           case wars::Game::EventType::BUILD:
           {
-            wars::Game::Unit const& unit = game->getUnit(*e.build.unitId);
-            wars::Game::Tile const& tile = game->getTile(*e.build.tileId);
-            std::cout << "Unit " << unit.id << " built by tile at (" << tile.x << ", " << tile.y  << ")" << std::endl;
+            wars::Game::Tile const& tile = game->getTile(e.build.tile);
+            std::cout << "Unit " << game->getUnitId(e.build.unit) << " built by tile at (" << tile.x << ", " << tile.y  << ")" << std::endl;
             break;
           }
           case wars::Game::EventType::REGENERATE_CAPTURE_POINTS:
           {
-            wars::Game::Tile const& tile = game->getTile(*e.regenerateCapturePoints.tileId);
+            wars::Game::Tile const& tile = game->getTile(e.regenerateCapturePoints.tile);
             std::cout << "Tile at (" << tile.x << ", " << tile.y  << ") regenerates capture points, new value = " << e.regenerateCapturePoints.newCapturePoints << std::endl;
             break;
           }
           case wars::Game::EventType::PRODUCE_FUNDS:
           {
-            wars::Game::Tile const& tile = game->getTile(*e.produceFunds.tileId);
+            wars::Game::Tile const& tile = game->getTile(e.produceFunds.tile);
             std::cout << "Tile at (" << tile.x << ", " << tile.y  << ") produces funds" << std::endl;
             break;
           }
@@ -169,7 +157,7 @@ namespace wars
     }
 
   private:
-    Stream<wars::Game::Event>::Subscription eventSub;
+    Stream<wars::Game::Event>::Slot eventSlot;
   };
 }
 #endif // WARS_LOGGERVIEW_H
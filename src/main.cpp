@@ -3,11 +3,20 @@
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
+#include <memory>
+#include <algorithm>
+#include <thread>
 
 #include "game.h"
+#include "gamesnapshots.h"
+#include "workerpool.h"
+#include "optionsprecompute.h"
 #include "loggerview.h"
 #include "glhckview.h"
 #include "input.h"
+#include "eventloop.h"
+#include "networkthread.h"
+#include "queuedstream.h"
 
 json::Value jsonPosition(wars::Input::Position position)
 {
@@ -26,9 +35,9 @@ json::Value jsonPath(wars::Input::Path path)
 
 int main(int argc, char** argv)
 {
-  if(argc < 2)
+  if(argc < 6)
   {
-    std::cerr << "Usage: warshck <server> <port> <gameId> <username> <password>" << std::endl;
+    std::cerr << "Usage: warshck <server> <port> <gameId> <username> <password> [--headless]" << std::endl;
     return EXIT_FAILURE;
   }
 
@@ -37,38 +46,55 @@ int main(int argc, char** argv)
   std::string const gameId = argv[3];
   std::string const user = argv[4];
   std::string const pass = argv[5];
+  bool const headless = argc > 6 && std::string(argv[6]) == "--headless";
 
   //lws_set_log_level(LLL_NOTICE | LLL_LATENCY | LLL_EXT | LLL_DEBUG | LLL_INFO | LLL_PARSER | LLL_HEADER | LLL_CLIENT | LLL_WARN | LLL_ERR | LLL_COUNT, nullptr);
-  bool running = true;
+  wars::EventLoop loop;
   Gamenode gn;
+  wars::NetworkThread network(gn, loop);
   wars::Game game;
-
-  auto connectedSub = gn.connected().on([&gn, &gameId, &user, &pass, &game]() {
+  wars::GameSnapshots snapshots;
+  // Each worker holds a snapshot reader, leave a slot for the game thread
+  unsigned int const hardwareThreads = std::thread::hardware_concurrency();
+  unsigned int const numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+  wars::WorkerPool workers(std::min<unsigned int>(numWorkers, wars::GameSnapshots::MAX_READERS - 1));
+  wars::OptionsPrecompute precompute(&game, &snapshots, &workers);
+
+  // Game state is only touched on this thread, the connection is serviced
+  // on the network thread
+  auto connectedSub = gn.connected().on(network.onGameThread([&network, &gameId, &user, &pass, &game, &precompute]() {
     std::cout << "Connected, logging in" << std::endl;
     json::Value credentials = json::Value::object({
                                                     {"username", user},
                                                     {"password", pass}
                                                   });
 
-    gn.call("newSession", credentials).then<json::Value>([&gn, &gameId](json::Value const& response) {
+    network.call("newSession", credentials).then<json::Value>([&network, &gameId](json::Value const& response) {
       std::cout << "Got response to login: " << response.toString() << std::endl;
-      return gn.call("subscribeGame", json::Value(gameId));
-    }).then<json::Value>([&gn, &gameId](json::Value const& response) {
+      return network.call("subscribeGame", json::Value(gameId));
+    }).then<std::string>([&network, &gameId](json::Value const& response) {
       std::cout << "Subscribed to game" << std::endl;
-      return gn.call("gameRules", json::Value(gameId));
-    }).then<json::Value>([&gn, &gameId, &game](json::Value const& response) {
+      return network.callRaw("gameRules", json::Value(gameId));
+    }).then<std::string>([&network, &gameId, &game](std::string const& response) {
       std::cout << "Got game rules" << std::endl;
-      game.setRulesFromJSON(response);
-      return gn.call("gameData", json::Value(gameId));
-    }).then<void>([&gn, &game](json::Value const& response) {
+      wars::JsonReader rules(response);
+      game.setRulesFromJSON(rules);
+      return network.callRaw("gameData", json::Value(gameId));
+    }).then<void>([&game, &precompute](std::string const& response) {
       std::cout << "Got game data" << std::endl;
-      game.setGameDataFromJSON(response);
+      wars::JsonReader gameData(response);
+      game.setGameDataFromJSON(gameData);
+      precompute.update();
     });
-  });
+  }));
 
-  auto disconnectedSub = gn.disconnected().on([&running]() {
+  auto disconnectedSub = gn.disconnected().on(network.onGameThread([&loop]() {
     std::cout << "Disconnected, exiting" << std::endl;
-    running = false;
+    loop.stop();
+  }));
+
+  auto lostSub = network.lost().on([&loop]() {
+    loop.stop();
   });
 
   //Skeleton::playerJoined = (gameId, playerNumber, playerName, isMe) ->
@@ -106,9 +132,24 @@ int main(int argc, char** argv)
   });
 
   //Skeleton::gameEvents = (gameId, events) ->
-  gn.onVoidMethod("gameEvents", [&gn, &game](json::Value const& params) {
-    json::Value events = params.at(1);
-    game.processEventsFromJSON(events);
+  // Event batches that arrive together are applied before publishing once
+  // Events cross threads as their JSON text, copied once out of the receive
+  // buffer, and are read in one pass on the game thread
+  QueuedStream<std::string> gameEvents(256, QueuedStream<std::string>::Backpressure::GROW);
+  auto gameEventsSub = gameEvents.on([&game](std::string const& events) {
+    wars::JsonReader reader(events);
+    game.processEventsFromJSON(reader);
+  });
+  gameEvents.onQueued([&network, &gameEvents, &precompute]() {
+    network.deliver([&gameEvents, &precompute]() {
+      if(gameEvents.dispatch() > 0)
+      {
+        precompute.update();
+      }
+    });
+  });
+  gn.onViewMethod("gameEvents", [&gameEvents](wars::JsonView::Value const& params) {
+    gameEvents.push(params.at(1).toString());
   });
 
   //Skeleton::chatMessage = (messageInfo) ->
@@ -139,92 +180,92 @@ int main(int argc, char** argv)
 
   wars::Input input;
 
-  auto buildSub = input.events.build.on([&gn](wars::Input::Build const& event) {
+  auto buildSub = input.events.build.on([&network](wars::Input::Build const& event) {
     json::Value params = {event.gameId, event.type, jsonPosition(event.position)};
     Promise<bool> result = event.result;
     std::cout << "Sending build command with parameters " << params.toString() << std::endl;
-    gn.call("build", params).then<void>([result](json::Value const& v) mutable {
+    network.call("build", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto moveWaitSub = input.events.moveWait.on([&gn](wars::Input::MoveWait const& event) {
+  auto moveWaitSub = input.events.moveWait.on([&network](wars::Input::MoveWait const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId, jsonPosition(event.destination), jsonPath(event.path)};
     std::cout << "Sending moveAndWait command with parameters " << params.toString() << std::endl;
-    gn.call("moveAndWait", params).then<void>([result](json::Value const& v) mutable {
+    network.call("moveAndWait", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto moveAttackSub = input.events.moveAttack.on([&gn](wars::Input::MoveAttack const& event) {
+  auto moveAttackSub = input.events.moveAttack.on([&network](wars::Input::MoveAttack const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId, jsonPosition(event.destination), jsonPath(event.path), event.targetId};
-    gn.call("moveAndAttack", params).then<void>([result](json::Value const& v) mutable {
+    network.call("moveAndAttack", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto moveDeploySub = input.events.moveDeploy.on([&gn](wars::Input::MoveDeploy const& event) {
+  auto moveDeploySub = input.events.moveDeploy.on([&network](wars::Input::MoveDeploy const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId, jsonPosition(event.destination), jsonPath(event.path)};
-    gn.call("moveAndDeploy", params).then<void>([result](json::Value const& v) mutable {
+    network.call("moveAndDeploy", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto moveCaptureSub = input.events.moveCapture.on([&gn](wars::Input::MoveCapture const& event) {
+  auto moveCaptureSub = input.events.moveCapture.on([&network](wars::Input::MoveCapture const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId, jsonPosition(event.destination), jsonPath(event.path)};
-    gn.call("moveAndCapture", params).then<void>([result](json::Value const& v) mutable {
+    network.call("moveAndCapture", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto undeploySub = input.events.undeploy.on([&gn](wars::Input::Undeploy const& event) {
+  auto undeploySub = input.events.undeploy.on([&network](wars::Input::Undeploy const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId};
-    gn.call("undeploy", params).then<void>([result](json::Value const& v) mutable {
+    network.call("undeploy", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto moveLoadSub = input.events.moveLoad.on([&gn](wars::Input::MoveLoad const& event) {
+  auto moveLoadSub = input.events.moveLoad.on([&network](wars::Input::MoveLoad const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId, event.carrierId, jsonPath(event.path)};
-    gn.call("moveAndLoadInto", params).then<void>([result](json::Value const& v) mutable {
+    network.call("moveAndLoadInto", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto moveUnloadSub = input.events.moveUnload.on([&gn](wars::Input::MoveUnload const& event) {
+  auto moveUnloadSub = input.events.moveUnload.on([&network](wars::Input::MoveUnload const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId, event.unitId, jsonPosition(event.destination), jsonPath(event.path), event.carriedId, jsonPosition(event.unloadDestination)};
-    gn.call("moveAndUnload", params).then<void>([result](json::Value const& v) mutable {
+    network.call("moveAndUnload", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto endTurnSub = input.events.endTurn.on([&gn](wars::Input::EndTurn const& event) {
+  auto endTurnSub = input.events.endTurn.on([&network](wars::Input::EndTurn const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId};
-    gn.call("endTurn", params).then<void>([result](json::Value const& v) mutable {
+    network.call("endTurn", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto surrenderSub = input.events.surrender.on([&gn](wars::Input::Surrender const& event) {
+  auto surrenderSub = input.events.surrender.on([&network](wars::Input::Surrender const& event) {
     Promise<bool> result = event.result;
     json::Value params = {event.gameId};
-    gn.call("surrender", params).then<void>([result](json::Value const& v) mutable {
+    network.call("surrender", params).then<void>([result](json::Value const& v) mutable {
       result.fulfill(v.get("success").booleanValue());
     });
   });
 
-  auto fundsSub = input.events.funds.on([&gn](wars::Input::Funds const& event) {
+  auto fundsSub = input.events.funds.on([&network](wars::Input::Funds const& event) {
     Promise<int> result = event.result;
     json::Value params = {event.gameId};
-    gn.call("myFunds", params).then<void>([result](json::Value const& v) mutable {
+    network.call("myFunds", params).then<void>([result](json::Value const& v) mutable {
       if(v.get("success").booleanValue())
       {
         result.fulfill(v.get("funds").longValue());
@@ -236,26 +277,33 @@ int main(int argc, char** argv)
     });
   });
 
-  wars::GlhckView::init(argc, argv);
-  wars::GlhckView view(&input);
-  view.setGame(&game);
+  network.start();
 
-  while(running)
+  std::unique_ptr<wars::GlhckView> view;
+  if(!headless)
   {
-    usleep(1000);
-    if(!gn.handle())
-    {
-      std::cerr << "Gamenode connection lost" << std::endl;
-      break;
-    }
-
-    if(!logger.handle() || !view.handle())
-    {
-      break;
-    }
+    wars::GlhckView::init(argc, argv);
+    view.reset(new wars::GlhckView(&input));
+    view->setGame(&game);
+    view->setOptionsPrecompute(&precompute);
+
+    // Swapping buffers waits for vsync, the timer only bounds the frame rate
+    loop.addTimer(std::chrono::milliseconds(16), [&loop, &logger, &view]() {
+      if(!logger.handle() || !view->handle())
+      {
+        loop.stop();
+      }
+    });
   }
 
-  wars::GlhckView::term();
+  loop.run();
+  network.stop();
+
+  if(!headless)
+  {
+    view.reset();
+    wars::GlhckView::term();
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,66 @@
+#ifndef WARS_MPSCQUEUE_H
+#define WARS_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace wars
+{
+  // Unbounded lock-free queue for any number of producer threads and a
+  // single consumer thread. Producers link nodes with one atomic exchange;
+  // the consumer follows the links from a stub node it owns.
+  template<typename T>
+  class MpscQueue
+  {
+  public:
+    MpscQueue() : _head(new Node()), _tail(_head.load())
+    {}
+
+    ~MpscQueue()
+    {
+      T value;
+      while(pop(value));
+      delete _tail;
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    MpscQueue& operator=(MpscQueue const&) = delete;
+
+    void push(T value)
+    {
+      Node* node = new Node(std::move(value));
+      Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+      previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only, false if empty
+    bool pop(T& value)
+    {
+      Node* tail = _tail;
+      Node* next = tail->next.load(std::memory_order_acquire);
+      if(next == nullptr)
+        return false;
+
+      value = std::move(next->value);
+      _tail = next;
+      delete tail;
+      return true;
+    }
+
+  private:
+    struct Node
+    {
+      Node() : next(nullptr), value()
+      {}
+      explicit Node(T&& value) : next(nullptr), value(std::move(value))
+      {}
+
+      std::atomic<Node*> next;
+      T value;
+    };
+
+    std::atomic<Node*> _head;
+    Node* _tail;
+  };
+}
+#endif // WARS_MPSCQUEUE_H
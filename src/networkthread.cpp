@@ -0,0 +1,120 @@
+#include "networkthread.h"
+
+#include <iostream>
+
+wars::NetworkThread::NetworkThread(Gamenode& gamenode, wars::EventLoop& gameLoop) :
+  _gamenode(gamenode), _gameLoop(gameLoop), _loop(), _lost(), _running(false), _thread()
+{
+
+}
+
+wars::NetworkThread::~NetworkThread()
+{
+  stop();
+}
+
+void wars::NetworkThread::start()
+{
+  if(!_thread.joinable())
+  {
+    _running = true;
+    _thread = std::thread(&NetworkThread::run, this);
+  }
+}
+
+void wars::NetworkThread::stop()
+{
+  if(_thread.joinable())
+  {
+    _running = false;
+    _loop.wakeup();
+    _thread.join();
+  }
+}
+
+void wars::NetworkThread::post(wars::EventLoop::Callback task)
+{
+  _loop.post(std::move(task));
+}
+
+void wars::NetworkThread::deliver(wars::EventLoop::Callback task)
+{
+  _gameLoop.post(std::move(task));
+}
+
+Promise<json::Value> wars::NetworkThread::call(const std::string& methodName, const json::Value& params)
+{
+  // Each side gets its own promise so neither is touched by both threads
+  Promise<json::Value> result;
+  post([this, methodName, params, result]() {
+    _gamenode.call(methodName, params).then<void>([this, result](json::Value const& response) {
+      deliver([result, response]() mutable {
+        result.fulfill(response);
+      });
+    });
+  });
+  return result;
+}
+
+Promise<std::string> wars::NetworkThread::callRaw(const std::string& methodName, const json::Value& params)
+{
+  Promise<std::string> result;
+  post([this, methodName, params, result]() {
+    _gamenode.callRaw(methodName, params).then<void>([this, result](std::string const& response) {
+      deliver([result, response]() mutable {
+        result.fulfill(response);
+      });
+    });
+  });
+  return result;
+}
+
+Stream<void> wars::NetworkThread::lost()
+{
+  return _lost;
+}
+
+wars::EventLoop::Callback wars::NetworkThread::onGameThread(wars::EventLoop::Callback callback)
+{
+  return [this, callback]() {
+    deliver(callback);
+  };
+}
+
+Gamenode::VoidMethod wars::NetworkThread::onGameThread(Gamenode::VoidMethod method)
+{
+  return [this, method](json::Value const& params) {
+    deliver([method, params]() {
+      method(params);
+    });
+  };
+}
+
+void wars::NetworkThread::run()
+{
+  // Service the connection as soon as its sockets are ready, and at least
+  // once a second for heartbeats and timeouts
+  int const watchId = _loop.watch([this](std::vector<pollfd>& fds) { _gamenode.pollFds(fds); },
+                                  [this](pollfd& pollFd) { service(&pollFd); });
+  int const timerId = _loop.addTimer(std::chrono::seconds(1), [this]() { service(nullptr); });
+
+  while(_running)
+  {
+    _loop.runOnce();
+  }
+
+  _loop.unwatch(watchId);
+  _loop.removeTimer(timerId);
+}
+
+void wars::NetworkThread::service(pollfd* pollFd)
+{
+  if(!_gamenode.service(pollFd))
+  {
+    std::cerr << "Gamenode connection lost" << std::endl;
+    _running = false;
+    deliver([this]() {
+      _lost.push();
+    });
+  }
+}
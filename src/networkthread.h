@@ -0,0 +1,58 @@
+#ifndef WARS_NETWORKTHREAD_H
+#define WARS_NETWORKTHREAD_H
+
+#include "gamenodepp.h"
+#include "eventloop.h"
+#include "stream.h"
+#include "promise.h"
+
+#include <thread>
+#include <atomic>
+#include <string>
+
+namespace wars
+{
+  // Services a gamenode connection on its own thread so that socket reads,
+  // heartbeats and writes never wait behind rendering. The gamenode is only
+  // touched on the network thread once started. Handlers that change game
+  // state are wrapped with onGameThread() and calls are made with call(),
+  // which both hand work over through the game loop's queue.
+  class NetworkThread
+  {
+  public:
+    NetworkThread(Gamenode& gamenode, EventLoop& gameLoop);
+    ~NetworkThread();
+    NetworkThread(NetworkThread const&) = delete;
+    NetworkThread& operator=(NetworkThread const&) = delete;
+
+    void start();
+    void stop();
+
+    // Thread safe
+    void post(EventLoop::Callback task);
+    void deliver(EventLoop::Callback task);
+
+    // Game thread only, the response is delivered on the game thread
+    Promise<json::Value> call(std::string const& methodName, json::Value const& params);
+    Promise<std::string> callRaw(std::string const& methodName, json::Value const& params);
+
+    // Pushed on the game thread when servicing the connection fails
+    Stream<void> lost();
+
+    // Wrap handlers registered on the gamenode to run on the game thread
+    EventLoop::Callback onGameThread(EventLoop::Callback callback);
+    Gamenode::VoidMethod onGameThread(Gamenode::VoidMethod method);
+
+  private:
+    void run();
+    void service(pollfd* pollFd);
+
+    Gamenode& _gamenode;
+    EventLoop& _gameLoop;
+    EventLoop _loop;
+    Stream<void> _lost;
+    std::atomic<bool> _running;
+    std::thread _thread;
+  };
+}
+#endif // WARS_NETWORKTHREAD_H
@@ -0,0 +1,142 @@
+#include "optionsprecompute.h"
+
+wars::OptionsPrecompute::OptionsPrecompute(wars::Game* game, wars::GameSnapshots* snapshots, wars::WorkerPool* workers) :
+  _game(game), _snapshots(snapshots), _workers(workers), _version(0), _mutex(), _idle(), _pendingJobs(0), _readers(), _options()
+{
+  // At most one job per worker runs at a time
+  for(unsigned int i = 0; i < _workers->size(); ++i)
+  {
+    _readers.emplace_back(new GameSnapshots::Reader(*_snapshots));
+  }
+}
+
+wars::OptionsPrecompute::~OptionsPrecompute()
+{
+  // Cancel and wait for jobs still referring to this
+  _version.store(0);
+  std::unique_lock<std::mutex> lock(_mutex);
+  _idle.wait(lock, [this]() { return _pendingJobs == 0; });
+}
+
+void wars::OptionsPrecompute::update()
+{
+  int myPlayerNumber = -1;
+  for(auto const& item : _game->getPlayers())
+  {
+    if(item.second.isMe)
+      myPlayerNumber = item.first;
+  }
+
+  unsigned long version = 0;
+  if(myPlayerNumber >= 0 && myPlayerNumber == _game->getInTurnNumber())
+  {
+    _snapshots->publish(*_game);
+    version = _snapshots->version();
+  }
+  else
+  {
+    // Free versions of the last turn once cancelled jobs let go of them
+    _snapshots->reclaim();
+  }
+
+  // Cancel running jobs and drop results of older versions
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(version == _version.load())
+      return;
+
+    _version.store(version);
+    _options.clear();
+  }
+
+  if(version == 0)
+    return;
+
+  Game::UnitColumns const& unitColumns = _game->getUnitColumns();
+  for(int unit : _game->getPlayerAssets(myPlayerNumber).units)
+  {
+    if(unitColumns.tile[unit] < 0 || (unitColumns.flags[unit] & Game::UnitColumns::MOVED))
+      continue;
+
+    std::string const unitId = unitColumns.ids[unit];
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_pendingJobs;
+    }
+    _workers->submit([this, version, unitId]() {
+      std::unique_ptr<GameSnapshots::Reader> reader;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        reader = std::move(_readers.back());
+        _readers.pop_back();
+      }
+      compute(*reader, version, unitId);
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _readers.push_back(std::move(reader));
+      }
+      finishJob();
+    });
+  }
+}
+
+bool wars::OptionsPrecompute::getMovementOptions(const std::string& unitId, std::vector<wars::Game::Coordinates>& result) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto iter = _options.find(unitId);
+  if(iter == _options.end())
+    return false;
+
+  result = iter->second.movementOptions;
+  return true;
+}
+
+bool wars::OptionsPrecompute::getActionOptions(const std::string& unitId, const wars::Game::Coordinates& position, wars::Game::ActionOptions& result) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto iter = _options.find(unitId);
+  if(iter == _options.end())
+    return false;
+
+  auto actionIter = iter->second.actionOptions.find(position);
+  if(actionIter == iter->second.actionOptions.end())
+    return false;
+
+  result = actionIter->second;
+  return true;
+}
+
+void wars::OptionsPrecompute::compute(GameSnapshots::Reader& reader, unsigned long version, const std::string& unitId)
+{
+  GameSnapshots::Snapshot snapshot = reader.pin();
+  if(snapshot.version() != version || _version.load() != version)
+    return;
+
+  Game const& game = snapshot.game();
+  UnitOptions options;
+  game.findMovementOptions(unitId, options.movementOptions);
+
+  for(Game::Coordinates const& pos : options.movementOptions)
+  {
+    if(_version.load() != version)
+      return;
+
+    Game::Tile const* tile = game.getTileAt(pos.x, pos.y);
+    options.actionOptions[pos] = game.findActionOptions(unitId, tile->id);
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_version.load() == version)
+  {
+    _options[unitId] = std::move(options);
+  }
+}
+
+void wars::OptionsPrecompute::finishJob()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(--_pendingJobs == 0)
+  {
+    _idle.notify_all();
+  }
+}
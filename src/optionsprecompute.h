@@ -0,0 +1,63 @@
+#ifndef WARS_OPTIONSPRECOMPUTE_H
+#define WARS_OPTIONSPRECOMPUTE_H
+
+#include "game.h"
+#include "gamesnapshots.h"
+#include "workerpool.h"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <vector>
+#include <string>
+
+namespace wars
+{
+  // Computes movement options and the actions available on each reachable
+  // tile for all unmoved units of the local player while it is their turn.
+  // Work runs on a worker pool against the latest published snapshot and
+  // is discarded as soon as a newer version is published. A snapshot reader
+  // is claimed for each worker up front, as reader slots are limited.
+  class OptionsPrecompute
+  {
+  public:
+    OptionsPrecompute(Game* game, GameSnapshots* snapshots, WorkerPool* workers);
+    ~OptionsPrecompute();
+    OptionsPrecompute(OptionsPrecompute const&) = delete;
+    OptionsPrecompute& operator=(OptionsPrecompute const&) = delete;
+
+    // Call on the game thread after the game changes. Publishes a snapshot
+    // for the jobs only while it is the local player's turn, as nothing
+    // else reads them.
+    void update();
+
+    // False if the options are not ready yet
+    bool getMovementOptions(std::string const& unitId, std::vector<Game::Coordinates>& result) const;
+    bool getActionOptions(std::string const& unitId, Game::Coordinates const& position, Game::ActionOptions& result) const;
+
+  private:
+    struct UnitOptions
+    {
+      std::vector<Game::Coordinates> movementOptions;
+      std::map<Game::Coordinates, Game::ActionOptions> actionOptions;
+    };
+
+    void compute(GameSnapshots::Reader& reader, unsigned long version, std::string const& unitId);
+    void finishJob();
+
+    Game* _game;
+    GameSnapshots* _snapshots;
+    WorkerPool* _workers;
+
+    std::atomic<unsigned long> _version; // snapshot version being computed, 0 if none
+    mutable std::mutex _mutex;
+    std::condition_variable _idle;
+    int _pendingJobs;
+    std::vector<std::unique_ptr<GameSnapshots::Reader>> _readers; // not in use by a job
+    std::unordered_map<std::string, UnitOptions> _options;
+  };
+}
+#endif // WARS_OPTIONSPRECOMPUTE_H
@@ -0,0 +1,516 @@
+#include "pathabstraction.h"
+#include "hex.h"
+
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+namespace
+{
+  // First three directions are borders owned by the cluster itself,
+  // the rest are the same borders seen from the neighboring cluster
+  int const CLUSTER_NEIGHBORS[6][2] = {{1, 0}, {0, 1}, {1, -1}, {-1, 0}, {0, -1}, {-1, 1}};
+
+  typedef std::pair<int, int> QueueItem; // cost, cell
+  typedef std::priority_queue<QueueItem, wars::ScratchVector<QueueItem>, std::greater<QueueItem>> Queue;
+}
+
+wars::PathAbstraction::PathAbstraction(int clusterSize) :
+  _clusterSize(clusterSize), _minX(0), _minY(0), _width(0), _height(0),
+  _clustersX(0), _clustersY(0), _layers(), _mutex()
+{
+
+}
+
+int wars::PathAbstraction::getClusterSize() const
+{
+  return _clusterSize;
+}
+
+bool wars::PathAbstraction::findPath(const Game& game, const Game::Coordinates& a, const Game::Coordinates& b,
+                                     int movementTypeId, int playerNumber, Game::Path& path)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  path.clear();
+
+  Game::TileColumns const& tileColumns = game.getTileColumns();
+  int const source = cellIndex(a.x, a.y);
+  int const target = cellIndex(b.x, b.y);
+
+  // Reject if either end does not exist
+  if(source < 0 || target < 0 || tileColumns.grid[source] < 0 || tileColumns.grid[target] < 0)
+    return false;
+
+  if(source == target)
+  {
+    path.push_back(a);
+    return true;
+  }
+
+  Layer& layer = getLayer(game, movementTypeId, playerNumber);
+
+  // Reject if destination cannot be entered
+  if(layer.cellCosts[target] < 0)
+    return false;
+
+  ArenaScope scope;
+  int const sourceCluster = clusterOf(source);
+  int const targetCluster = clusterOf(target);
+  ScratchVector<int> cells;
+
+  // Short queries are answered directly inside the cluster
+  if(sourceCluster == targetCluster && findClusterPath(layer, source, target, cells))
+  {
+    path.push_back(a);
+    for(int cell : cells)
+    {
+      path.push_back(cellCoordinates(cell));
+    }
+    return true;
+  }
+
+  // Connect source and target to the entrances of their clusters
+  ScratchVector<int> sourceCosts, targetCosts, parents;
+  searchCluster(layer, sourceCluster, source, false, sourceCosts, parents);
+  searchCluster(layer, targetCluster, target, true, targetCosts, parents);
+
+  ScratchVector<int> costs(layer.cellCosts.size(), -1);
+  ScratchVector<int> from(layer.cellCosts.size(), -1);
+  Queue open;
+
+  auto relax = [&](int cell, int cost, int parent) {
+    if(costs[cell] < 0 || cost < costs[cell])
+    {
+      costs[cell] = cost;
+      from[cell] = parent;
+      open.push(std::make_pair(cost + distance(cell, target) * layer.minCost, cell));
+    }
+  };
+
+  // Source is searched like an entrance, so its own border transitions count
+  relax(source, 0, -1);
+  for(int entrance : layer.clusters[sourceCluster].entrances)
+  {
+    int cost = sourceCosts[localIndex(sourceCluster, entrance)];
+    if(cost >= 0 && entrance != source)
+      relax(entrance, cost, source);
+  }
+
+  // Search the abstract graph
+  bool found = false;
+  while(!open.empty())
+  {
+    int cell = open.top().second;
+    int estimate = open.top().first;
+    open.pop();
+
+    int const cost = costs[cell];
+    if(estimate != cost + distance(cell, target) * layer.minCost)
+      continue;
+
+    if(cell == target)
+    {
+      found = true;
+      break;
+    }
+
+    int const cluster = clusterOf(cell);
+    Cluster const& c = layer.clusters[cluster];
+
+    // Edges inside the cluster
+    int const numEntrances = c.entrances.size();
+    int const index = std::lower_bound(c.entrances.begin(), c.entrances.end(), cell) - c.entrances.begin();
+    if(index < numEntrances && c.entrances[index] == cell)
+    {
+      for(int i = 0; i < numEntrances; ++i)
+      {
+        int edgeCost = c.costs[index * numEntrances + i];
+        if(i != index && edgeCost >= 0)
+          relax(c.entrances[i], cost + edgeCost, cell);
+      }
+    }
+
+    if(cluster == targetCluster)
+    {
+      int targetCost = targetCosts[localIndex(cluster, cell)];
+      if(targetCost >= 0)
+        relax(target, cost + targetCost, cell);
+    }
+
+    // Edges between clusters
+    for(int direction = 0; direction < 6; ++direction)
+    {
+      int neighbor = neighborCluster(cluster, direction);
+      if(neighbor < 0)
+        continue;
+
+      bool owned = direction < 3;
+      std::vector<Transition> const& border = owned ? layer.borders[cluster * 3 + direction]
+                                                    : layer.borders[neighbor * 3 + direction - 3];
+      for(Transition const& t : border)
+      {
+        int here = owned ? t.from : t.to;
+        int there = owned ? t.to : t.from;
+        if(here == cell)
+          relax(there, cost + layer.cellCosts[there], cell);
+      }
+    }
+  }
+
+  if(!found)
+    return false;
+
+  // Refine abstract path locally
+  ScratchVector<int> abstractPath;
+  for(int cell = target; cell != source; cell = from[cell])
+  {
+    abstractPath.push_back(cell);
+  }
+  abstractPath.push_back(source);
+  std::reverse(abstractPath.begin(), abstractPath.end());
+
+  path.push_back(a);
+  for(unsigned int i = 1; i < abstractPath.size(); ++i)
+  {
+    int prev = abstractPath[i - 1];
+    int next = abstractPath[i];
+    if(clusterOf(prev) != clusterOf(next))
+    {
+      path.push_back(cellCoordinates(next));
+    }
+    else if(findClusterPath(layer, prev, next, cells))
+    {
+      for(int cell : cells)
+      {
+        path.push_back(cellCoordinates(cell));
+      }
+    }
+    else
+    {
+      path.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void wars::PathAbstraction::reset(const Game::TileColumns& tileColumns)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _layers.clear();
+  _minX = tileColumns.minX;
+  _minY = tileColumns.minY;
+  _width = tileColumns.width;
+  _height = tileColumns.height;
+  _clustersX = (_width + _clusterSize - 1) / _clusterSize;
+  _clustersY = (_height + _clusterSize - 1) / _clusterSize;
+}
+
+void wars::PathAbstraction::markTileDirty(int x, int y)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  int const cell = cellIndex(x, y);
+  if(cell < 0)
+    return;
+
+  int const cluster = clusterOf(cell);
+  for(auto& item : _layers)
+  {
+    item.second.dirty[cluster] = true;
+  }
+}
+
+wars::PathAbstraction::Layer& wars::PathAbstraction::getLayer(const Game& game, int movementTypeId, int playerNumber)
+{
+  auto key = std::make_pair(movementTypeId, playerNumber);
+  auto iter = _layers.find(key);
+  if(iter == _layers.end())
+  {
+    int const numClusters = _clustersX * _clustersY;
+    Layer& layer = _layers[key];
+    layer.movementTypeId = movementTypeId;
+    layer.playerNumber = playerNumber;
+    layer.cellCosts.assign(_width * _height, -1);
+    layer.borders.resize(numClusters * 3);
+    layer.clusters.resize(numClusters);
+    layer.dirty.assign(numClusters, true);
+
+    // Cheapest terrain keeps the search heuristic admissible
+    layer.minCost = 1;
+    if(movementTypeId != UNIFORM_COST)
+    {
+      MovementType const& movementType = game.getRules().movementTypes.at(movementTypeId);
+      for(auto const& effect : movementType.effectMap)
+      {
+        if(effect.second >= 0)
+          layer.minCost = std::min(layer.minCost, effect.second);
+      }
+    }
+
+    updateLayer(game, layer);
+    return layer;
+  }
+
+  updateLayer(game, iter->second);
+  return iter->second;
+}
+
+void wars::PathAbstraction::updateLayer(const Game& game, Layer& layer)
+{
+  int const numClusters = layer.clusters.size();
+  if(std::find(layer.dirty.begin(), layer.dirty.end(), true) == layer.dirty.end())
+    return;
+
+  for(int cluster = 0; cluster < numClusters; ++cluster)
+  {
+    if(layer.dirty[cluster])
+      updateCellCosts(game, layer, cluster);
+  }
+
+  // Borders of dirty clusters change entrances of their neighbors too
+  std::vector<bool> affected(numClusters, false);
+  for(int cluster = 0; cluster < numClusters; ++cluster)
+  {
+    if(!layer.dirty[cluster])
+      continue;
+
+    affected[cluster] = true;
+    for(int direction = 0; direction < 6; ++direction)
+    {
+      int neighbor = neighborCluster(cluster, direction);
+      if(neighbor < 0)
+        continue;
+
+      affected[neighbor] = true;
+      if(direction < 3)
+        updateBorder(layer, cluster, direction);
+      else
+        updateBorder(layer, neighbor, direction - 3);
+    }
+  }
+
+  for(int cluster = 0; cluster < numClusters; ++cluster)
+  {
+    if(affected[cluster])
+      updateCluster(layer, cluster);
+    layer.dirty[cluster] = false;
+  }
+}
+
+void wars::PathAbstraction::updateCellCosts(const Game& game, Layer& layer, int cluster)
+{
+  Game::TileColumns const& tileColumns = game.getTileColumns();
+  Game::UnitColumns const& unitColumns = game.getUnitColumns();
+  MovementType const* movementType = layer.movementTypeId != UNIFORM_COST
+                                     ? &game.getRules().movementTypes.at(layer.movementTypeId) : nullptr;
+  int const ox = (cluster % _clustersX) * _clusterSize;
+  int const oy = (cluster / _clustersX) * _clusterSize;
+
+  for(int y = oy; y < std::min(oy + _clusterSize, _height); ++y)
+  {
+    for(int x = ox; x < std::min(ox + _clusterSize, _width); ++x)
+    {
+      int const cell = y * _width + x;
+      int const tile = tileColumns.grid[cell];
+      int cost = -1;
+      if(tile >= 0 && movementType == nullptr)
+      {
+        cost = 1;
+      }
+      else if(tile >= 0)
+      {
+        auto effectIter = movementType->effectMap.find(tileColumns.type[tile]);
+        cost = effectIter != movementType->effectMap.end() ? effectIter->second : 1;
+
+        // Enemy units block, allied units can be passed
+        int const tileUnit = tileColumns.unit[tile];
+        if(cost >= 0 && tileUnit >= 0 && !game.areAllies(layer.playerNumber, unitColumns.owner[tileUnit]))
+          cost = -1;
+      }
+      layer.cellCosts[cell] = cost;
+    }
+  }
+}
+
+void wars::PathAbstraction::updateBorder(Layer& layer, int cluster, int direction)
+{
+  std::vector<Transition>& border = layer.borders[cluster * 3 + direction];
+  border.clear();
+
+  int const neighbor = neighborCluster(cluster, direction);
+  if(neighbor < 0)
+    return;
+
+  int const ox = (cluster % _clustersX) * _clusterSize;
+  int const oy = (cluster / _clustersX) * _clusterSize;
+
+  // Find passable cell pairs across the border
+  ArenaScope scope;
+  ScratchVector<Transition> transitions;
+  for(int y = oy; y < std::min(oy + _clusterSize, _height); ++y)
+  {
+    for(int x = ox; x < std::min(ox + _clusterSize, _width); ++x)
+    {
+      int const cell = y * _width + x;
+      if(layer.cellCosts[cell] < 0)
+        continue;
+
+      for(hex::Hex const& offset : hex::NEIGHBORS)
+      {
+        int other = cellIndex(x + offset.x + _minX, y + offset.y + _minY);
+        if(other >= 0 && clusterOf(other) == neighbor && layer.cellCosts[other] >= 0)
+          transitions.push_back({cell, other});
+      }
+    }
+  }
+
+  // Keep the middle transition of each contiguous entrance
+  unsigned int first = 0;
+  for(unsigned int i = 1; i <= transitions.size(); ++i)
+  {
+    if(i == transitions.size() || distance(transitions[i - 1].from, transitions[i].from) > 1)
+    {
+      border.push_back(transitions[(first + i - 1) / 2]);
+      first = i;
+    }
+  }
+}
+
+void wars::PathAbstraction::updateCluster(Layer& layer, int cluster)
+{
+  Cluster& c = layer.clusters[cluster];
+  c.entrances.clear();
+
+  for(int direction = 0; direction < 6; ++direction)
+  {
+    int neighbor = neighborCluster(cluster, direction);
+    if(neighbor < 0)
+      continue;
+
+    bool owned = direction < 3;
+    std::vector<Transition> const& border = owned ? layer.borders[cluster * 3 + direction]
+                                                  : layer.borders[neighbor * 3 + direction - 3];
+    for(Transition const& t : border)
+    {
+      c.entrances.push_back(owned ? t.from : t.to);
+    }
+  }
+
+  std::sort(c.entrances.begin(), c.entrances.end());
+  c.entrances.erase(std::unique(c.entrances.begin(), c.entrances.end()), c.entrances.end());
+
+  int const numEntrances = c.entrances.size();
+  c.costs.assign(numEntrances * numEntrances, -1);
+
+  ArenaScope scope;
+  ScratchVector<int> costs, parents;
+  for(int i = 0; i < numEntrances; ++i)
+  {
+    searchCluster(layer, cluster, c.entrances[i], false, costs, parents);
+    for(int j = 0; j < numEntrances; ++j)
+    {
+      c.costs[i * numEntrances + j] = costs[localIndex(cluster, c.entrances[j])];
+    }
+  }
+}
+
+void wars::PathAbstraction::searchCluster(Layer const& layer, int cluster, int source, bool reverse,
+                                          ScratchVector<int>& costs, ScratchVector<int>& parents) const
+{
+  costs.assign(_clusterSize * _clusterSize, -1);
+  parents.assign(_clusterSize * _clusterSize, -1);
+
+  Queue queue;
+  costs[localIndex(cluster, source)] = 0;
+  queue.push(std::make_pair(0, source));
+
+  while(!queue.empty())
+  {
+    int cost = queue.top().first;
+    int cell = queue.top().second;
+    queue.pop();
+
+    if(cost != costs[localIndex(cluster, cell)])
+      continue;
+
+    int const x = cell % _width;
+    int const y = cell / _width;
+    for(hex::Hex const& offset : hex::NEIGHBORS)
+    {
+      int neighbor = cellIndex(x + offset.x + _minX, y + offset.y + _minY);
+
+      // Reject if outside cluster or cannot traverse
+      if(neighbor < 0 || clusterOf(neighbor) != cluster || layer.cellCosts[neighbor] < 0)
+        continue;
+
+      // Moving backwards costs entering the cell we came from
+      int next = cost + (reverse ? layer.cellCosts[cell] : layer.cellCosts[neighbor]);
+      int& neighborCost = costs[localIndex(cluster, neighbor)];
+      if(neighborCost < 0 || next < neighborCost)
+      {
+        neighborCost = next;
+        parents[localIndex(cluster, neighbor)] = cell;
+        queue.push(std::make_pair(next, neighbor));
+      }
+    }
+  }
+}
+
+bool wars::PathAbstraction::findClusterPath(Layer const& layer, int from, int to, ScratchVector<int>& cells) const
+{
+  int const cluster = clusterOf(from);
+  ScratchVector<int> costs, parents;
+  searchCluster(layer, cluster, from, false, costs, parents);
+
+  cells.clear();
+  if(clusterOf(to) != cluster || costs[localIndex(cluster, to)] < 0)
+    return false;
+
+  for(int cell = to; cell != from; cell = parents[localIndex(cluster, cell)])
+  {
+    cells.push_back(cell);
+  }
+  std::reverse(cells.begin(), cells.end());
+  return true;
+}
+
+int wars::PathAbstraction::cellIndex(int x, int y) const
+{
+  x -= _minX;
+  y -= _minY;
+  if(x < 0 || y < 0 || x >= _width || y >= _height)
+    return -1;
+  return y * _width + x;
+}
+
+int wars::PathAbstraction::clusterOf(int cell) const
+{
+  return (cell / _width / _clusterSize) * _clustersX + (cell % _width) / _clusterSize;
+}
+
+int wars::PathAbstraction::localIndex(int cluster, int cell) const
+{
+  int const x = cell % _width - (cluster % _clustersX) * _clusterSize;
+  int const y = cell / _width - (cluster / _clustersX) * _clusterSize;
+  return y * _clusterSize + x;
+}
+
+int wars::PathAbstraction::neighborCluster(int cluster, int direction) const
+{
+  int const x = cluster % _clustersX + CLUSTER_NEIGHBORS[direction][0];
+  int const y = cluster / _clustersX + CLUSTER_NEIGHBORS[direction][1];
+  if(x < 0 || y < 0 || x >= _clustersX || y >= _clustersY)
+    return -1;
+  return y * _clustersX + x;
+}
+
+int wars::PathAbstraction::distance(int cellA, int cellB) const
+{
+  return hex::distance(cellB % _width - cellA % _width, cellB / _width - cellA / _width);
+}
+
+wars::Game::Coordinates wars::PathAbstraction::cellCoordinates(int cell) const
+{
+  return {cell % _width + _minX, cell / _width + _minY};
+}
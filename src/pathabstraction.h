@@ -0,0 +1,95 @@
+#ifndef WARS_PATHABSTRACTION_H
+#define WARS_PATHABSTRACTION_H
+
+#include "game.h"
+#include "arena.h"
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace wars
+{
+  // Hierarchical path search (HPA*) for long range queries on large maps.
+  // The map is split into square clusters of axial coordinates. Entrances
+  // between neighboring clusters and entrance-to-entrance costs inside each
+  // cluster are precomputed per movement type and player on first use.
+  // Clusters marked dirty by the game are rebuilt before the next query.
+  class PathAbstraction
+  {
+  public:
+    static const int DEFAULT_CLUSTER_SIZE = 10;
+
+    // Movement type of layers where every tile costs one and units don't block
+    static const int UNIFORM_COST = -1;
+
+    explicit PathAbstraction(int clusterSize = DEFAULT_CLUSTER_SIZE);
+    PathAbstraction(PathAbstraction const&) = delete;
+    PathAbstraction& operator=(PathAbstraction const&) = delete;
+
+    int getClusterSize() const;
+
+    // Path from a to b including both, false if none was found
+    bool findPath(Game const& game, Game::Coordinates const& a, Game::Coordinates const& b,
+                  int movementTypeId, int playerNumber, Game::Path& path);
+
+    // Drops all layers for a new map
+    void reset(Game::TileColumns const& tileColumns);
+
+    // Terrain or the unit on the tile changed
+    void markTileDirty(int x, int y);
+
+  private:
+    struct Transition
+    {
+      int from;
+      int to;
+    };
+
+    struct Cluster
+    {
+      std::vector<int> entrances;
+      std::vector<int> costs; // entrance to entrance, -1 if unreachable
+    };
+
+    struct Layer
+    {
+      int movementTypeId;
+      int playerNumber;
+      int minCost;
+      std::vector<int> cellCosts;
+      std::vector<std::vector<Transition>> borders; // three per cluster
+      std::vector<Cluster> clusters;
+      std::vector<bool> dirty;
+    };
+
+    Layer& getLayer(Game const& game, int movementTypeId, int playerNumber);
+    void updateLayer(Game const& game, Layer& layer);
+    void updateCellCosts(Game const& game, Layer& layer, int cluster);
+    void updateBorder(Layer& layer, int cluster, int direction);
+    void updateCluster(Layer& layer, int cluster);
+
+    void searchCluster(Layer const& layer, int cluster, int source, bool reverse,
+                       ScratchVector<int>& costs, ScratchVector<int>& parents) const;
+    bool findClusterPath(Layer const& layer, int from, int to, ScratchVector<int>& cells) const;
+
+    int cellIndex(int x, int y) const;
+    int clusterOf(int cell) const;
+    int localIndex(int cluster, int cell) const;
+    int neighborCluster(int cluster, int direction) const;
+    int distance(int cellA, int cellB) const;
+    Game::Coordinates cellCoordinates(int cell) const;
+
+    int _clusterSize;
+    int _minX;
+    int _minY;
+    int _width;
+    int _height;
+    int _clustersX;
+    int _clustersY;
+    std::map<std::pair<int, int>, Layer> _layers;
+    std::mutex _mutex;
+  };
+}
+#endif // WARS_PATHABSTRACTION_H
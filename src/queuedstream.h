@@ -0,0 +1,284 @@
+#ifndef QUEUEDSTREAM_H
+#define QUEUEDSTREAM_H
+
+#include "stream.h"
+#include "mpscqueue.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+// Stream whose events are pushed from any thread and delivered to
+// subscribers on the consumer thread, which drains them in batches with
+// dispatch(). Events wait in a bounded lock-free ring; what happens when it
+// is full is decided by the backpressure policy:
+//  BLOCK        producers yield until the consumer makes room, so BLOCK
+//               streams must never be pushed to from the consumer thread
+//  DROP_OLDEST  the oldest queued event is discarded
+//  GROW         events spill into an unbounded overflow list
+template<typename T>
+class QueuedStream
+{
+public:
+  typedef typename Stream<T>::Callback Callback;
+  typedef typename Stream<T>::Subscription Subscription;
+  typedef std::function<void()> NotifyFunc;
+
+  enum class Backpressure { BLOCK, DROP_OLDEST, GROW };
+
+  struct Stats
+  {
+    std::size_t depth;
+    std::size_t highWater;
+    unsigned long pushed;
+    unsigned long dropped;
+    unsigned long blocked;
+    unsigned long overflowed;
+  };
+
+  QueuedStream(std::size_t capacity = 1024, Backpressure policy = Backpressure::BLOCK) :
+    _policy(policy), _mask(roundCapacity(capacity) - 1), _cells(new Cell[_mask + 1]),
+    _enqueuePos(0), _dequeuePos(0), _overflow(), _overflowCount(0), _scheduled(false), _notify(), _stream(),
+    _highWater(0), _pushed(0), _dropped(0), _blocked(0), _overflowed(0)
+  {
+    for(std::size_t i = 0; i <= _mask; ++i)
+    {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  QueuedStream(QueuedStream const&) = delete;
+  QueuedStream& operator=(QueuedStream const&) = delete;
+
+  // Consumer thread only
+  Subscription on(Callback callback)
+  {
+    return _stream.on(callback);
+  }
+
+  // Called on a producer thread when events become pending, typically to
+  // schedule a dispatch on the consumer, and by dispatch() when it stops
+  // at maxEvents with events left. Set before producers start.
+  void onQueued(NotifyFunc notify)
+  {
+    _notify = notify;
+  }
+
+  // Thread safe
+  void push(T const& t)
+  {
+    switch(_policy)
+    {
+      case Backpressure::BLOCK:
+      {
+        if(!tryEnqueue(t))
+        {
+          _blocked.fetch_add(1, std::memory_order_relaxed);
+          while(!tryEnqueue(t))
+          {
+            std::this_thread::yield();
+          }
+        }
+        break;
+      }
+      case Backpressure::DROP_OLDEST:
+      {
+        T oldest;
+        while(!tryEnqueue(t))
+        {
+          if(tryDequeue(oldest))
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+      }
+      case Backpressure::GROW:
+      {
+        // Once spilled, keep spilling until the consumer catches up so
+        // events from one producer stay in order
+        if(_overflowCount.load(std::memory_order_acquire) != 0 || !tryEnqueue(t))
+        {
+          _overflowCount.fetch_add(1, std::memory_order_acq_rel);
+          _overflow.push(t);
+          _overflowed.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+      }
+    }
+
+    _pushed.fetch_add(1, std::memory_order_relaxed);
+    updateHighWater(depth());
+
+    if(_notify && !_scheduled.exchange(true, std::memory_order_acq_rel))
+    {
+      _notify();
+    }
+  }
+
+  // Consumer thread only, delivers up to maxEvents queued events to
+  // subscribers and returns how many were delivered
+  std::size_t dispatch(std::size_t maxEvents = std::numeric_limits<std::size_t>::max())
+  {
+    _scheduled.store(false, std::memory_order_release);
+
+    std::size_t count = 0;
+    T value;
+    while(count < maxEvents && pop(value))
+    {
+      _stream.push(value);
+      ++count;
+    }
+
+    // Events left over need another dispatch
+    if(count == maxEvents && depth() > 0 && _notify && !_scheduled.exchange(true, std::memory_order_acq_rel))
+    {
+      _notify();
+    }
+    return count;
+  }
+
+  // Approximate while producers are pushing
+  std::size_t depth() const
+  {
+    std::size_t const enqueued = _enqueuePos.load(std::memory_order_relaxed);
+    std::size_t const dequeued = _dequeuePos.load(std::memory_order_relaxed);
+    std::size_t const queued = enqueued > dequeued ? enqueued - dequeued : 0;
+    return queued + _overflowCount.load(std::memory_order_relaxed);
+  }
+
+  std::size_t capacity() const
+  {
+    return _mask + 1;
+  }
+
+  Stats stats() const
+  {
+    return {
+      depth(),
+      _highWater.load(std::memory_order_relaxed),
+      _pushed.load(std::memory_order_relaxed),
+      _dropped.load(std::memory_order_relaxed),
+      _blocked.load(std::memory_order_relaxed),
+      _overflowed.load(std::memory_order_relaxed)
+    };
+  }
+
+private:
+  // Each cell's sequence tells whose turn it is: equal to the enqueue
+  // position when free, one past it when holding an event
+  struct Cell
+  {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  static std::size_t roundCapacity(std::size_t capacity)
+  {
+    std::size_t result = 2;
+    while(result < capacity)
+    {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  bool tryEnqueue(T const& t)
+  {
+    std::size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while(true)
+    {
+      cell = &_cells[pos & _mask];
+      std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+      std::intptr_t const diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+      if(diff == 0)
+      {
+        if(_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if(diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = _enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = t;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Dropping producers compete with the consumer here, hence the CAS
+  bool tryDequeue(T& t)
+  {
+    std::size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while(true)
+    {
+      cell = &_cells[pos & _mask];
+      std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+      std::intptr_t const diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+      if(diff == 0)
+      {
+        if(_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if(diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = _dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    t = std::move(cell->value);
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& t)
+  {
+    if(tryDequeue(t))
+      return true;
+
+    if(_overflow.pop(t))
+    {
+      _overflowCount.fetch_sub(1, std::memory_order_acq_rel);
+      return true;
+    }
+
+    return false;
+  }
+
+  void updateHighWater(std::size_t depth)
+  {
+    std::size_t highWater = _highWater.load(std::memory_order_relaxed);
+    while(depth > highWater && !_highWater.compare_exchange_weak(highWater, depth, std::memory_order_relaxed));
+  }
+
+  Backpressure const _policy;
+  std::size_t const _mask;
+  std::unique_ptr<Cell[]> _cells;
+  alignas(64) std::atomic<std::size_t> _enqueuePos;
+  alignas(64) std::atomic<std::size_t> _dequeuePos;
+  wars::MpscQueue<T> _overflow;
+  std::atomic<std::size_t> _overflowCount;
+  std::atomic<bool> _scheduled;
+  NotifyFunc _notify;
+  Stream<T> _stream;
+
+  std::atomic<std::size_t> _highWater;
+  std::atomic<unsigned long> _pushed;
+  std::atomic<unsigned long> _dropped;
+  std::atomic<unsigned long> _blocked;
+  std::atomic<unsigned long> _overflowed;
+};
+
+#endif // QUEUEDSTREAM_H
@@ -6,6 +6,137 @@
 #include <memory>
 #include <algorithm>
 
+#include "delegate.h"
+
+template<typename... Args>
+class StreamSlotList;
+
+// Intrusive subscription. A slot links itself into a stream's list when
+// connected and unlinks itself when disconnected or destroyed, so pushing
+// to a stream neither allocates nor touches reference counts. A slot may
+// disconnect itself from its callback but not be destroyed by it, callbacks
+// that can drop their own subscription use Stream::on.
+template<typename... Args>
+class StreamSlot
+{
+public:
+  StreamSlot() : _delegate(), _list(nullptr), _prev(nullptr), _next(nullptr)
+  {}
+
+  ~StreamSlot()
+  {
+    disconnect();
+  }
+
+  StreamSlot(StreamSlot const&) = delete;
+  StreamSlot& operator=(StreamSlot const&) = delete;
+
+  bool connected() const
+  {
+    return _list != nullptr;
+  }
+
+  void disconnect()
+  {
+    if(_list != nullptr)
+      _list->unlink(this);
+  }
+
+private:
+  friend class StreamSlotList<Args...>;
+
+  Delegate<void(Args...)> _delegate;
+  StreamSlotList<Args...>* _list;
+  StreamSlot* _prev;
+  StreamSlot* _next;
+};
+
+// Shared by all copies of a stream
+template<typename... Args>
+class StreamSlotList
+{
+public:
+  typedef StreamSlot<Args...> Slot;
+
+  StreamSlotList() : _head(nullptr), _tail(nullptr), _cursors(nullptr)
+  {}
+
+  ~StreamSlotList()
+  {
+    while(_head != nullptr)
+    {
+      unlink(_head);
+    }
+  }
+
+  StreamSlotList(StreamSlotList const&) = delete;
+  StreamSlotList& operator=(StreamSlotList const&) = delete;
+
+  template<typename F>
+  void connect(Slot& slot, F f)
+  {
+    slot.disconnect();
+    slot._delegate.set(std::move(f));
+    slot._list = this;
+    slot._prev = _tail;
+    slot._next = nullptr;
+    if(_tail != nullptr)
+      _tail->_next = &slot;
+    else
+      _head = &slot;
+    _tail = &slot;
+  }
+
+  void unlink(Slot* slot)
+  {
+    // Pushes in progress skip past the slot instead of following it
+    for(Cursor* cursor = _cursors; cursor != nullptr; cursor = cursor->outer)
+    {
+      if(cursor->next == slot)
+        cursor->next = slot->_next;
+    }
+
+    if(slot->_prev != nullptr)
+      slot->_prev->_next = slot->_next;
+    else
+      _head = slot->_next;
+
+    if(slot->_next != nullptr)
+      slot->_next->_prev = slot->_prev;
+    else
+      _tail = slot->_prev;
+
+    slot->_list = nullptr;
+    slot->_prev = nullptr;
+    slot->_next = nullptr;
+  }
+
+  // Callbacks may connect and disconnect slots and push again
+  void push(Args... args)
+  {
+    Cursor cursor = {_head, _cursors};
+    _cursors = &cursor;
+    while(cursor.next != nullptr)
+    {
+      Slot* slot = cursor.next;
+      cursor.next = slot->_next;
+      slot->_delegate(args...);
+    }
+    _cursors = cursor.outer;
+  }
+
+private:
+  struct Cursor
+  {
+    Slot* next;
+    Cursor* outer;
+  };
+
+  Slot* _head;
+  Slot* _tail;
+  Cursor* _cursors;
+};
+
 template<typename T>
 class Stream;
 template<>
@@ -16,7 +147,9 @@ class Stream
 {
 public:
   typedef std::function<void(T const&)> Callback;
+  typedef StreamSlot<T const&> Slot;
 
+  // Owns a callback for as long as any copy is held
   class Subscription
   {
   public:
@@ -30,14 +163,24 @@ public:
 
   private:
     friend class Stream<T>;
-    Subscription(Callback callback) : _callback(std::make_shared<Callback>(callback))
+
+    struct Holder
+    {
+      Holder(Callback callback) : callback(callback), slot()
+      {}
+
+      Callback callback;
+      Slot slot;
+    };
+
+    Subscription(Callback callback) : _callback(std::make_shared<Holder>(callback))
     {
     }
 
-    std::shared_ptr<Callback> _callback;
+    std::shared_ptr<Holder> _callback;
   };
 
-  Stream() : _callbacks(std::make_shared<Callbacks>())
+  Stream() : _slots(std::make_shared<Slots>())
   {
 
   }
@@ -48,40 +191,30 @@ public:
   Subscription on(Callback callback)
   {
     Subscription sub(callback);
-    _callbacks->push_back({sub._callback});
+    std::weak_ptr<typename Subscription::Holder> weak = sub._callback;
+    _slots->connect(sub._callback->slot, [weak](T const& t) {
+      // Held for the call, the callback may drop its own subscription
+      if(auto holder = weak.lock())
+        holder->callback(t);
+    });
     return sub;
   }
 
-  void push(T const& t)
+  template<typename F>
+  void connect(Slot& slot, F f)
   {
-    bool cancelledSubscriptions = false;
-    for(auto& cb : *_callbacks)
-    {
-      auto cbs = cb.lock();
-      if(cbs)
-      {
-        (*cbs)(t);
-      }
-      else
-      {
-        cancelledSubscriptions = true;
-      }
-    }
-
-    if(cancelledSubscriptions)
-    {
-      _callbacks->erase(std::remove_if(_callbacks->begin(), _callbacks->end(), [](CallbackRef const& cb) {
-        return !(cb.lock());
-      }));
-    }
+    _slots->connect(slot, std::move(f));
   }
 
+  void push(T const& t)
+  {
+    _slots->push(t);
+  }
 
 private:
-  typedef std::weak_ptr<Callback> CallbackRef;
-  typedef std::vector<CallbackRef> Callbacks;
+  typedef StreamSlotList<T const&> Slots;
 
-  std::shared_ptr<Callbacks> _callbacks;
+  std::shared_ptr<Slots> _slots;
 };
 
 
@@ -90,7 +223,9 @@ class Stream<void>
 {
 public:
   typedef std::function<void()> Callback;
+  typedef StreamSlot<> Slot;
 
+  // Owns a callback for as long as any copy is held
   class Subscription
   {
   public:
@@ -104,14 +239,24 @@ public:
 
   private:
     friend class Stream<void>;
-    Subscription(Callback callback) : _callback(std::make_shared<Callback>(callback))
+
+    struct Holder
+    {
+      Holder(Callback callback) : callback(callback), slot()
+      {}
+
+      Callback callback;
+      Slot slot;
+    };
+
+    Subscription(Callback callback) : _callback(std::make_shared<Holder>(callback))
     {
     }
 
-    std::shared_ptr<Callback> _callback;
+    std::shared_ptr<Holder> _callback;
   };
 
-  Stream() : _callbacks(std::make_shared<Callbacks>())
+  Stream() : _slots(std::make_shared<Slots>())
   {
 
   }
@@ -122,38 +267,29 @@ public:
   Subscription on(Callback callback)
   {
     Subscription sub(callback);
-    _callbacks->push_back({sub._callback});
+    std::weak_ptr<Subscription::Holder> weak = sub._callback;
+    _slots->connect(sub._callback->slot, [weak]() {
+      // Held for the call, the callback may drop its own subscription
+      if(auto holder = weak.lock())
+        holder->callback();
+    });
     return sub;
   }
 
-  void push()
+  template<typename F>
+  void connect(Slot& slot, F f)
   {
-    bool cancelledSubscriptions = false;
-    for(auto& cb : *_callbacks)
-    {
-      auto cbs = cb.lock();
-      if(cbs)
-      {
-        (*cbs)();
-      }
-      else
-      {
-        cancelledSubscriptions = true;
-      }
-    }
+    _slots->connect(slot, std::move(f));
+  }
 
-    if(cancelledSubscriptions)
-    {
-      _callbacks->erase(std::remove_if(_callbacks->begin(), _callbacks->end(), [](CallbackRef const& cb) {
-        return !(cb.lock());
-      }));
-    }
+  void push()
+  {
+    _slots->push();
   }
 
 private:
-  typedef std::weak_ptr<Callback> CallbackRef;
-  typedef std::vector<CallbackRef> Callbacks;
-  std::shared_ptr<Callbacks> _callbacks;
+  typedef StreamSlotList<> Slots;
+  std::shared_ptr<Slots> _slots;
 };
 
 #endif // STREAM_H
@@ -0,0 +1,65 @@
+#include "workerpool.h"
+
+wars::WorkerPool::WorkerPool(unsigned int numThreads) :
+  _threads(), _jobs(), _mutex(), _condition(), _stopping(false)
+{
+  if(numThreads == 0)
+  {
+    unsigned int const hardwareThreads = std::thread::hardware_concurrency();
+    numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+  }
+
+  for(unsigned int i = 0; i < numThreads; ++i)
+  {
+    _threads.emplace_back(&WorkerPool::run, this);
+  }
+}
+
+wars::WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _condition.notify_all();
+
+  for(std::thread& thread : _threads)
+  {
+    thread.join();
+  }
+}
+
+void wars::WorkerPool::submit(wars::WorkerPool::Job job)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _jobs.push_back(std::move(job));
+  }
+  _condition.notify_one();
+}
+
+unsigned int wars::WorkerPool::size() const
+{
+  return _threads.size();
+}
+
+void wars::WorkerPool::run()
+{
+  while(true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _condition.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+
+      // Finish queued jobs before stopping
+      if(_jobs.empty())
+        return;
+
+      job = std::move(_jobs.front());
+      _jobs.pop_front();
+    }
+
+    job();
+  }
+}
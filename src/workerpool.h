@@ -0,0 +1,38 @@
+#ifndef WARS_WORKERPOOL_H
+#define WARS_WORKERPOOL_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace wars
+{
+  // Fixed set of threads running submitted jobs in order of submission
+  class WorkerPool
+  {
+  public:
+    typedef std::function<void()> Job;
+
+    // Zero threads uses one less than the number of hardware threads
+    WorkerPool(unsigned int numThreads = 0);
+    ~WorkerPool();
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    void submit(Job job);
+    unsigned int size() const;
+
+  private:
+    void run();
+
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopping;
+  };
+}
+#endif // WARS_WORKERPOOL_H
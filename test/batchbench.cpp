@@ -0,0 +1,122 @@
+#include "../src/batch.h"
+#include "../src/hex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Batch distance and damage kernels against the scalar calculations they
+// replace in findAttackTargets, for target counts from one weapon range to
+// a whole army
+namespace
+{
+  int scalarDamage(int attackerHealth, int power, int defense, int health)
+  {
+    if(power < 0)
+      return -1;
+
+    int damage = attackerHealth * power * (100 - (defense * health / 100)) / 100 / 100;
+    return std::max(damage, 1);
+  }
+
+  struct Targets
+  {
+    std::vector<int> xs;
+    std::vector<int> ys;
+    std::vector<int> powers;
+    std::vector<int> defenses;
+    std::vector<int> healths;
+
+    explicit Targets(int count) : xs(), ys(), powers(), defenses(), healths()
+    {
+      std::mt19937 random(count);
+      for(int i = 0; i < count; ++i)
+      {
+        xs.push_back(random() % 200 - 100);
+        ys.push_back(random() % 200 - 100);
+        powers.push_back(random() % 8 == 0 ? -1 : random() % 120);
+        defenses.push_back(random() % 5 * 10);
+        healths.push_back(random() % 100 + 1);
+      }
+    }
+  };
+
+  template<typename Run>
+  double bestOf(int repeats, Run run)
+  {
+    double best = 0;
+    for(int i = 0; i < 5; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      for(int r = 0; r < repeats; ++r)
+      {
+        run();
+      }
+      auto end = std::chrono::steady_clock::now();
+      double ns = std::chrono::duration<double, std::nano>(end - start).count() / repeats;
+      if(i == 0 || ns < best)
+        best = ns;
+    }
+    return best;
+  }
+
+  void bench(int count)
+  {
+    Targets const t(count);
+    std::vector<int> batchOut(count);
+    std::vector<int> scalarOut(count);
+    int const repeats = std::max(1, 4000000 / count);
+    int const health = 73;
+    long long sum = 0;
+
+    double const batchDistances = bestOf(repeats, [&]() {
+      wars::batch::distances(3, -2, t.xs.data(), t.ys.data(), count, batchOut.data());
+      sum += batchOut[count - 1];
+    });
+    double const scalarDistances = bestOf(repeats, [&]() {
+      for(int i = 0; i < count; ++i)
+      {
+        scalarOut[i] = wars::hex::distance(t.xs[i] - 3, t.ys[i] + 2);
+      }
+      sum += scalarOut[count - 1];
+    });
+    bool const distancesMatch = batchOut == scalarOut;
+
+    double const batchDamages = bestOf(repeats, [&]() {
+      wars::batch::damages(health, t.powers.data(), t.defenses.data(), t.healths.data(), count, batchOut.data());
+      sum += batchOut[count - 1];
+    });
+    double const scalarDamages = bestOf(repeats, [&]() {
+      for(int i = 0; i < count; ++i)
+      {
+        scalarOut[i] = scalarDamage(health, t.powers[i], t.defenses[i], t.healths[i]);
+      }
+      sum += scalarOut[count - 1];
+    });
+    bool const damagesMatch = batchOut == scalarOut;
+
+    std::printf("%6d targets  distances %9.1f ns batch %9.1f ns scalar%s  damages %9.1f ns batch %9.1f ns scalar%s  (%lld)\n",
+                count, batchDistances, scalarDistances, distancesMatch ? "" : " MISMATCH",
+                batchDamages, scalarDamages, damagesMatch ? "" : " MISMATCH", sum);
+  }
+}
+
+int main()
+{
+#if defined(__AVX2__)
+  std::printf("AVX2 kernels\n");
+#elif defined(__SSE2__)
+  std::printf("SSE2 kernels\n");
+#else
+  std::printf("Scalar kernels\n");
+#endif
+
+  int const counts[] = {8, 30, 256, 4096};
+  for(int count : counts)
+  {
+    bench(count);
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include "testgame.h"
+#include "../src/jsonview.h"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+
+// Events per second applied while catching up on a game after reconnecting,
+// from the received text of one event array, read straight through
+// JsonReader and through a JsonView document
+namespace
+{
+  int const UNITS = 10;
+
+  std::string tileId(int x, int y)
+  {
+    std::ostringstream out;
+    out << "t" << x << "_" << y;
+    return out.str();
+  }
+
+  void writeEvent(std::ostringstream& out, bool& first, std::string const& content)
+  {
+    out << (first ? "" : ", ") << "{\"gameId\": \"test\", \"time\": 0, \"content\": {" << content << "}}";
+    first = false;
+  }
+
+  // Each round every unit moves a tile down, waits or captures, and moves
+  // back, and the turn passes to the other player and back
+  std::string generate(int events)
+  {
+    std::ostringstream out;
+    out << "[";
+    bool first = true;
+    int count = 0;
+    for(int round = 0; count < events; ++round)
+    {
+      for(int i = 0; i < UNITS && count < events; ++i, count += 3)
+      {
+        std::ostringstream unit;
+        unit << "\"unit\": {\"unitId\": \"u" << i << "\"}";
+        int const x = 2 * i;
+
+        std::ostringstream there;
+        there << "\"action\": \"move\", " << unit.str() << ", \"tile\": {\"tileId\": \"" << tileId(x, 1) << "\"},"
+              << " \"path\": [{\"x\": " << x << ", \"y\": 0}, {\"x\": " << x << ", \"y\": 1}]";
+        writeEvent(out, first, there.str());
+
+        std::ostringstream act;
+        if(round % 2 == 0)
+          act << "\"action\": \"wait\", " << unit.str() << ", \"tile\": {\"tileId\": \"" << tileId(x, 1) << "\"}";
+        else
+          act << "\"action\": \"capture\", " << unit.str() << ", \"tile\": {\"tileId\": \"" << tileId(x, 1) << "\"},"
+              << " \"left\": " << round % 20;
+        writeEvent(out, first, act.str());
+
+        std::ostringstream back;
+        back << "\"action\": \"move\", " << unit.str() << ", \"tile\": {\"tileId\": \"" << tileId(x, 0) << "\"},"
+             << " \"path\": [{\"x\": " << x << ", \"y\": 1}, {\"x\": " << x << ", \"y\": 0}]";
+        writeEvent(out, first, back.str());
+      }
+
+      writeEvent(out, first, "\"action\": \"endTurn\", \"player\": 1");
+      writeEvent(out, first, "\"action\": \"beginTurn\", \"player\": 2");
+      writeEvent(out, first, "\"action\": \"endTurn\", \"player\": 2");
+      writeEvent(out, first, "\"action\": \"beginTurn\", \"player\": 1");
+      count += 4;
+    }
+    out << "]";
+    return out.str();
+  }
+
+  template<typename Apply>
+  double bestOf(Apply apply)
+  {
+    double best = 0;
+    for(int run = 0; run < 5; ++run)
+    {
+      auto start = std::chrono::steady_clock::now();
+      apply();
+      auto end = std::chrono::steady_clock::now();
+      double const ms = std::chrono::duration<double, std::milli>(end - start).count();
+      if(run == 0 || ms < best)
+        best = ms;
+    }
+    return best;
+  }
+
+  void bench(wars::Game& game, int events)
+  {
+    std::string const data = generate(events);
+
+    wars::JsonView view;
+    view.parse(data);
+    unsigned int const count = view.root().size();
+
+    double const reader = bestOf([&game, &data]() {
+      wars::JsonReader reader(data);
+      game.processEventsFromJSON(reader);
+    });
+
+    double const document = bestOf([&game, &data, &view]() {
+      view.parse(data);
+      game.processEventsFromJSON(view.root());
+    });
+
+    std::printf("%7u events  JsonReader %7.2f M events/s  %6.1f ns per event  JsonView %7.2f M events/s  %6.1f ns per event\n",
+                count, count / reader / 1000.0, reader * 1e6 / count, count / document / 1000.0, document * 1e6 / count);
+  }
+}
+
+int main()
+{
+  std::vector<std::string> rows(4, std::string(2 * UNITS, '.'));
+  std::vector<testgame::UnitSpec> units;
+  for(int i = 0; i < UNITS; ++i)
+  {
+    std::ostringstream id;
+    id << "u" << i;
+    testgame::UnitSpec unit = {id.str(), 2 * i, 0, testgame::INFANTRY, 1, ""};
+    units.push_back(unit);
+  }
+
+  wars::Game game;
+  testgame::load(game, rows, units);
+
+  int const counts[] = {1000, 10000, 100000};
+  for(int events : counts)
+  {
+    bench(game, events);
+  }
+  return 0;
+}
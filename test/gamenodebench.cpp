@@ -0,0 +1,155 @@
+#include "../src/gamenode.h"
+#include "libwebsockets.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Allocations and time per outgoing RPC of the gamenode write queue,
+// against the linked list queue it replaced. Messages are queued in bursts
+// and the queue is emptied between bursts the way a writable callback that
+// sends everything would, so steady state shows what reused buffers save.
+namespace
+{
+  int const RPCS = 204800; // whole bursts of every size
+  char const PARAMS[] = "\"5321a1f8e4b0c2d7a9f01234\"";
+
+  // Queue before the ring buffer, one calloc'd node and one copy per
+  // message appended at the end of a linked list
+  struct ListQueue
+  {
+    struct Node
+    {
+      char* data;
+      int size;
+      Node* next;
+    };
+
+    Node* head;
+    unsigned long allocations;
+
+    ListQueue() : head(nullptr), allocations(0)
+    {}
+
+    void queue(char const* data)
+    {
+      Node* node = static_cast<Node*>(std::calloc(2, sizeof(Node)));
+      node->size = std::strlen(data);
+      node->data = static_cast<char*>(std::calloc(1, LWS_SEND_BUFFER_PRE_PADDING + node->size + LWS_SEND_BUFFER_POST_PADDING));
+      std::strcpy(node->data + LWS_SEND_BUFFER_PRE_PADDING, data);
+      node->next = nullptr;
+      allocations += 2;
+
+      Node** last = &head;
+      while(*last)
+        last = &(*last)->next;
+      *last = node;
+    }
+
+    // The header was printed into its own buffer with the encoded message
+    // appended, the encoding itself allocated too but isn't counted here
+    void call(long msgId, char const* methodName, char const* params)
+    {
+      char body[256];
+      std::snprintf(body, sizeof(body), "{\"id\":%ld,\"type\":\"call\",\"method\":\"%s\",\"params\":[%s]}",
+                    msgId, methodName, params);
+      int headerSize = std::snprintf(nullptr, 0, "3:%ld::", msgId);
+      char* message = static_cast<char*>(std::calloc(std::strlen(body) + headerSize + 1, 1));
+      ++allocations;
+      std::sprintf(message, "3:%ld::", msgId);
+      std::strcat(message, body);
+      queue(message);
+      std::free(message);
+    }
+
+    void drain()
+    {
+      while(head)
+      {
+        Node* node = head;
+        head = node->next;
+        std::free(node->data);
+        std::free(node);
+      }
+    }
+  };
+
+  struct Result
+  {
+    double ns;
+    double allocations;
+    double steadyAllocations; // after the first burst
+  };
+
+  Result benchList(int burst)
+  {
+    ListQueue queue;
+    unsigned long firstBurst = 0;
+    long msgId = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < RPCS; i += burst)
+    {
+      for(int j = 0; j < burst; ++j)
+      {
+        queue.call(msgId++, "gameEvents", PARAMS);
+      }
+      queue.drain();
+      if(i == 0)
+        firstBurst = queue.allocations;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Result result = {std::chrono::duration<double, std::nano>(end - start).count() / RPCS,
+                     static_cast<double>(queue.allocations) / RPCS,
+                     static_cast<double>(queue.allocations - firstBurst) / (RPCS - burst)};
+    return result;
+  }
+
+  Result benchRing(int burst)
+  {
+    gamenode* gn = gamenodeNew(nullptr);
+    gamenodeWriteStats stats;
+    unsigned long firstBurst = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < RPCS; i += burst)
+    {
+      for(int j = 0; j < burst; ++j)
+      {
+        gamenodeMethodCallText(gn, "gameEvents", PARAMS, sizeof(PARAMS) - 1);
+      }
+      // Without a connection this only empties the queue, keeping buffers
+      gamenodeDisconnect(gn);
+      if(i == 0)
+      {
+        gamenodeWriteStatistics(gn, &stats);
+        firstBurst = stats.allocations;
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    gamenodeWriteStatistics(gn, &stats);
+    gamenodeFree(gn);
+
+    Result result = {std::chrono::duration<double, std::nano>(end - start).count() / RPCS,
+                     static_cast<double>(stats.allocations) / RPCS,
+                     static_cast<double>(stats.allocations - firstBurst) / (RPCS - burst)};
+    return result;
+  }
+
+  void report(char const* name, int burst, Result const& r)
+  {
+    std::printf("  %-12s burst %4d  %7.1f ns per RPC  %6.3f allocations per RPC  %6.3f after the first burst\n",
+                name, burst, r.ns, r.allocations, r.steadyAllocations);
+  }
+}
+
+int main()
+{
+  int const bursts[] = {1, 8, 64, 1024};
+  for(int burst : bursts)
+  {
+    report("linked list", burst, benchList(burst));
+    report("ring", burst, benchRing(burst));
+  }
+  return 0;
+}
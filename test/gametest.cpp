@@ -0,0 +1,272 @@
+#include "testgame.h"
+#include "../src/flowfield.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool condition, char const* what)
+  {
+    if(!condition)
+    {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  }
+
+  typedef wars::Game::TransportLeg TransportLeg;
+
+  // Plains on both sides of a strait, beaches on its shores
+  std::vector<std::string> const STRAIT = {
+    "....___~~~~_....",
+    "....___~~~~_....",
+    "....___~~~~_....",
+    "....___~~~~_....",
+    "....___~~~~_...."
+  };
+
+  void transportAcrossWater()
+  {
+    wars::Game game;
+    testgame::load(game, STRAIT, {
+      {"inf", 1, 2, testgame::INFANTRY, 1, ""},
+      {"lander", 6, 2, testgame::LANDER, 1, ""}
+    });
+
+    wars::Game::TransportPlan plan = game.findTransportPlan("inf", {14, 2});
+    check(!plan.empty(), "plan found across water");
+    if(plan.empty())
+      return;
+
+    TransportLeg const* load = nullptr;
+    TransportLeg const* unload = nullptr;
+    for(TransportLeg const& leg : plan)
+    {
+      if(leg.type == TransportLeg::Type::LOAD)
+        load = &leg;
+      else if(leg.type == TransportLeg::Type::UNLOAD)
+        unload = &leg;
+    }
+
+    check(load != nullptr && load->carrierId == "lander", "plan loads into the lander");
+    check(load != nullptr && load->path.back() == wars::Game::Coordinates({6, 2}), "unit walks onto the carrier");
+    check(unload != nullptr && unload->unloadDestination == wars::Game::Coordinates({12, 2}), "plan unloads on the far shore");
+    check(plan.back().type == TransportLeg::Type::MOVE, "plan ends walking");
+    check(plan.back().path.back() == wars::Game::Coordinates({14, 2}), "plan ends at the destination");
+    check(plan.back().turn == 2, "walk, sail and unload take three turns");
+
+    // Search state lives on the scratch arena, which stops growing once it fits
+    std::size_t const capacity = wars::Arena::scratch().capacity();
+    game.findTransportPlan("inf", {14, 2});
+    check(wars::Arena::scratch().capacity() == capacity, "repeated plans reuse the scratch arena");
+  }
+
+  void transportFromCarrier()
+  {
+    wars::Game game;
+    testgame::load(game, STRAIT, {
+      {"lander", 8, 2, testgame::LANDER, 1, ""},
+      {"inf", 8, 2, testgame::INFANTRY, 1, "lander"}
+    });
+
+    wars::Game::TransportPlan plan = game.findTransportPlan("inf", {13, 2});
+    check(!plan.empty(), "plan found for a carried unit");
+    if(plan.empty())
+      return;
+
+    check(plan.front().type == TransportLeg::Type::UNLOAD, "carried unit is sailed and unloaded");
+    check(plan.back().path.back() == wars::Game::Coordinates({13, 2}), "carried unit reaches the destination");
+  }
+
+  void transportWithoutCarrier()
+  {
+    wars::Game game;
+    testgame::load(game, STRAIT, {
+      {"inf", 1, 2, testgame::INFANTRY, 1, ""},
+      {"enemyLander", 6, 2, testgame::LANDER, 2, ""}
+    });
+
+    check(game.findTransportPlan("inf", {14, 2}).empty(), "no plan without an own carrier");
+    check(!game.findTransportPlan("inf", {5, 0}).empty(), "walking plan on the same shore");
+    check(game.findTransportPlan("inf", {6, 2}).empty(), "no plan onto an enemy unit");
+  }
+
+  void groupMovesReserveTiles()
+  {
+    wars::Game game;
+    testgame::load(game, std::vector<std::string>(7, std::string(12, '.')), {
+      {"a", 2, 3, testgame::INFANTRY, 1, ""},
+      {"b", 1, 3, testgame::INFANTRY, 1, ""},
+      {"c", 2, 2, testgame::INFANTRY, 1, ""},
+      {"enemy", 6, 3, testgame::INFANTRY, 2, ""}
+    });
+
+    std::vector<wars::Game::UnitMove> moves = game.findGroupMoves({
+      {"a", {5, 3}}, {"b", {5, 3}}, {"c", {5, 3}}
+    });
+
+    check(moves.size() == 3, "every unit moves towards the goal");
+    for(unsigned int i = 0; i < moves.size(); ++i)
+    {
+      check(moves[i].path.back() == moves[i].destination, "move path ends at its destination");
+      check(game.getTileAt(moves[i].destination.x, moves[i].destination.y)->unitId.empty(),
+            "moves end on free tiles");
+      for(unsigned int j = 0; j < i; ++j)
+      {
+        check(!(moves[i].destination == moves[j].destination), "moves end on distinct tiles");
+      }
+    }
+
+    auto goal = std::find_if(moves.begin(), moves.end(), [](wars::Game::UnitMove const& move) {
+      return move.destination == wars::Game::Coordinates({5, 3});
+    });
+    check(goal != moves.end() && goal->unitId == "a", "closest unit takes the goal");
+  }
+
+  void groupMovesLoadCarrier()
+  {
+    wars::Game game;
+    testgame::load(game, STRAIT, {
+      {"a", 4, 1, testgame::INFANTRY, 1, ""},
+      {"b", 4, 3, testgame::INFANTRY, 1, ""},
+      {"c", 3, 2, testgame::INFANTRY, 1, ""},
+      {"lander", 6, 2, testgame::LANDER, 1, ""}
+    });
+
+    std::vector<wars::Game::UnitMove> moves = game.findGroupMoves({{"a", {6, 2}}, {"b", {6, 2}}, {"c", {6, 2}}});
+    int loads = std::count_if(moves.begin(), moves.end(), [](wars::Game::UnitMove const& move) {
+      return move.destination == wars::Game::Coordinates({6, 2});
+    });
+    check(moves.size() == 3, "every unit moves towards the carrier");
+    check(loads == 2, "carrier is loaded up to its capacity");
+  }
+
+  // Plains with a lake between the units and their target, passable only
+  // along the top row
+  std::vector<std::string> const LAKE = {
+    "....................",
+    ".....~~.............",
+    ".....~~.............",
+    ".....~~.............",
+    ".....~~.............",
+    ".....~~.............",
+    ".....~~.............",
+    ".....~~.............",
+  };
+
+  void groupMovesAroundWater()
+  {
+    wars::Game game;
+    testgame::load(game, LAKE, {
+      {"a", 2, 4, testgame::INFANTRY, 1, ""},
+      {"b", 2, 5, testgame::INFANTRY, 1, ""}
+    });
+
+    // Routes read from one field lead around the lake
+    wars::FlowField field(game, {17, 4}, game.getRules().unitTypes.at(testgame::INFANTRY).movementType);
+    wars::Game::Path route = field.route({2, 4});
+    check(route.size() == static_cast<unsigned int>(field.getCost({2, 4})) + 1, "route costs one per plains tile");
+    check(route.back() == wars::Game::Coordinates({17, 4}), "route reaches the target");
+    check(field.route({2, 4}, 3).size() == 4, "route is cut to the movement points");
+    check(field.getCost({5, 4}) < 0, "water cannot reach the target");
+
+    std::vector<wars::Game::UnitMove> moves = game.findGroupMoves({{"a", {17, 4}}, {"b", {17, 4}}});
+    check(moves.size() == 2, "both units head for the target");
+    for(wars::Game::UnitMove const& move : moves)
+    {
+      wars::Game::Coordinates const start = move.path.front();
+      check(field.getCost(move.destination) == field.getCost(start) - 3, "units follow the field around the lake");
+    }
+  }
+
+  // Each step of a path goes to a neighboring tile that exists
+  bool connected(wars::Game const& game, wars::Game::Path const& path)
+  {
+    for(unsigned int i = 0; i < path.size(); ++i)
+    {
+      if(game.getTileAt(path[i].x, path[i].y) == nullptr)
+        return false;
+      if(i > 0 && game.calculateDistance(path[i - 1], path[i]) != 1)
+        return false;
+    }
+    return true;
+  }
+
+  // Plains split by a gap in the map with a single crossing
+  std::vector<std::string> wallMap()
+  {
+    std::vector<std::string> rows(40, std::string(60, '.'));
+    for(int y = 0; y < 40; ++y)
+    {
+      if(y != 33)
+        rows[y][30] = ' ';
+    }
+    return rows;
+  }
+
+  void longRangeShortestPath()
+  {
+    wars::Game game;
+    testgame::load(game, std::vector<std::string>(40, std::string(60, '.')), {});
+
+    wars::Game::Path path = game.findShortestPath({2, 3}, {55, 30});
+    check(!path.empty(), "long range path found");
+    check(connected(game, path), "long range path is connected");
+    check(path.front() == wars::Game::Coordinates({2, 3}) && path.back() == wars::Game::Coordinates({55, 30}),
+          "long range path joins the ends");
+    check(static_cast<int>(path.size()) - 1 == game.calculateDistance({2, 3}, {55, 30}),
+          "long range path is shortest on open ground");
+
+    wars::Game walled;
+    testgame::load(walled, wallMap(), {});
+    path = walled.findShortestPath({5, 5}, {50, 5});
+    check(!path.empty() && connected(walled, path), "long range path crosses the gap");
+    check(std::find(path.begin(), path.end(), wars::Game::Coordinates({30, 33})) != path.end(),
+          "long range path goes through the only crossing");
+  }
+
+  void longRangeUnitPath()
+  {
+    wars::Game game;
+    std::vector<std::string> rows(12, std::string(40, '.'));
+    testgame::load(game, rows, {
+      {"scout", 2, 6, testgame::SCOUT, 1, ""},
+      {"enemy", 20, 1, testgame::INFANTRY, 2, ""}
+    });
+
+    wars::Game::Path path = game.findUnitPath("scout", {36, 6});
+    check(!path.empty() && connected(game, path), "long range unit path found");
+    check(static_cast<int>(path.size()) - 1 <= 40, "long range unit path fits the movement points");
+
+    // Blocking the straight route rebuilds the clusters the enemy moves through
+    wars::Game::Coordinates const blocked = path[path.size() / 2];
+    std::ostringstream events;
+    events << "[{\"content\": {\"action\": \"move\", \"unit\": {\"unitId\": \"enemy\"},"
+           << " \"tile\": {\"tileId\": \"t" << blocked.x << "_" << blocked.y << "\"}, \"path\": []}}]";
+    std::string const text = events.str();
+    wars::JsonReader reader(text);
+    game.processEventsFromJSON(reader);
+
+    path = game.findUnitPath("scout", {36, 6});
+    check(!path.empty() && connected(game, path), "unit path found around the enemy");
+    check(std::find(path.begin(), path.end(), blocked) == path.end(), "unit path avoids the moved enemy");
+  }
+}
+
+int main()
+{
+  transportAcrossWater();
+  transportFromCarrier();
+  transportWithoutCarrier();
+  longRangeShortestPath();
+  longRangeUnitPath();
+  groupMovesReserveTiles();
+  groupMovesLoadCarrier();
+  groupMovesAroundWater();
+  return failures == 0 ? 0 : 1;
+}
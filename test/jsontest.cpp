@@ -0,0 +1,82 @@
+#include "../src/jsonreader.h"
+#include "../src/jsonview.h"
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool condition, char const* what)
+  {
+    if(!condition)
+    {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  }
+
+  long const MAX = std::numeric_limits<long>::max();
+  long const MIN = std::numeric_limits<long>::min();
+
+  std::string const NUMBERS = "[123456789012345678901234567890, -123456789012345678901234567890,"
+                              " 9223372036854775807, -9223372036854775807, 1e30, -1e30, 1.5e3, -42]";
+
+  void readerLongs()
+  {
+    wars::JsonReader reader(NUMBERS);
+    long values[8] = {};
+    int count = 0;
+    reader.beginArray();
+    while(reader.nextElement() && count < 8)
+    {
+      values[count++] = reader.readLong();
+    }
+
+    check(count == 8, "reader reads every number");
+    check(values[0] == MAX, "reader saturates large integers");
+    check(values[1] == MIN, "reader saturates large negative integers");
+    check(values[2] == MAX && values[3] == -MAX, "reader reads integers at the limits");
+    check(values[4] == MAX && values[5] == MIN, "reader saturates large exponents");
+    check(values[6] == 1500 && values[7] == -42, "reader reads small numbers");
+  }
+
+  void readerKeys()
+  {
+    std::string const text = "{\"99999999999999999999999\": 1, \"12\": 2}";
+    wars::JsonReader reader(text);
+    int keys[2] = {};
+    int count = 0;
+    reader.beginObject();
+    while(reader.nextMember() && count < 2)
+    {
+      keys[count++] = reader.keyInt();
+      reader.skip();
+    }
+    check(count == 2 && keys[1] == 12, "reader reads integer keys past a large one");
+  }
+
+  void viewLongs()
+  {
+    wars::JsonView view;
+    check(view.parse(NUMBERS), "view parses numbers");
+
+    wars::JsonView::Value root = view.root();
+    check(root.size() == 8, "view reads every number");
+    check(root.at(0).longValue() == MAX, "view saturates large integers");
+    check(root.at(1).longValue() == MIN, "view saturates large negative integers");
+    check(root.at(2).longValue() == MAX && root.at(3).longValue() == -MAX, "view reads integers at the limits");
+    check(root.at(4).longValue() == MAX && root.at(5).longValue() == MIN, "view saturates large exponents");
+    check(root.at(6).longValue() == 1500 && root.at(7).longValue() == -42, "view reads small numbers");
+  }
+}
+
+int main()
+{
+  readerLongs();
+  readerKeys();
+  viewLongs();
+  return failures == 0 ? 0 : 1;
+}
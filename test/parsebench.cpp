@@ -0,0 +1,143 @@
+#include "testgame.h"
+#include "../src/jsonview.h"
+#include "jsonpp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Parse time and peak heap use of loading gameData through the document
+// tree, through JsonView and through the streaming JsonReader, on generated
+// maps from a skirmish to a large campaign. Rules are streamed in every run
+// and are small next to the map.
+namespace
+{
+  std::size_t liveBytes = 0;
+  std::size_t peakBytes = 0;
+  std::size_t allocations = 0;
+}
+
+// Every allocation carries its size in front so frees can be counted
+void* operator new(std::size_t size)
+{
+  std::size_t* p = static_cast<std::size_t*>(std::malloc(size + sizeof(std::max_align_t)));
+  if(p == nullptr)
+    throw std::bad_alloc();
+  *p = size;
+  liveBytes += size;
+  ++allocations;
+  if(liveBytes > peakBytes)
+    peakBytes = liveBytes;
+  return reinterpret_cast<char*>(p) + sizeof(std::max_align_t);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  if(ptr == nullptr)
+    return;
+  std::size_t* p = reinterpret_cast<std::size_t*>(reinterpret_cast<std::uintptr_t>(ptr) - sizeof(std::max_align_t));
+  liveBytes -= *p;
+  std::free(p);
+}
+
+namespace
+{
+  struct Measurement
+  {
+    double ms;
+    std::size_t peak; // above what was live before the parse
+    std::size_t allocations;
+  };
+
+  template<typename Load>
+  Measurement measure(Load load)
+  {
+    Measurement best = {0, 0, 0};
+    for(int run = 0; run < 5; ++run)
+    {
+      std::size_t const before = liveBytes;
+      peakBytes = liveBytes;
+      std::size_t const allocationsBefore = allocations;
+
+      auto start = std::chrono::steady_clock::now();
+      load();
+      auto end = std::chrono::steady_clock::now();
+
+      double const ms = std::chrono::duration<double, std::milli>(end - start).count();
+      if(run == 0 || ms < best.ms)
+        best.ms = ms;
+      best.peak = peakBytes - before;
+      best.allocations = allocations - allocationsBefore;
+    }
+    return best;
+  }
+
+  std::string generate(int size)
+  {
+    char const terrain[] = "....~_.C..";
+    std::vector<std::string> rows;
+    std::vector<testgame::UnitSpec> units;
+    for(int y = 0; y < size; ++y)
+    {
+      std::string row;
+      for(int x = 0; x < size; ++x)
+      {
+        char const c = terrain[(x * 7 + y * 13) % 10];
+        row.push_back(c);
+        if(c == '.' && (x + y * 3) % 17 == 0)
+        {
+          testgame::UnitSpec unit = {"u" + std::to_string(units.size()), x, y, testgame::INFANTRY, 1 + (x + y) % 2, ""};
+          units.push_back(unit);
+        }
+      }
+      rows.push_back(row);
+    }
+    return testgame::gameData(rows, units);
+  }
+
+  void report(char const* name, Measurement const& m, std::size_t input)
+  {
+    std::printf("  %-12s %9.2f ms  %7.1f MB/s  peak %9.1f KB  %8zu allocations\n", name, m.ms,
+                input / m.ms / 1000.0, m.peak / 1024.0, m.allocations);
+  }
+
+  void bench(int size)
+  {
+    std::string const data = generate(size);
+    std::string const rules = testgame::RULES;
+    std::printf("%dx%d map, %zu KB of gameData\n", size, size, data.size() / 1024);
+
+    report("document", measure([&data, &rules]() {
+      wars::Game game;
+      wars::JsonReader rulesReader(rules);
+      game.setRulesFromJSON(rulesReader);
+      game.setGameDataFromJSON(json::Value::parse(data));
+    }), data.size());
+
+    report("JsonView", measure([&data, &rules]() {
+      wars::Game game;
+      wars::JsonReader rulesReader(rules);
+      game.setRulesFromJSON(rulesReader);
+      wars::JsonView view;
+      view.parse(data);
+      game.setGameDataFromJSON(view.root());
+    }), data.size());
+
+    report("JsonReader", measure([&data, &rules]() {
+      wars::Game game;
+      testgame::load(game, data);
+    }), data.size());
+  }
+}
+
+int main()
+{
+  int const sizes[] = {30, 100, 300};
+  for(int size : sizes)
+  {
+    bench(size);
+  }
+  return 0;
+}
@@ -0,0 +1,170 @@
+#include "../src/queuedstream.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Cross-thread event throughput of QueuedStream with each backpressure
+// policy, against a mutex protected deque drained the same way
+namespace
+{
+  struct Event
+  {
+    int producer;
+    int sequence;
+  };
+
+  int const EVENTS_PER_PRODUCER = 500000;
+
+  // Baseline queue, consumer swaps the whole deque out under the lock
+  class LockedQueue
+  {
+  public:
+    LockedQueue() : _mutex(), _events()
+    {}
+
+    void push(Event const& e)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _events.push_back(e);
+    }
+
+    template<typename F>
+    std::size_t dispatch(F f)
+    {
+      std::deque<Event> events;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        events.swap(_events);
+      }
+      for(Event const& e : events)
+      {
+        f(e);
+      }
+      return events.size();
+    }
+
+  private:
+    std::mutex _mutex;
+    std::deque<Event> _events;
+  };
+
+  struct Result
+  {
+    double ms;
+    long long delivered;
+    bool ordered;
+  };
+
+  // Runs producers against a consumer loop calling dispatch until all
+  // producers are done and nothing is left
+  template<typename Push, typename Dispatch>
+  Result run(int producers, Push push, Dispatch dispatch, std::vector<int>& last)
+  {
+    std::atomic<int> running(producers);
+    last.assign(producers, -1);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int p = 0; p < producers; ++p)
+    {
+      threads.emplace_back([p, &push, &running]() {
+        for(int i = 0; i < EVENTS_PER_PRODUCER; ++i)
+        {
+          push(Event{p, i});
+        }
+        running.fetch_sub(1);
+      });
+    }
+
+    long long delivered = 0;
+    while(true)
+    {
+      bool const done = running.load() == 0;
+      std::size_t n = dispatch();
+      delivered += n;
+      if(n == 0)
+      {
+        if(done)
+          break;
+        std::this_thread::yield();
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for(std::thread& t : threads)
+    {
+      t.join();
+    }
+
+    Result result = {std::chrono::duration<double, std::milli>(end - start).count(), delivered, true};
+    return result;
+  }
+
+  void report(char const* name, int producers, Result const& r, std::size_t highWater, unsigned long dropped,
+              unsigned long blocked, unsigned long overflowed)
+  {
+    // Rate of pushed events, which dropping streams deliver only part of
+    std::printf("  %-12s %d producers  %7.2f M events/s  delivered %8lld  %s  high water %7zu"
+                "  dropped %7lu  blocked %7lu  overflowed %7lu\n",
+                name, producers, producers * EVENTS_PER_PRODUCER / r.ms / 1000.0, r.delivered,
+                r.ordered ? "in order" : "OUT OF ORDER", highWater, dropped, blocked, overflowed);
+  }
+
+  // Each producer's events must arrive in the order pushed, with gaps only
+  // where events were dropped
+  void deliver(Event const& e, std::vector<int>& last, bool& ordered)
+  {
+    if(e.sequence <= last[e.producer])
+      ordered = false;
+    last[e.producer] = e.sequence;
+  }
+
+  void benchQueued(char const* name, QueuedStream<Event>::Backpressure policy, int producers)
+  {
+    QueuedStream<Event> stream(1024, policy);
+    std::vector<int> last;
+    bool ordered = true;
+    QueuedStream<Event>::Subscription sub = stream.on([&last, &ordered](Event const& e) {
+      deliver(e, last, ordered);
+    });
+
+    Result r = run(producers, [&stream](Event const& e) { stream.push(e); },
+                   [&stream]() { return stream.dispatch(256); }, last);
+    r.ordered = ordered;
+
+    QueuedStream<Event>::Stats const stats = stream.stats();
+    report(name, producers, r, stats.highWater, stats.dropped, stats.blocked, stats.overflowed);
+  }
+
+  void benchLocked(int producers)
+  {
+    LockedQueue queue;
+    std::vector<int> last;
+    bool ordered = true;
+    Result r = run(producers, [&queue](Event const& e) { queue.push(e); },
+                   [&queue, &last, &ordered]() {
+                     return queue.dispatch([&last, &ordered](Event const& e) { deliver(e, last, ordered); });
+                   }, last);
+    r.ordered = ordered;
+    report("mutex deque", producers, r, 0, 0, 0, 0);
+  }
+}
+
+int main()
+{
+  std::printf("%u hardware threads, %d events per producer\n", std::thread::hardware_concurrency(), EVENTS_PER_PRODUCER);
+  int const producerCounts[] = {1, 2, 4};
+  for(int producers : producerCounts)
+  {
+    benchLocked(producers);
+    benchQueued("block", QueuedStream<Event>::Backpressure::BLOCK, producers);
+    benchQueued("drop oldest", QueuedStream<Event>::Backpressure::DROP_OLDEST, producers);
+    benchQueued("grow", QueuedStream<Event>::Backpressure::GROW, producers);
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include "../src/stream.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Push throughput of Stream with the intrusive slots and with the
+// subscription wrapper, against the weak_ptr callback list Stream used
+// before slots
+namespace
+{
+  // Stream<T> before slots, every push locks a weak_ptr per subscriber
+  template<typename T>
+  class WeakPtrStream
+  {
+  public:
+    typedef std::function<void(T const&)> Callback;
+    typedef std::shared_ptr<Callback> Subscription;
+
+    WeakPtrStream() : _callbacks()
+    {}
+
+    Subscription on(Callback callback)
+    {
+      Subscription sub = std::make_shared<Callback>(callback);
+      _callbacks.push_back(sub);
+      return sub;
+    }
+
+    void push(T const& t)
+    {
+      for(auto& cb : _callbacks)
+      {
+        if(auto cbs = cb.lock())
+          (*cbs)(t);
+      }
+    }
+
+  private:
+    std::vector<std::weak_ptr<Callback>> _callbacks;
+  };
+
+  struct Event
+  {
+    int type;
+    int unit;
+    int tile;
+  };
+
+  // Subscriber doing about as little as a view ignoring an event
+  struct Counter
+  {
+    long long sum;
+
+    Counter() : sum(0) {}
+    void handle(Event const& e) { sum += e.type + e.unit; }
+  };
+
+  int const PUSHES = 2000000;
+
+  template<typename Push>
+  void report(char const* name, int subscribers, Push push, std::vector<Counter> const& counters)
+  {
+    double best = 0;
+    for(int run = 0; run < 5; ++run)
+    {
+      auto start = std::chrono::steady_clock::now();
+      for(int i = 0; i < PUSHES; ++i)
+      {
+        push(Event{i & 7, i, i >> 3});
+      }
+      auto end = std::chrono::steady_clock::now();
+      double ms = std::chrono::duration<double, std::milli>(end - start).count();
+      if(run == 0 || ms < best)
+        best = ms;
+    }
+
+    long long sum = 0;
+    for(Counter const& counter : counters)
+    {
+      sum += counter.sum;
+    }
+
+    std::printf("  %-16s %2d subscribers  %7.2f M pushes/s  %6.2f ns per callback  (%lld)\n", name, subscribers,
+                PUSHES / best / 1000.0, best * 1e6 / PUSHES / subscribers, sum);
+  }
+
+  void bench(int subscribers)
+  {
+    {
+      std::vector<Counter> counters(subscribers);
+      WeakPtrStream<Event> stream;
+      std::vector<WeakPtrStream<Event>::Subscription> subs;
+      for(Counter& counter : counters)
+      {
+        Counter* c = &counter;
+        subs.push_back(stream.on([c](Event const& e) { c->handle(e); }));
+      }
+      report("weak_ptr", subscribers, [&stream](Event const& e) { stream.push(e); }, counters);
+    }
+
+    {
+      std::vector<Counter> counters(subscribers);
+      Stream<Event> stream;
+      std::vector<Stream<Event>::Subscription> subs;
+      for(Counter& counter : counters)
+      {
+        Counter* c = &counter;
+        subs.push_back(stream.on([c](Event const& e) { c->handle(e); }));
+      }
+      report("Stream::on", subscribers, [&stream](Event const& e) { stream.push(e); }, counters);
+    }
+
+    {
+      std::vector<Counter> counters(subscribers);
+      Stream<Event> stream;
+      std::vector<Stream<Event>::Slot> slots(subscribers);
+      for(int i = 0; i < subscribers; ++i)
+      {
+        Counter* c = &counters[i];
+        stream.connect(slots[i], [c](Event const& e) { c->handle(e); });
+      }
+      report("Stream::connect", subscribers, [&stream](Event const& e) { stream.push(e); }, counters);
+    }
+  }
+}
+
+int main()
+{
+  int const subscribers[] = {1, 3, 10};
+  for(int n : subscribers)
+  {
+    bench(n);
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include "../src/stream.h"
+
+#include <iostream>
+#include <string>
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool condition, char const* what)
+  {
+    if(!condition)
+    {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  }
+
+  // The callback and its captures must survive the call that drops them
+  void unsubscribeFromCallback()
+  {
+    Stream<int> stream;
+    Stream<int>::Subscription sub;
+    std::string captured(64, 'x');
+    int calls = 0;
+    std::size_t seen = 0;
+    sub = stream.on([&sub, captured, &calls, &seen](int) {
+      sub.unsubscribe();
+      ++calls;
+      seen = captured.size();
+    });
+
+    stream.push(1);
+    stream.push(2);
+    check(calls == 1, "unsubscribe() from the callback stops later pushes");
+    check(seen == 64, "captures are alive after unsubscribe()");
+  }
+
+  void reassignFromCallback()
+  {
+    Stream<void> stream;
+    Stream<void>::Subscription sub;
+    std::string captured(64, 'x');
+    int calls = 0;
+    std::size_t seen = 0;
+    sub = stream.on([&sub, captured, &calls, &seen]() {
+      sub = Stream<void>::Subscription();
+      ++calls;
+      seen = captured.size();
+    });
+
+    stream.push();
+    stream.push();
+    check(calls == 1, "reassigning from the callback stops later pushes");
+    check(seen == 64, "captures are alive after reassigning");
+  }
+
+  // Later subscribers still run when an earlier one drops itself
+  void unsubscribeBeforeOthers()
+  {
+    Stream<int> stream;
+    Stream<int>::Subscription first;
+    int firstCalls = 0;
+    int secondCalls = 0;
+    first = stream.on([&first, &firstCalls](int) {
+      first.unsubscribe();
+      ++firstCalls;
+    });
+    Stream<int>::Subscription second = stream.on([&secondCalls](int) {
+      ++secondCalls;
+    });
+
+    stream.push(1);
+    stream.push(2);
+    check(firstCalls == 1, "self-unsubscribed callback ran once");
+    check(secondCalls == 2, "following callback ran for every push");
+  }
+
+  // The slot a push would call next is skipped once disconnected
+  void disconnectNextDuringPush()
+  {
+    Stream<int> stream;
+    Stream<int>::Slot a, b, c;
+    int calls[3] = {0, 0, 0};
+    stream.connect(a, [&b, &calls](int) {
+      b.disconnect();
+      ++calls[0];
+    });
+    stream.connect(b, [&calls](int) { ++calls[1]; });
+    stream.connect(c, [&calls](int) { ++calls[2]; });
+
+    stream.push(1);
+    check(calls[0] == 1 && calls[2] == 1, "remaining slots run");
+    check(calls[1] == 0, "disconnected next slot is skipped");
+    check(!b.connected(), "disconnected slot reports it");
+  }
+
+  // Nested pushes run every slot, and a slot dropped in the inner push is
+  // skipped by the outer one too
+  void pushFromCallback()
+  {
+    Stream<int> stream;
+    Stream<int>::Slot a, b, c;
+    int calls[3] = {0, 0, 0};
+    stream.connect(a, [&stream, &calls](int depth) {
+      ++calls[0];
+      if(depth == 0)
+        stream.push(1);
+    });
+    stream.connect(b, [&b, &calls](int depth) {
+      ++calls[1];
+      if(depth == 1)
+        b.disconnect();
+    });
+    stream.connect(c, [&calls](int) { ++calls[2]; });
+
+    stream.push(0);
+    check(calls[0] == 2, "pushing slot runs in both pushes");
+    check(calls[1] == 1, "slot dropped by the inner push is skipped by the outer one");
+    check(calls[2] == 2, "later slot runs in both pushes");
+  }
+
+  void slotDestroyedFirst()
+  {
+    Stream<int> stream;
+    Stream<int>::Slot kept;
+    int keptCalls = 0;
+    int droppedCalls = 0;
+    {
+      Stream<int>::Slot dropped;
+      stream.connect(dropped, [&droppedCalls](int) { ++droppedCalls; });
+      stream.connect(kept, [&keptCalls](int) { ++keptCalls; });
+      stream.push(1);
+    }
+
+    stream.push(2);
+    check(droppedCalls == 1, "destroyed slot is unlinked");
+    check(keptCalls == 2, "other slots stay linked");
+  }
+
+  void streamDestroyedFirst()
+  {
+    Stream<int>::Slot slot;
+    int calls = 0;
+    {
+      Stream<int> stream;
+      Stream<int> copy = stream;
+      copy.connect(slot, [&calls](int) { ++calls; });
+      stream.push(1);
+    }
+
+    check(calls == 1, "slot connected through a copy runs");
+    check(!slot.connected(), "slot is unlinked when the last copy of its stream goes");
+    slot.disconnect();
+  }
+}
+
+int main()
+{
+  unsubscribeFromCallback();
+  reassignFromCallback();
+  unsubscribeBeforeOthers();
+  disconnectNextDuringPush();
+  pushFromCallback();
+  slotDestroyedFirst();
+  streamDestroyedFirst();
+  return failures == 0 ? 0 : 1;
+}
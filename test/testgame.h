@@ -0,0 +1,161 @@
+#ifndef WARS_TESTGAME_H
+#define WARS_TESTGAME_H
+
+#include "../src/game.h"
+#include "../src/jsonreader.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+// Rules and maps for the game tests and benchmarks
+namespace testgame
+{
+  // Infantry walk on land and capture, landers carry two infantry over sea
+  // and beaches, artillery fires at distance 2 and 3, scouts cross large maps
+  char const* const RULES = R"json({
+    "weapons": {
+      "0": {"id": 0, "name": "Rifle", "requireDeployed": false, "rangeMap": {"1": 100}, "powerMap": {"0": 55, "1": 5}},
+      "1": {"id": 1, "name": "Cannon", "requireDeployed": false, "rangeMap": {"2": 100, "3": 80}, "powerMap": {"0": 70, "1": 40}}
+    },
+    "armors": {"0": {"id": 0, "name": "Personnel"}, "1": {"id": 1, "name": "Ship"}},
+    "unitClasses": {"0": {"id": 0, "name": "Infantry"}, "1": {"id": 1, "name": "Naval"}},
+    "terrainFlags": {"0": {"id": 0, "name": "Capturable"}, "1": {"id": 1, "name": "Funds"}},
+    "terrains": {
+      "0": {"id": 0, "name": "Plains", "defense": 10, "buildTypes": [], "repairTypes": [], "flags": []},
+      "1": {"id": 1, "name": "Sea", "defense": 0, "buildTypes": [], "repairTypes": [], "flags": []},
+      "2": {"id": 2, "name": "Beach", "defense": 0, "buildTypes": [], "repairTypes": [], "flags": []},
+      "3": {"id": 3, "name": "City", "defense": 30, "buildTypes": [0], "repairTypes": [0], "flags": [0, 1]}
+    },
+    "movementTypes": {
+      "0": {"id": 0, "name": "Foot", "effectMap": {"0": 1, "1": null, "2": 1, "3": 1}},
+      "1": {"id": 1, "name": "Boat", "effectMap": {"0": null, "1": 1, "2": 1, "3": null}}
+    },
+    "unitFlags": {"0": {"id": 0, "name": "Capture"}},
+    "units": {
+      "0": {"id": 0, "name": "Infantry", "unitClass": 0, "price": 100, "primaryWeapon": 0, "secondaryWeapon": null,
+            "armor": 0, "defenseMap": {}, "movementType": 0, "movement": 3, "carryClasses": [], "carryNum": 0, "flags": [0]},
+      "1": {"id": 1, "name": "Lander", "unitClass": 1, "price": 500, "primaryWeapon": null, "secondaryWeapon": null,
+            "armor": 1, "defenseMap": {}, "movementType": 1, "movement": 5, "carryClasses": [0], "carryNum": 2, "flags": []},
+      "2": {"id": 2, "name": "Artillery", "unitClass": 0, "price": 600, "primaryWeapon": 1, "secondaryWeapon": null,
+            "armor": 0, "defenseMap": {}, "movementType": 0, "movement": 4, "carryClasses": [], "carryNum": 0, "flags": []},
+      "3": {"id": 3, "name": "Scout", "unitClass": 0, "price": 300, "primaryWeapon": null, "secondaryWeapon": null,
+            "armor": 0, "defenseMap": {}, "movementType": 0, "movement": 40, "carryClasses": [], "carryNum": 0, "flags": []}
+    }
+  })json";
+
+  enum UnitTypeId { INFANTRY = 0, LANDER = 1, ARTILLERY = 2, SCOUT = 3 };
+
+  struct UnitSpec
+  {
+    std::string id;
+    int x;
+    int y;
+    int type;
+    int owner;
+    std::string carriedBy; // carried units take the carrier's position
+  };
+
+  inline int terrainOf(char c)
+  {
+    switch(c)
+    {
+      case '~': return 1;
+      case '_': return 2;
+      case 'C':
+      case '1':
+      case '2': return 3;
+      default: return 0;
+    }
+  }
+
+  inline void writeUnit(std::ostringstream& out, UnitSpec const& unit, std::string const& tileId,
+                        std::vector<UnitSpec> const& units)
+  {
+    out << "{\"unitId\": \"" << unit.id << "\", \"owner\": " << unit.owner << ", \"type\": " << unit.type
+        << ", \"tileId\": " << (unit.carriedBy.empty() ? "\"" + tileId + "\"" : "null")
+        << ", \"carriedBy\": " << (unit.carriedBy.empty() ? "null" : "\"" + unit.carriedBy + "\"")
+        << ", \"health\": 100, \"deployed\": false, \"moved\": false, \"capturing\": false, \"carriedUnits\": [";
+    bool first = true;
+    for(UnitSpec const& carried : units)
+    {
+      if(carried.carriedBy != unit.id)
+        continue;
+      out << (first ? "" : ", ");
+      writeUnit(out, carried, tileId, units);
+      first = false;
+    }
+    out << "]}";
+  }
+
+  // Game data for a map of terrain rows, '.' plains, '~' sea, '_' beach and
+  // 'C' cities, '1' and '2' for cities owned by those players, ' ' for no
+  // tile. Character x of row y is the tile at (x, y).
+  inline std::string gameData(std::vector<std::string> const& rows, std::vector<UnitSpec> const& units)
+  {
+    std::ostringstream out;
+    out << "{\"game\": {\"gameId\": \"test\", \"authorId\": \"a\", \"name\": \"test\", \"mapId\": \"m\","
+        << " \"state\": \"inProgress\", \"turnStart\": 0, \"turnNumber\": 1, \"roundNumber\": 1, \"inTurnNumber\": 1,"
+        << " \"settings\": {\"public\": true, \"turnLength\": null, \"bannedUnits\": []}, \"tiles\": [";
+
+    bool first = true;
+    for(unsigned int y = 0; y < rows.size(); ++y)
+    {
+      for(unsigned int x = 0; x < rows[y].size(); ++x)
+      {
+        char const c = rows[y][x];
+        if(c == ' ')
+          continue;
+
+        std::ostringstream tileId;
+        tileId << "t" << x << "_" << y;
+
+        UnitSpec const* unit = nullptr;
+        for(UnitSpec const& u : units)
+        {
+          if(u.carriedBy.empty() && u.x == static_cast<int>(x) && u.y == static_cast<int>(y))
+            unit = &u;
+        }
+
+        out << (first ? "" : ", ")
+            << "{\"tileId\": \"" << tileId.str() << "\", \"x\": " << x << ", \"y\": " << y
+            << ", \"type\": " << terrainOf(c) << ", \"subtype\": 0, \"owner\": " << (c == '1' ? 1 : c == '2' ? 2 : 0)
+            << ", \"capturePoints\": 1, \"beingCaptured\": false, \"unitId\": ";
+        if(unit != nullptr)
+        {
+          out << "\"" << unit->id << "\", \"unit\": ";
+          writeUnit(out, *unit, tileId.str(), units);
+        }
+        else
+        {
+          out << "null";
+        }
+        out << "}";
+        first = false;
+      }
+    }
+
+    out << "], \"players\": ["
+        << "{\"playerNumber\": 1, \"_id\": \"p1\", \"userId\": \"u1\", \"playerName\": \"one\", \"teamNumber\": 1,"
+        << " \"funds\": 1000, \"score\": 0, \"isMe\": true, \"settings\": {\"emailNotifications\": false, \"hidden\": false}}, "
+        << "{\"playerNumber\": 2, \"_id\": \"p2\", \"userId\": \"u2\", \"playerName\": \"two\", \"teamNumber\": 2,"
+        << " \"funds\": 1000, \"score\": 0, \"isMe\": false, \"settings\": {\"emailNotifications\": false, \"hidden\": false}}"
+        << "]}}";
+    return out.str();
+  }
+
+  inline void load(wars::Game& game, std::string const& data)
+  {
+    std::string const rules = RULES;
+    wars::JsonReader rulesReader(rules);
+    game.setRulesFromJSON(rulesReader);
+    wars::JsonReader reader(data);
+    game.setGameDataFromJSON(reader);
+  }
+
+  inline void load(wars::Game& game, std::vector<std::string> const& rows, std::vector<UnitSpec> const& units)
+  {
+    load(game, gameData(rows, units));
+  }
+}
+#endif // WARS_TESTGAME_H
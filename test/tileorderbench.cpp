@@ -0,0 +1,460 @@
+#include "../src/hex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+// Cache behaviour of tile handle orders on large generated maps. Game keeps
+// a row-major grid of tile handles next to columns indexed by handle, so the
+// order of handles decides how close tiles near each other on the map are
+// in the columns. Each workload follows the access pattern of a game query
+// and runs once through a simulated cache for miss counts, then natively for
+// time and, where the kernel allows it, hardware cache misses.
+namespace
+{
+  enum class Order { ROW_MAJOR, HILBERT, MORTON, RANDOM };
+
+  char const* orderName(Order order)
+  {
+    switch(order)
+    {
+      case Order::ROW_MAJOR: return "row-major";
+      case Order::HILBERT: return "hilbert";
+      case Order::MORTON: return "morton";
+      case Order::RANDOM: return "random";
+    }
+    return "";
+  }
+
+  unsigned int hilbertIndex(unsigned int order, unsigned int x, unsigned int y)
+  {
+    unsigned int index = 0;
+    for(unsigned int s = order / 2; s > 0; s /= 2)
+    {
+      unsigned int const rx = (x & s) > 0;
+      unsigned int const ry = (y & s) > 0;
+      index += s * s * ((3 * rx) ^ ry);
+      if(ry == 0)
+      {
+        if(rx == 1)
+        {
+          x = s - 1 - x;
+          y = s - 1 - y;
+        }
+        std::swap(x, y);
+      }
+    }
+    return index;
+  }
+
+  unsigned int mortonIndex(unsigned int x, unsigned int y)
+  {
+    unsigned int index = 0;
+    for(unsigned int bit = 0; bit < 16; ++bit)
+    {
+      index |= ((x >> bit) & 1) << (2 * bit);
+      index |= ((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return index;
+  }
+
+  // Set associative cache with LRU replacement
+  class SimulatedCache
+  {
+  public:
+    SimulatedCache(unsigned int size, unsigned int ways) :
+      _ways(ways), _sets(size / 64 / ways), _lines(_sets * ways, ~std::uint64_t(0)), _misses(0)
+    {}
+
+    // True on a hit
+    bool access(std::uint64_t address)
+    {
+      std::uint64_t const line = address / 64;
+      std::uint64_t* set = &_lines[(line % _sets) * _ways];
+      for(unsigned int i = 0; i < _ways; ++i)
+      {
+        if(set[i] == line)
+        {
+          std::rotate(set, set + i, set + i + 1);
+          return true;
+        }
+      }
+      std::copy_backward(set, set + _ways - 1, set + _ways);
+      set[0] = line;
+      ++_misses;
+      return false;
+    }
+
+    std::uint64_t misses() const { return _misses; }
+
+  private:
+    unsigned int _ways;
+    unsigned int _sets;
+    std::vector<std::uint64_t> _lines;
+    std::uint64_t _misses;
+  };
+
+  // L1 and L2 sized like a typical desktop core
+  struct CacheModel
+  {
+    SimulatedCache l1;
+    SimulatedCache l2;
+    std::uint64_t accesses;
+
+    CacheModel() : l1(32 * 1024, 8), l2(512 * 1024, 8), accesses(0) {}
+
+    template<typename T>
+    void touch(std::vector<T> const& array, int index)
+    {
+      ++accesses;
+      std::uint64_t const address = reinterpret_cast<std::uintptr_t>(array.data()) + index * sizeof(T);
+      if(!l1.access(address))
+        l2.access(address);
+    }
+  };
+
+  // Records nothing, for native runs
+  struct NoModel
+  {
+    template<typename T>
+    void touch(std::vector<T> const&, int) {}
+  };
+
+  // Render data of a tile, indexed by handle like the columns
+  struct RenderTile
+  {
+    std::uintptr_t hex;
+    std::uintptr_t prop;
+  };
+
+  // The tile columns of a game as laid out by Game::rebuildColumns
+  struct Map
+  {
+    int width;
+    int height;
+    std::vector<int> grid;
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> type;
+    std::vector<int> unit;
+    std::vector<RenderTile> render;
+
+    Map(int w, int h, Order order, std::mt19937& random) :
+      width(w), height(h), grid(w * h, -1), x(), y(), type(), unit(), render()
+    {
+      unsigned int curve = 1;
+      while(curve < static_cast<unsigned int>(std::max(w, h)))
+      {
+        curve *= 2;
+      }
+
+      std::vector<std::pair<std::uint64_t, int>> cells;
+      for(int cy = 0; cy < h; ++cy)
+      {
+        for(int cx = 0; cx < w; ++cx)
+        {
+          std::uint64_t key = cy * w + cx;
+          if(order == Order::HILBERT)
+            key = hilbertIndex(curve, cx, cy);
+          else if(order == Order::MORTON)
+            key = mortonIndex(cx, cy);
+          else if(order == Order::RANDOM)
+            key = random();
+          cells.push_back({key, cy * w + cx});
+        }
+      }
+      std::sort(cells.begin(), cells.end());
+
+      // Terrain and units are placed by cell so every order sees the same map
+      std::mt19937 content(1234);
+      std::vector<int> cellType(w * h);
+      std::vector<int> cellUnit(w * h);
+      for(int cell = 0; cell < w * h; ++cell)
+      {
+        cellType[cell] = content() % 10 == 0 ? 1 : 0;
+        cellUnit[cell] = content() % 8 == 0 ? static_cast<int>(content() % 2) : -1;
+      }
+
+      for(unsigned int handle = 0; handle < cells.size(); ++handle)
+      {
+        int const cell = cells[handle].second;
+        grid[cell] = handle;
+        x.push_back(cell % w);
+        y.push_back(cell / w);
+        type.push_back(cellType[cell]);
+        unit.push_back(cellUnit[cell]);
+      }
+      render.resize(cells.size());
+    }
+
+    int gridCell(int cx, int cy) const
+    {
+      if(cx < 0 || cy < 0 || cx >= width || cy >= height)
+        return -1;
+      return cy * width + cx;
+    }
+  };
+
+  // Dijkstra over handles as in findGroupMoves and findTransportPlan
+  template<typename Model>
+  int movementSearches(Map const& map, std::vector<int> const& starts, Model& model)
+  {
+    int const movement = 8;
+    std::vector<int> costs(map.x.size(), -1);
+    std::vector<int> visited;
+    typedef std::pair<int, int> QueueItem;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    int reached = 0;
+    for(int start : starts)
+    {
+      for(int tile : visited)
+      {
+        costs[tile] = -1;
+      }
+      visited.clear();
+      costs[start] = 0;
+      visited.push_back(start);
+      queue.push({0, start});
+
+      while(!queue.empty())
+      {
+        int const cost = queue.top().first;
+        int const tile = queue.top().second;
+        queue.pop();
+        model.touch(costs, tile);
+        if(cost != costs[tile])
+          continue;
+        ++reached;
+
+        model.touch(map.x, tile);
+        model.touch(map.y, tile);
+        for(wars::hex::Hex const& offset : wars::hex::NEIGHBORS)
+        {
+          int const cell = map.gridCell(map.x[tile] + offset.x, map.y[tile] + offset.y);
+          if(cell < 0)
+            continue;
+
+          model.touch(map.grid, cell);
+          int const neighbor = map.grid[cell];
+          model.touch(map.type, neighbor);
+          model.touch(map.unit, neighbor);
+          int const next = cost + (map.type[neighbor] == 1 ? 3 : 1);
+          if(next > movement || map.unit[neighbor] == 1)
+            continue;
+
+          model.touch(costs, neighbor);
+          if(costs[neighbor] < 0 || next < costs[neighbor])
+          {
+            if(costs[neighbor] < 0)
+              visited.push_back(neighbor);
+            costs[neighbor] = next;
+            queue.push({next, neighbor});
+          }
+        }
+      }
+    }
+    return reached;
+  }
+
+  // Hexes within weapon range as in findAttackTargets
+  template<typename Model>
+  int rangeRings(Map const& map, std::vector<int> const& centers, Model& model)
+  {
+    int targets = 0;
+    for(int center : centers)
+    {
+      wars::hex::Hex const c = {map.x[center], map.y[center]};
+      for(wars::hex::Hex const& h : wars::hex::Spiral(c, 2, 6))
+      {
+        int const cell = map.gridCell(h.x, h.y);
+        if(cell < 0)
+          continue;
+
+        model.touch(map.grid, cell);
+        int const tile = map.grid[cell];
+        model.touch(map.unit, tile);
+        if(map.unit[tile] == 1)
+        {
+          model.touch(map.type, tile);
+          targets += map.type[tile] + 1;
+        }
+      }
+    }
+    return targets;
+  }
+
+  // Tiles of screen sized chunks, as drawn by GameScene
+  template<typename Model>
+  int chunkedRendering(Map const& map, Model& model)
+  {
+    int const chunkWidth = 48;
+    int const chunkHeight = 32;
+    int drawn = 0;
+    for(int oy = 0; oy < map.height; oy += chunkHeight / 2)
+    {
+      for(int ox = 0; ox < map.width; ox += chunkWidth / 2)
+      {
+        for(int cy = oy; cy < std::min(oy + chunkHeight, map.height); ++cy)
+        {
+          for(int cx = ox; cx < std::min(ox + chunkWidth, map.width); ++cx)
+          {
+            int const cell = cy * map.width + cx;
+            model.touch(map.grid, cell);
+            int const tile = map.grid[cell];
+            model.touch(map.render, tile);
+            drawn += map.render[tile].prop + 1;
+          }
+        }
+      }
+    }
+    return drawn;
+  }
+
+  struct MovementSearches
+  {
+    Map const& map;
+    std::vector<int> const& starts;
+    template<typename Model> int operator()(Model& model) const { return movementSearches(map, starts, model); }
+  };
+
+  struct RangeRings
+  {
+    Map const& map;
+    std::vector<int> const& centers;
+    template<typename Model> int operator()(Model& model) const { return rangeRings(map, centers, model); }
+  };
+
+  struct ChunkedRendering
+  {
+    Map const& map;
+    template<typename Model> int operator()(Model& model) const { return chunkedRendering(map, model); }
+  };
+
+#ifdef __linux__
+  // Hardware cache miss counter of this thread, -1 where unavailable
+  class MissCounter
+  {
+  public:
+    MissCounter() : _fd(-1)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      _fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~MissCounter() { if(_fd >= 0) close(_fd); }
+
+    void start()
+    {
+      if(_fd < 0)
+        return;
+      ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    long long stop()
+    {
+      long long count = -1;
+      if(_fd < 0)
+        return count;
+      ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if(read(_fd, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+      return count;
+    }
+
+  private:
+    int _fd;
+  };
+#else
+  class MissCounter
+  {
+  public:
+    void start() {}
+    long long stop() { return -1; }
+  };
+#endif
+
+  template<typename Workload>
+  void run(char const* name, Workload workload)
+  {
+    CacheModel model;
+
+    // Results are summed so the native runs are not optimized away
+    std::uint64_t sum = workload(model);
+
+    NoModel none;
+    MissCounter counter;
+    double best = 0;
+    long long hardware = -1;
+    for(int i = 0; i < 5; ++i)
+    {
+      counter.start();
+      auto start = std::chrono::steady_clock::now();
+      sum += workload(none);
+      auto end = std::chrono::steady_clock::now();
+      long long misses = counter.stop();
+
+      double ms = std::chrono::duration<double, std::milli>(end - start).count();
+      if(i == 0 || ms < best)
+      {
+        best = ms;
+        hardware = misses;
+      }
+    }
+
+    std::printf("  %-18s L1 miss %5.2f%%  L2 miss %5.2f%%  %8.2f ms", name,
+                100.0 * model.l1.misses() / model.accesses, 100.0 * model.l2.misses() / model.accesses, best);
+    if(hardware >= 0)
+      std::printf("  hw misses %lld", hardware);
+    std::printf("  (%llu)\n", static_cast<unsigned long long>(sum));
+  }
+}
+
+int main()
+{
+  int const sizes[][2] = {{150, 150}, {400, 300}, {1000, 1000}};
+  Order const orders[] = {Order::ROW_MAJOR, Order::HILBERT, Order::MORTON, Order::RANDOM};
+
+  for(auto const& size : sizes)
+  {
+    for(Order order : orders)
+    {
+      std::mt19937 random(42);
+      Map map(size[0], size[1], order, random);
+      std::printf("%dx%d %s\n", size[0], size[1], orderName(order));
+
+      // Same map positions for every order
+      std::mt19937 positions(7);
+      std::vector<int> starts;
+      for(int i = 0; i < 2000; ++i)
+      {
+        starts.push_back(map.grid[positions() % map.grid.size()]);
+      }
+
+      run("movement searches", MovementSearches{map, starts});
+      run("range rings", RangeRings{map, starts});
+      run("chunked rendering", ChunkedRendering{map});
+    }
+  }
+  return 0;
+}